@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include "../kmeans_barrier.h"
+
+// Microbenchmark das barreiras do kmeans_barrier.h.
+// Para T = 1, 2, 4, ..., <max_threads>, cada implementação executa
+// <episodios> barreiras seguidas (como as barreiras por iteração do
+// kmeans_worker) e o programa imprime o custo médio de cada uma em tempo de
+// parede, comparado com a barreira original (condvar).
+//
+// Uso: ./barrier_bench.exe <max_threads> [episodios]
+
+typedef struct bench_arg_t {
+    int id;
+    int episodios;
+    kbarrier_t *barreira;
+    volatile double trabalho;  // Trabalho mínimo entre as barreiras
+} bench_arg_t;
+
+static double agora(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void *bench_worker(void *p) {
+    bench_arg_t *arg = (bench_arg_t *)p;
+    int e, j;
+
+    for (e = 0; e < arg->episodios; e++) {
+        for (j = 0; j < 64; j++)
+            arg->trabalho += j * 0.5;
+        kbarrier_wait(arg->barreira, arg->id);
+    }
+    return NULL;
+}
+
+// Tempo médio (ns) por barreira com 'num_threads' threads e a barreira 'tipo'.
+static double medir(int tipo, int num_threads, int episodios) {
+    kbarrier_t barreira;
+    pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t) * num_threads);
+    bench_arg_t *args = (bench_arg_t *)malloc(sizeof(bench_arg_t) * num_threads);
+    double inicio, fim;
+    int i;
+
+    if (threads == NULL || args == NULL || kbarrier_init(&barreira, tipo, num_threads) != 0) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para o benchmark\n");
+        exit(1);
+    }
+
+    inicio = agora();
+    for (i = 0; i < num_threads; i++) {
+        args[i].id = i;
+        args[i].episodios = episodios;
+        args[i].barreira = &barreira;
+        args[i].trabalho = 0.0;
+        pthread_create(&threads[i], NULL, bench_worker, &args[i]);
+    }
+    for (i = 0; i < num_threads; i++)
+        pthread_join(threads[i], NULL);
+    fim = agora();
+
+    kbarrier_destroy(&barreira);
+    free(threads);
+    free(args);
+    return (fim - inicio) * 1e9 / episodios;
+}
+
+int main(int argc, char *argv[]) {
+    int max_threads, episodios, t, tipo;
+
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Uso: %s <max_threads> [episodios]\n", argv[0]);
+        return 1;
+    }
+    max_threads = atoi(argv[1]);
+    episodios = (argc == 3) ? atoi(argv[2]) : 100000;
+    if (max_threads <= 0 || episodios <= 0) {
+        fprintf(stderr, "Erro: Numero de threads e de episodios devem ser positivos.\n");
+        return 1;
+    }
+
+    printf("threads,barreira,ns_por_barreira,aceleracao_vs_condvar\n");
+    for (t = 1; t <= max_threads; t = (t * 2 > max_threads && t != max_threads) ? max_threads : t * 2) {
+        double base = 0.0;
+        for (tipo = BARRIER_CONDVAR; tipo <= BARRIER_DISSEM; tipo++) {
+            double ns = medir(tipo, t, episodios);
+            if (tipo == BARRIER_CONDVAR)
+                base = ns;
+            printf("%d,%s,%.1f,%.2f\n", t, kbarrier_nome(tipo), ns, base / ns);
+            fflush(stdout);
+        }
+    }
+    return 0;
+}
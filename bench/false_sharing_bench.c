@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include "../kmeans_barrier.h"
+
+// Microbenchmark de falso compartilhamento no estado por thread do kmeans_worker.
+// Cada thread percorre <pontos> pontos sintéticos, escolhe um cluster entre
+// K = 4 (DIM = 3) e, como na etapa de atribuição + soma local:
+//
+//   flips_compactado  incrementa o seu contador de flips em um array de int
+//                     contíguo (o thread_data_t original, sem alinhamento)
+//   flips_alinhado    o mesmo, com cada contador na sua linha de cache
+//   flips_registrador conta em uma variável local e escreve uma vez no fim
+//   somas_compactadas soma o ponto em arrays K*DIM de todas as threads
+//                     alocados lado a lado (96 bytes cada)
+//   somas_alinhadas   o mesmo, com o array de cada thread em linhas próprias
+//
+// O programa imprime o tempo de parede por ponto e a aceleração em relação à
+// variante compactada correspondente, para T = 1, 2, 4, ..., <max_threads>.
+//
+// Uso: ./false_sharing_bench.exe <max_threads> [pontos]
+
+#define FS_K   4
+#define FS_DIM 3
+#define FS_SOMA_COMPACTA (FS_K * FS_DIM)                                      // doubles por thread
+#define FS_SOMA_ALINHADA (((FS_K * FS_DIM * 8 + BARRIER_CACHE_LINE - 1) / BARRIER_CACHE_LINE) * BARRIER_CACHE_LINE / 8)
+
+enum { FLIPS_COMPACTADO, FLIPS_ALINHADO, FLIPS_REGISTRADOR, SOMAS_COMPACTADAS, SOMAS_ALINHADAS, NUM_VARIANTES };
+static const char *nomes[] = { "flips_compactado", "flips_alinhado", "flips_registrador",
+                               "somas_compactadas", "somas_alinhadas" };
+
+typedef struct contador_alinhado_t {
+    int flips;
+    char pad[BARRIER_CACHE_LINE - sizeof(int)];
+} contador_alinhado_t;
+
+typedef struct bench_arg_t {
+    int id;
+    int variante;
+    long pontos;
+    volatile int *flips_compactado;            // num_threads entradas contíguas
+    volatile contador_alinhado_t *flips_alinhado;
+    volatile double *somas;                    // Início do array de somas desta thread
+    int resultado;
+} bench_arg_t;
+
+static double agora(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void *bench_worker(void *p) {
+    bench_arg_t *arg = (bench_arg_t *)p;
+    uint32_t estado = 2463534242u + arg->id;
+    int anterior = 0, flips = 0, c, j;
+    long i;
+
+    for (i = 0; i < arg->pontos; i++) {
+        // Ponto e cluster pseudoaleatórios (xorshift)
+        estado ^= estado << 13;
+        estado ^= estado >> 17;
+        estado ^= estado << 5;
+        c = estado % FS_K;
+
+        if (arg->variante <= FLIPS_REGISTRADOR) {
+            if (c != anterior) {
+                if (arg->variante == FLIPS_COMPACTADO)
+                    arg->flips_compactado[arg->id]++;
+                else if (arg->variante == FLIPS_ALINHADO)
+                    arg->flips_alinhado[arg->id].flips++;
+                else
+                    flips++;
+            }
+        } else {
+            for (j = 0; j < FS_DIM; j++)
+                arg->somas[c * FS_DIM + j] += (double)((estado >> (8 * j)) & 0xff);
+        }
+        anterior = c;
+    }
+    if (arg->variante == FLIPS_REGISTRADOR)
+        arg->flips_alinhado[arg->id].flips = flips;
+    arg->resultado = flips;
+    return NULL;
+}
+
+// Tempo médio (ns) por ponto com 'num_threads' threads e a 'variante'.
+static double medir(int variante, int num_threads, long pontos) {
+    pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t) * num_threads);
+    bench_arg_t *args = (bench_arg_t *)malloc(sizeof(bench_arg_t) * num_threads);
+    int *compactado = (int *)calloc(num_threads, sizeof(int));
+    void *raw = calloc(1, (sizeof(contador_alinhado_t) + sizeof(double) * FS_SOMA_ALINHADA) * num_threads + BARRIER_CACHE_LINE);
+    contador_alinhado_t *alinhado;
+    double *somas, inicio, fim;
+    int i;
+
+    if (threads == NULL || args == NULL || compactado == NULL || raw == NULL) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para o benchmark\n");
+        exit(1);
+    }
+    alinhado = (contador_alinhado_t *)(((uintptr_t)raw + BARRIER_CACHE_LINE - 1) & ~(uintptr_t)(BARRIER_CACHE_LINE - 1));
+    somas = (double *)(alinhado + num_threads);
+
+    inicio = agora();
+    for (i = 0; i < num_threads; i++) {
+        args[i].id = i;
+        args[i].variante = variante;
+        args[i].pontos = pontos;
+        args[i].flips_compactado = compactado;
+        args[i].flips_alinhado = alinhado;
+        args[i].somas = somas + (size_t)i * (variante == SOMAS_ALINHADAS ? FS_SOMA_ALINHADA : FS_SOMA_COMPACTA);
+        pthread_create(&threads[i], NULL, bench_worker, &args[i]);
+    }
+    for (i = 0; i < num_threads; i++)
+        pthread_join(threads[i], NULL);
+    fim = agora();
+
+    free(threads);
+    free(args);
+    free(compactado);
+    free(raw);
+    return (fim - inicio) * 1e9 / pontos;
+}
+
+int main(int argc, char *argv[]) {
+    int max_threads, t, v;
+    long pontos;
+
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Uso: %s <max_threads> [pontos]\n", argv[0]);
+        return 1;
+    }
+    max_threads = atoi(argv[1]);
+    pontos = (argc == 3) ? atol(argv[2]) : 20000000L;
+    if (max_threads <= 0 || pontos <= 0) {
+        fprintf(stderr, "Erro: Numero de threads e de pontos devem ser positivos.\n");
+        return 1;
+    }
+
+    printf("threads,variante,ns_por_ponto,aceleracao_vs_compactado\n");
+    for (t = 1; t <= max_threads; t = (t * 2 > max_threads && t != max_threads) ? max_threads : t * 2) {
+        double base = 0.0;
+        for (v = 0; v < NUM_VARIANTES; v++) {
+            double ns = medir(v, t, pontos);
+            if (v == FLIPS_COMPACTADO || v == SOMAS_COMPACTADAS)
+                base = ns;
+            printf("%d,%s,%.2f,%.2f\n", t, nomes[v], ns, base / ns);
+            fflush(stdout);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,45 @@
+import sys
+
+# Relatório de desvio entre os centróides finais de duas execuções, por
+# exemplo da versão sequencial em double (referência) e de uma execução com
+# -p float. As duas saídas devem ter sido geradas com -P (todos os dígitos)
+# a partir da mesma entrada, para que os centróides estejam na mesma ordem.
+#
+# Uso: python bench/precision_drift.py referencia.txt candidato.txt [tolerancia]
+
+
+def ler_centroides(caminho):
+    with open(caminho) as f:
+        return [[float(v) for v in linha.split()] for linha in f if linha.strip()]
+
+
+if len(sys.argv) < 3:
+    print("Uso: python %s referencia.txt candidato.txt [tolerancia]" % sys.argv[0])
+    sys.exit(1)
+
+ref = ler_centroides(sys.argv[1])
+cand = ler_centroides(sys.argv[2])
+tol = float(sys.argv[3]) if len(sys.argv) > 3 else 1e-3
+
+if len(ref) != len(cand) or any(len(a) != len(b) for a, b in zip(ref, cand)):
+    print("Erro: as saidas tem numero diferente de centroides ou de coordenadas.")
+    sys.exit(1)
+
+k = len(ref)
+dim = len(ref[0]) if k > 0 else 0
+escala = max((abs(v) for c in ref for v in c), default=0.0) or 1.0
+
+# Distância euclidiana entre cada par de centróides correspondentes
+desvios = []
+for a, b in zip(ref, cand):
+    desvios.append(sum((x - y) ** 2 for x, y in zip(a, b)) ** 0.5)
+pior = max(range(k), key=lambda c: desvios[c]) if k > 0 else -1
+maior_coord = max((abs(x - y) for a, b in zip(ref, cand) for x, y in zip(a, b)), default=0.0)
+acima = sum(1 for d in desvios if d > tol)
+
+print("K=%d DIM=%d" % (k, dim))
+print("desvio maximo (distancia):   %.6g (centroide %d)" % (desvios[pior] if k > 0 else 0.0, pior))
+print("desvio medio (distancia):    %.6g" % (sum(desvios) / k if k > 0 else 0.0))
+print("desvio RMS (distancia):      %.6g" % ((sum(d * d for d in desvios) / k) ** 0.5 if k > 0 else 0.0))
+print("maior diferenca de coordenada: %.6g (relativa: %.3g)" % (maior_coord, maior_coord / escala))
+print("centroides acima de %g: %d de %d" % (tol, acima, k))
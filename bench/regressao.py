@@ -0,0 +1,134 @@
+import argparse
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+# Checagens de regressão do concfinal que não aparecem em uma execução só.
+#
+# Determinismo: a saída com -e steal deve ser a mesma que com -e static, com o
+# mesmo número de threads, em todas as repetições. Diferenças aparecem quando
+# uma thread que rouba blocos lê estado (rótulos, limites) que a dona da fatia
+# ainda não recomeçou, como nos reinícios (-R) e na varredura de K (-K) com
+# -a yinyang.
+#
+# Inércia: a de cada cluster no CSV de -Q deve bater com a soma das distâncias
+# ao quadrado calculada aqui a partir dos rótulos de -l e dos centróides, em um
+# dataset longe da origem, onde somar |x|^2 cancela quase todos os dígitos.
+#
+# Exemplo:
+#   python bench/regressao.py --conc ./concfinal.exe -T 2,3,4,8 -r 5
+
+
+def gera_dataset(caminho, k, n, dim, semente):
+    """Pontos uniformes no formato do geninput.py."""
+    rng = random.Random(semente)
+    with open(caminho, "w") as f:
+        f.write("%d\n%d\n" % (k, n))
+        for _ in range(k + n):
+            f.write(" ".join("%f" % rng.uniform(-100, 100) for _ in range(dim)) + "\n")
+
+
+def gera_longe(caminho, k, n, dim, semente):
+    """Grupos de dispersão 1 com coordenadas em torno de 1e6."""
+    rng = random.Random(semente)
+    centros = [[1e6 + rng.uniform(-5, 5) for _ in range(dim)] for _ in range(k)]
+    with open(caminho, "w") as f:
+        f.write("%d\n%d\n" % (k, n))
+        for c in centros:
+            f.write(" ".join("%.6f" % v for v in c) + "\n")
+        for i in range(n):
+            c = centros[i % k]
+            f.write(" ".join("%.6f" % (v + rng.uniform(-1, 1)) for v in c) + "\n")
+
+
+def executa(cmd, tabela=False):
+    """stdout e as linhas de resultado do stderr (sem os tempos). Com 'tabela',
+    o stdout é a tabela CSV da varredura de K, sem a última coluna (tempo_s)."""
+    proc = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True)
+    if proc.returncode != 0:
+        raise RuntimeError("'%s' terminou com status %d:\n%s" % (" ".join(cmd), proc.returncode, proc.stderr))
+    resultado = [l for l in proc.stderr.splitlines() if l.startswith(("Reinicio", "Melhor", "Parada"))]
+    saida = proc.stdout
+    if tabela:
+        saida = [l.rsplit(",", 1)[0] for l in saida.splitlines()]
+        resultado += saida
+    return saida, resultado
+
+
+def determinismo(args, nome, entrada, opcoes, tabela=False):
+    """Compara -e steal com -e static para cada T. Retorna o número de falhas."""
+    falhas = 0
+    for t in args.T:
+        ref = executa([args.conc, "-i", entrada, "-P", "-e", "static"] + opcoes + [str(t)], tabela)
+        for r in range(args.repeticoes):
+            obtido = executa([args.conc, "-i", entrada, "-P", "-e", "steal"] + opcoes + [str(t)], tabela)
+            if obtido != ref:
+                falhas += 1
+                sys.stderr.write("FALHA: %s, T=%d, repeticao %d: -e steal difere de -e static\n" % (nome, t, r))
+                sys.stderr.write("  static: %s\n  steal:  %s\n" % (ref[1], obtido[1]))
+    if falhas == 0:
+        sys.stderr.write("ok: %s\n" % nome)
+    return falhas
+
+
+def inercia(args, nome, entrada, opcoes, dados, tol=1e-9):
+    """Compara a inércia de -Q com a calculada ponto a ponto. Retorna o número de falhas."""
+    with open(entrada) as f:
+        linhas = f.read().split("\n")
+    k, n = int(linhas[0]), int(linhas[1])
+    pontos = [[float(v) for v in l.split()] for l in linhas[2 + k:2 + k + n]]
+    rotulos = os.path.join(dados, "rotulos.txt")
+    inercias = os.path.join(dados, "inercias.csv")
+    falhas = 0
+    for t in args.T:
+        saida, _ = executa([args.conc, "-i", entrada, "-P", "-l", rotulos, "-Q", inercias] + opcoes + [str(t)])
+        centros = [[float(v) for v in l.split()] for l in saida.splitlines() if l.strip()]
+        with open(rotulos) as f:
+            rot = [int(v) for v in f.read().split()]
+        esperado = [0.0] * k
+        for p, c in zip(pontos, rot):
+            esperado[c] += sum((a - b) ** 2 for a, b in zip(p, centros[c]))
+        with open(inercias) as f:
+            obtido = [float(l.split(",")[2]) for l in f.read().splitlines()[1:] if l]
+        erro = max(abs(o - e) / max(1.0, e) for o, e in zip(obtido, esperado))
+        if len(obtido) != k or erro > tol:
+            falhas += 1
+            sys.stderr.write("FALHA: %s, T=%d: erro relativo %.3g na inercia de -Q\n" % (nome, t, erro))
+    if falhas == 0:
+        sys.stderr.write("ok: %s\n" % nome)
+    return falhas
+
+
+ap = argparse.ArgumentParser(description="Checagens de regressao do concfinal")
+ap.add_argument("--conc", default="./concfinal.exe")
+ap.add_argument("-T", type=lambda v: [int(x) for x in v.split(",") if x], default=[2, 3, 4, 8],
+                help="numeros de threads (lista separada por virgulas)")
+ap.add_argument("-r", "--repeticoes", type=int, default=5)
+ap.add_argument("-S", "--semente", type=int, default=1, help="semente dos datasets gerados")
+args = ap.parse_args()
+
+with tempfile.TemporaryDirectory() as dados:
+    entrada = os.path.join(dados, "k40_n30000_d3.txt")
+    gera_dataset(entrada, 40, 30000, 3, args.semente)
+    longe = os.path.join(dados, "longe_k5_n4000_d3.txt")
+    gera_longe(longe, 5, 4000, 3, args.semente)
+
+    falhas = 0
+    try:
+        falhas += determinismo(args, "reinicios (-R 3 -a yinyang)", entrada, ["-R", "3", "-a", "yinyang"])
+        falhas += determinismo(args, "reinicios (-R 3 -a hamerly)", entrada, ["-R", "3", "-a", "hamerly"])
+        falhas += determinismo(args, "varredura (-K 4:16:4 -a yinyang)", entrada, ["-K", "4:16:4", "-a", "yinyang"],
+                               tabela=True)
+        falhas += determinismo(args, "varredura (-K 4:16:4 -a hamerly)", entrada, ["-K", "4:16:4", "-a", "hamerly"],
+                               tabela=True)
+        for alg in ("lloyd", "hamerly", "yinyang"):
+            falhas += inercia(args, "inercia longe da origem (-a %s -e steal)" % alg, longe,
+                              ["-a", alg, "-e", "steal"], dados)
+    except (RuntimeError, OSError) as e:
+        sys.stderr.write("Erro: %s\n" % e)
+        sys.exit(1)
+
+sys.stderr.write("%d falha(s)\n" % falhas)
+sys.exit(1 if falhas > 0 else 0)
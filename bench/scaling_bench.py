@@ -0,0 +1,227 @@
+import argparse
+import json
+import os
+import random
+import re
+import statistics
+import subprocess
+import sys
+import tempfile
+
+# Suíte de escalabilidade: executa o seqfinal e o concfinal em uma grade de
+# N, K, DIM, modos de atribuição e números de threads, repetindo cada
+# configuração, e grava um CSV com o tempo de parede (mediana, mínimo e
+# desvio), as iterações, o tempo médio por thread de cada fase (relatório -W)
+# e a aceleração e a eficiência em relação ao seqfinal com a mesma entrada e
+# o mesmo modo (ou ao concfinal com 1 thread, se o seqfinal não for medido).
+#
+# As entradas são geradas com a semente dada e guardadas em --dados, para
+# que execuções diferentes da suíte meçam os mesmos pontos: pelo gerador
+# nativo (geninput.c, com a distribuição --tipo) ou, sem ele, aqui mesmo
+# (pontos uniformes, no formato do geninput.py) e convertidas com o txt2bin. As threads do concfinal são
+# fixadas com -c (padrão compact) e o seqfinal roda fixado na primeira CPU
+# permitida.
+#
+# Com --base, compara as medianas com as de um CSV anterior da suíte e
+# termina com status 2 se alguma configuração ficou mais lenta que a
+# tolerância.
+#
+# Exemplo:
+#   python bench/scaling_bench.py -N 200000,1000000 -K 50,500 -D 3,16 -T 1,2,4,8 \
+#       -a lloyd,hamerly -r 5 -o escala.csv
+#   python bench/scaling_bench.py ... -o escala_nova.csv --base escala.csv
+
+FASES = ["leitura", "inicializacao", "atribuicao", "contabilidade", "reducao", "checagem", "barreira"]
+COLUNAS = (["programa", "algoritmo", "n", "k", "dim", "threads", "repeticoes", "iteracoes",
+            "parede_mediana_s", "parede_min_s", "parede_desvio_s", "aceleracao", "eficiencia"] +
+           [f + "_s" for f in FASES])
+CHAVE = ["programa", "algoritmo", "n", "k", "dim", "threads"]
+
+
+def lista_int(texto):
+    return [int(v) for v in texto.split(",") if v]
+
+
+def lista_str(texto):
+    return [v for v in texto.split(",") if v]
+
+
+def gera_entrada(args, n, k, dim):
+    """Caminho do dataset (n, k, dim), gerado na primeira vez que é pedido."""
+    tipo = args.tipo if args.gerador else "uniforme"
+    base = os.path.join(args.dados, "%s_k%d_n%d_d%d_s%d" % (tipo, k, n, dim, args.semente))
+    destino = base + (".bin" if args.txt2bin or args.gerador else ".txt")
+    if os.path.exists(destino):
+        return destino
+    os.makedirs(args.dados, exist_ok=True)
+    sys.stderr.write("Gerando %s...\n" % destino)
+    if args.gerador:
+        subprocess.run([args.gerador, "-t", tipo, "-d", str(dim), "-S", str(args.semente), "-o", destino,
+                        str(k), str(n)], check=True)
+        return destino
+    rng = random.Random("%d:%d:%d:%d" % (args.semente, k, n, dim))
+    texto = base + ".txt"
+    with open(texto, "w") as f:
+        f.write("%d\n%d\n" % (k, n))
+        for _ in range(k + n):
+            f.write(" ".join("%f" % rng.uniform(-100, 100) for _ in range(dim)) + "\n")
+    if args.txt2bin:
+        with open(texto) as f:
+            subprocess.run([args.txt2bin, destino], stdin=f, check=True, stdout=subprocess.DEVNULL)
+        os.remove(texto)
+    return destino
+
+
+def fixa_primeira_cpu():
+    if hasattr(os, "sched_setaffinity"):
+        os.sched_setaffinity(0, {min(os.sched_getaffinity(0))})
+
+
+def executa(args, programa, entrada, algoritmo, threads):
+    """Uma execução: (tempo de parede, iterações, segundos por fase)."""
+    fd, relatorio = tempfile.mkstemp(suffix=".json")
+    os.close(fd)
+    cmd = [args.seq if programa == "seqfinal" else args.conc, "-i", entrada, "-a", algoritmo, "-W", relatorio]
+    cmd += args.extra.split()
+    preexec = None
+    if programa == "concfinal":
+        if args.fixacao != "none":
+            cmd += ["-c", args.fixacao]
+        cmd.append(str(threads))
+    elif args.fixacao != "none":
+        preexec = fixa_primeira_cpu
+    try:
+        proc = subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE,
+                              universal_newlines=True, preexec_fn=preexec)
+        if proc.returncode != 0:
+            raise RuntimeError("'%s' terminou com status %d:\n%s" % (" ".join(cmd), proc.returncode, proc.stderr))
+        parede = re.search(r"Tempo de parede total[^:]*: ([0-9.eE+-]+) segundos", proc.stderr)
+        parada = re.search(r"na iteracao (\d+)", proc.stderr)
+        with open(relatorio) as f:
+            rel = json.load(f)
+    finally:
+        os.remove(relatorio)
+    if parede is None:
+        raise RuntimeError("'%s' nao imprimiu o tempo de parede" % " ".join(cmd))
+
+    # Soma das iterações de cada thread, na média das threads
+    fases = [0.0] * len(FASES)
+    for t in rel["por_thread"]:
+        for linha in t["iteracoes"]:
+            for i, s in enumerate(linha):
+                fases[i] += s
+    fases = [s / max(len(rel["por_thread"]), 1) for s in fases]
+    return float(parede.group(1)), int(parada.group(1)) if parada else -1, fases
+
+
+def mede(args, programa, entrada, algoritmo, threads, n, k, dim):
+    tempos, iteracoes, fases = [], [], []
+    for _ in range(args.repeticoes):
+        t, it, f = executa(args, programa, entrada, algoritmo, threads)
+        tempos.append(t)
+        iteracoes.append(it)
+        fases.append(f)
+    linha = {"programa": programa, "algoritmo": algoritmo, "n": n, "k": k, "dim": dim, "threads": threads,
+             "repeticoes": args.repeticoes, "iteracoes": statistics.median_low(iteracoes),
+             "parede_mediana_s": statistics.median(tempos), "parede_min_s": min(tempos),
+             "parede_desvio_s": statistics.stdev(tempos) if len(tempos) > 1 else 0.0}
+    for i, nome in enumerate(FASES):
+        linha[nome + "_s"] = statistics.median(f[i] for f in fases)
+    sys.stderr.write("%-9s %-7s N=%d K=%d DIM=%d T=%d: %.4f s (%d iteracoes)\n" %
+                     (programa, algoritmo, n, k, dim, threads, linha["parede_mediana_s"], linha["iteracoes"]))
+    return linha
+
+
+def formata(v):
+    return "%.6f" % v if isinstance(v, float) else str(v)
+
+
+def compara(linhas, caminho, tolerancia):
+    """Lista as configurações mais lentas que na base. Retorna quantas foram."""
+    base = {}
+    with open(caminho) as f:
+        cab = f.readline().strip().split(",")
+        for texto in f:
+            valores = dict(zip(cab, texto.strip().split(",")))
+            if "parede_mediana_s" in valores:
+                base[tuple(valores[c] for c in CHAVE)] = float(valores["parede_mediana_s"])
+    regressoes = 0
+    for linha in linhas:
+        antes = base.get(tuple(str(linha[c]) for c in CHAVE))
+        if antes is None or antes <= 0:
+            continue
+        razao = linha["parede_mediana_s"] / antes
+        if razao > 1 + tolerancia:
+            regressoes += 1
+            sys.stderr.write("REGRESSAO: %s %s N=%s K=%s DIM=%s T=%s: %.4f s -> %.4f s (%+.1f%%)\n" %
+                             (tuple(str(linha[c]) for c in CHAVE) +
+                              (antes, linha["parede_mediana_s"], (razao - 1) * 100)))
+    sys.stderr.write("%d regressao(oes) acima de %.0f%% em relacao a %s\n" % (regressoes, tolerancia * 100, caminho))
+    return regressoes
+
+
+ap = argparse.ArgumentParser(description="Suite de escalabilidade do seqfinal/concfinal")
+ap.add_argument("-N", type=lista_int, default=[200000], help="numeros de pontos (lista separada por virgulas)")
+ap.add_argument("-K", type=lista_int, default=[50], help="numeros de clusters")
+ap.add_argument("-D", type=lista_int, default=[3], help="dimensoes")
+ap.add_argument("-T", type=lista_int, default=[1, 2, 4, 8], help="numeros de threads do concfinal")
+ap.add_argument("-a", type=lista_str, default=["lloyd"], help="modos de atribuicao (lloyd,hamerly,yinyang)")
+ap.add_argument("-r", "--repeticoes", type=int, default=3)
+ap.add_argument("-c", "--fixacao", default="compact", choices=["none", "compact", "scatter"])
+ap.add_argument("-x", "--extra", default="", help="opcoes extras para os dois programas (ex.: \"-I 50\")")
+ap.add_argument("-S", "--semente", type=int, default=1, help="semente dos datasets gerados")
+ap.add_argument("-o", "--saida", default="-", help="CSV de resultados (padrao: stdout)")
+ap.add_argument("--base", help="CSV anterior da suite para a checagem de regressao")
+ap.add_argument("--tolerancia", type=float, default=0.10, help="lentidao aceita em relacao a base (0.10 = 10%%)")
+ap.add_argument("--dados", default="bench_dados")
+ap.add_argument("--seq", default="./seqfinal.exe", help="executavel sequencial (vazio para nao medir)")
+ap.add_argument("--conc", default="./concfinal.exe")
+ap.add_argument("--txt2bin", default="./txt2bin.exe", help="conversor (vazio para usar a entrada texto)")
+ap.add_argument("--gerador", default="./geninput.exe", help="gerador nativo (vazio para gerar aqui, uniforme)")
+ap.add_argument("--tipo", default="blobs", choices=["uniforme", "blobs", "aniso"],
+                help="distribuicao dos datasets do gerador nativo")
+args = ap.parse_args()
+
+if args.repeticoes < 1:
+    ap.error("o numero de repeticoes deve ser positivo")
+if args.txt2bin and not os.path.exists(args.txt2bin):
+    args.txt2bin = ""
+if args.gerador and not os.path.exists(args.gerador):
+    args.gerador = ""
+
+linhas = []
+try:
+    for n in args.N:
+        for k in args.K:
+            for dim in args.D:
+                entrada = gera_entrada(args, n, k, dim)
+                for algoritmo in args.a:
+                    grupo = []
+                    if args.seq:
+                        grupo.append(mede(args, "seqfinal", entrada, algoritmo, 1, n, k, dim))
+                    for t in args.T:
+                        grupo.append(mede(args, "concfinal", entrada, algoritmo, t, n, k, dim))
+
+                    # Referência: seqfinal ou, sem ele, concfinal com 1 thread
+                    ref = [l for l in grupo if l["programa"] == "seqfinal"] or \
+                          [l for l in grupo if l["threads"] == 1]
+                    for l in grupo:
+                        if ref and l["parede_mediana_s"] > 0:
+                            l["aceleracao"] = ref[0]["parede_mediana_s"] / l["parede_mediana_s"]
+                            l["eficiencia"] = l["aceleracao"] / l["threads"]
+                        else:
+                            l["aceleracao"] = l["eficiencia"] = ""
+                    linhas.extend(grupo)
+except (RuntimeError, OSError, subprocess.CalledProcessError) as e:
+    sys.stderr.write("Erro: %s\n" % e)
+    sys.exit(1)
+
+saida = sys.stdout if args.saida == "-" else open(args.saida, "w")
+saida.write(",".join(COLUNAS) + "\n")
+for l in linhas:
+    saida.write(",".join(formata(l[c]) for c in COLUNAS) + "\n")
+if saida is not sys.stdout:
+    saida.close()
+
+if args.base and compara(linhas, args.base, args.tolerancia) > 0:
+    sys.exit(2)
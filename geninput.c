@@ -0,0 +1,402 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "kmeans_io.h"
+#include "kmeans_init.h"
+
+// Gerador nativo de datasets, no lugar do geninput.py para entradas grandes.
+// Grava K "chutes" iniciais e N pontos, todos sorteados da mesma
+// distribuição, no formato texto do geninput.py (stdout ou arquivo .txt) ou
+// direto no formato binário do kmeans_io.h (-o arquivo.bin).
+//
+// Distribuições (-t):
+//   uniforme  coordenadas uniformes em [-100, 100] (a do geninput.py)
+//   blobs     mistura de C gaussianas isotrópicas (desvio -s), com centros
+//             uniformes em [-100, 100]
+//   aniso     mistura de C gaussianas com covariâncias sorteadas: cada
+//             componente aplica uma matriz DIM x DIM própria ao ruído normal
+// Com -z alfa, o peso da componente j é proporcional a 1/(j+1)^alfa
+// (clusters de tamanhos desiguais); alfa = 0 dá componentes do mesmo tamanho.
+//
+// Cada registro i usa um gerador próprio, semeado com (semente, i), então o
+// arquivo depende só da semente e não do número de threads. As threads
+// geram blocos alternados e os gravam na ordem, um de cada vez.
+
+#define TIPO_UNIFORME 0
+#define TIPO_BLOBS    1
+#define TIPO_ANISO    2
+
+#define BLOCO         16384   // Registros por bloco gravado
+#define MAX_CHARS     32      // Caracteres por coordenada no texto
+
+typedef struct gerador_t {
+    int tipo, dim, componentes;
+    double desvio, alfa;
+    uint64_t semente;
+    double *centros;      // componentes x dim
+    double *acumulado;    // Pesos acumulados (o último é 1)
+    double *matrizes;     // componentes x dim x dim (aniso)
+} gerador_t;
+
+typedef struct saida_t {
+    FILE *f;
+    int texto, elem_size;
+    uint64_t total;       // K + N registros
+    uint64_t vez;         // Próximo bloco a ser gravado
+    int erro;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} saida_t;
+
+typedef struct thread_data_t {
+    int id, num_threads;
+    const gerador_t *g;
+    saida_t *saida;
+} thread_data_t;
+
+
+// Normal padrão (Box-Muller; a segunda normal do par fica em 'sobra').
+static inline double normal(uint64_t *estado, double *sobra, int *tem_sobra) {
+    double u, v, r;
+
+    if (*tem_sobra) {
+        *tem_sobra = 0;
+        return *sobra;
+    }
+    do {
+        u = kinit_uniforme(estado);
+    } while (u <= 0.0);
+    v = kinit_uniforme(estado);
+    r = sqrt(-2.0 * log(u));
+    *sobra = r * sin(6.283185307179586 * v);
+    *tem_sobra = 1;
+    return r * cos(6.283185307179586 * v);
+}
+
+// Sorteia centros, pesos e matrizes das componentes. Retorna 0 se ok, -1 se faltar memória.
+static int prepara_gerador(gerador_t *g) {
+    uint64_t estado = kinit_mix(g->semente ^ 0x5851f42d4c957f2dULL);
+    double sobra = 0.0, soma = 0.0;
+    int tem_sobra = 0, c, d, e;
+
+    g->centros = (double *)malloc(sizeof(double) * g->componentes * g->dim);
+    g->acumulado = (double *)malloc(sizeof(double) * g->componentes);
+    if (g->tipo == TIPO_ANISO)
+        g->matrizes = (double *)malloc(sizeof(double) * g->componentes * g->dim * g->dim);
+    if (g->centros == NULL || g->acumulado == NULL || (g->tipo == TIPO_ANISO && g->matrizes == NULL))
+        return -1;
+
+    for (c = 0; c < g->componentes; c++) {
+        for (d = 0; d < g->dim; d++)
+            g->centros[c * g->dim + d] = -100.0 + 200.0 * kinit_uniforme(&estado);
+        soma += pow(c + 1.0, -g->alfa);
+        g->acumulado[c] = soma;
+    }
+    for (c = 0; c < g->componentes; c++)
+        g->acumulado[c] /= soma;
+    g->acumulado[g->componentes - 1] = 1.0;
+
+    // aniso: matriz gaussiana com as colunas em escalas sorteadas em [0.1, 2],
+    // normalizada para que o desvio médio por eixo seja da ordem de -s
+    if (g->tipo == TIPO_ANISO) {
+        for (c = 0; c < g->componentes; c++) {
+            double *m = g->matrizes + (size_t)c * g->dim * g->dim;
+            for (e = 0; e < g->dim; e++) {
+                double escala = g->desvio * (0.1 + 1.9 * kinit_uniforme(&estado)) / sqrt((double)g->dim);
+                for (d = 0; d < g->dim; d++)
+                    m[d * g->dim + e] = escala * normal(&estado, &sobra, &tem_sobra);
+            }
+        }
+    }
+    return 0;
+}
+
+static void libera_gerador(gerador_t *g) {
+    free(g->centros);
+    free(g->acumulado);
+    free(g->matrizes);
+}
+
+// Coordenadas do registro 'i' em p[0..dim). 'z' é um rascunho de dim doubles.
+static inline void gera_registro(const gerador_t *g, uint64_t i, double *p, double *z) {
+    uint64_t estado = kinit_mix(g->semente + kinit_mix(i));
+    double sobra = 0.0, u;
+    const double *centro;
+    int tem_sobra = 0, c, lo, hi, d, e;
+
+    if (g->tipo == TIPO_UNIFORME) {
+        for (d = 0; d < g->dim; d++)
+            p[d] = -100.0 + 200.0 * kinit_uniforme(&estado);
+        return;
+    }
+
+    // Componente: busca binária nos pesos acumulados
+    u = kinit_uniforme(&estado);
+    lo = 0;
+    hi = g->componentes - 1;
+    while (lo < hi) {
+        c = (lo + hi) / 2;
+        if (u < g->acumulado[c])
+            hi = c;
+        else
+            lo = c + 1;
+    }
+    c = lo;
+    centro = g->centros + (size_t)c * g->dim;
+
+    for (d = 0; d < g->dim; d++)
+        z[d] = normal(&estado, &sobra, &tem_sobra);
+    if (g->tipo == TIPO_BLOBS) {
+        for (d = 0; d < g->dim; d++)
+            p[d] = centro[d] + g->desvio * z[d];
+    } else {
+        const double *m = g->matrizes + (size_t)c * g->dim * g->dim;
+        for (d = 0; d < g->dim; d++) {
+            double v = centro[d];
+            for (e = 0; e < g->dim; e++)
+                v += m[d * g->dim + e] * z[e];
+            p[d] = v;
+        }
+    }
+}
+
+
+// Escreve 'v' como o "%f" do printf (6 casas). Retorna o número de caracteres.
+static inline int formata_coord(char *s, double v) {
+    char dig[24];
+    long long q;
+    int n = 0, k = 0, i;
+
+    if (!(fabs(v) < 1e12))
+        return snprintf(s, MAX_CHARS, "%f", v);
+    q = llround(v * 1e6);
+    if (q < 0) {
+        s[n++] = '-';
+        q = -q;
+    }
+    do {
+        dig[k++] = (char)('0' + q % 10);
+        q /= 10;
+    } while (q > 0 || k < 7);
+    for (i = k - 1; i >= 6; i--)
+        s[n++] = dig[i];
+    s[n++] = '.';
+    for (i = 5; i >= 0; i--)
+        s[n++] = dig[i];
+    return n;
+}
+
+// Gera os blocos id, id + T, id + 2T, ... e os grava quando chegar a vez de cada um.
+static void *gera_blocos(void *arg) {
+    thread_data_t *data = (thread_data_t *)arg;
+    const gerador_t *g = data->g;
+    saida_t *s = data->saida;
+    int dim = g->dim;
+    size_t por_registro = s->texto ? (size_t)dim * MAX_CHARS + 1 : (size_t)dim * s->elem_size;
+    char *buf = (char *)malloc(por_registro * BLOCO);
+    double *p = (double *)malloc(sizeof(double) * dim * 2);
+    uint64_t bloco, blocos = (s->total + BLOCO - 1) / BLOCO;
+
+    if (buf == NULL || p == NULL) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para a thread %d\n", data->id);
+        pthread_mutex_lock(&s->mutex);
+        s->erro = 1;
+        pthread_cond_broadcast(&s->cond);
+        pthread_mutex_unlock(&s->mutex);
+        free(buf);
+        free(p);
+        return NULL;
+    }
+
+    for (bloco = (uint64_t)data->id; bloco < blocos; bloco += (uint64_t)data->num_threads) {
+        uint64_t i, ini = bloco * BLOCO;
+        uint64_t fim = (ini + BLOCO < s->total) ? ini + BLOCO : s->total;
+        size_t len = 0;
+        int d, ok;
+
+        for (i = ini; i < fim; i++) {
+            gera_registro(g, i, p, p + dim);
+            if (s->texto) {
+                for (d = 0; d < dim; d++) {
+                    len += (size_t)formata_coord(buf + len, p[d]);
+                    buf[len++] = (d + 1 < dim) ? ' ' : '\n';
+                }
+            } else if (s->elem_size == sizeof(float)) {
+                float *out = (float *)(buf + len);
+                for (d = 0; d < dim; d++)
+                    out[d] = (float)p[d];
+                len += sizeof(float) * dim;
+            } else {
+                memcpy(buf + len, p, sizeof(double) * dim);
+                len += sizeof(double) * dim;
+            }
+        }
+
+        // Gravação na ordem dos blocos
+        pthread_mutex_lock(&s->mutex);
+        while (s->vez != bloco && !s->erro)
+            pthread_cond_wait(&s->cond, &s->mutex);
+        if (s->erro) {
+            pthread_mutex_unlock(&s->mutex);
+            break;
+        }
+        pthread_mutex_unlock(&s->mutex);
+        ok = (fwrite(buf, 1, len, s->f) == len);
+        pthread_mutex_lock(&s->mutex);
+        if (!ok)
+            s->erro = 1;
+        s->vez++;
+        pthread_cond_broadcast(&s->cond);
+        pthread_mutex_unlock(&s->mutex);
+    }
+
+    free(buf);
+    free(p);
+    return NULL;
+}
+
+
+int main(int argc, char *argv[]) {
+    gerador_t g;
+    saida_t s;
+    pthread_t *threads;
+    thread_data_t *dados;
+    const char *saida = NULL;
+    long k, n;
+    int num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int opt, t;
+
+    memset(&g, 0, sizeof(g));
+    memset(&s, 0, sizeof(s));
+    g.tipo = TIPO_BLOBS;
+    g.dim = 3;
+    g.desvio = 5.0;
+    g.semente = 1;
+    s.elem_size = sizeof(double);
+
+    while ((opt = getopt(argc, argv, "d:t:c:s:z:S:T:fo:")) != -1) {
+        if (opt == 'd') {
+            g.dim = atoi(optarg);
+        } else if (opt == 't' && strcmp(optarg, "uniforme") == 0) {
+            g.tipo = TIPO_UNIFORME;
+        } else if (opt == 't' && strcmp(optarg, "blobs") == 0) {
+            g.tipo = TIPO_BLOBS;
+        } else if (opt == 't' && strcmp(optarg, "aniso") == 0) {
+            g.tipo = TIPO_ANISO;
+        } else if (opt == 'c') {
+            g.componentes = atoi(optarg);
+        } else if (opt == 's') {
+            g.desvio = atof(optarg);
+        } else if (opt == 'z') {
+            g.alfa = atof(optarg);
+        } else if (opt == 'S') {
+            g.semente = strtoull(optarg, NULL, 10);
+        } else if (opt == 'T') {
+            num_threads = atoi(optarg);
+        } else if (opt == 'f') {
+            s.elem_size = sizeof(float);
+        } else if (opt == 'o') {
+            saida = optarg;
+        } else {
+            argc = 0; // Força a mensagem de uso abaixo
+            break;
+        }
+    }
+    if (argc - optind != 2) {
+        fprintf(stderr, "Erro: Voce deve especificar K e N.\n");
+        fprintf(stderr, "Uso: %s [-t uniforme|blobs|aniso] [-d dim] [-c componentes] [-s desvio] [-z alfa] "
+                "[-S semente] [-T threads] [-f] [-o input.bin|input.txt] <K> <N> > input.txt\n", argv[0]);
+        return 1;
+    }
+    k = atol(argv[optind]);
+    n = atol(argv[optind + 1]);
+    if (k <= 0 || n <= 0 || k > 0x7fffffffL || n > 0x7fffffffL) {
+        fprintf(stderr, "Erro: K e N devem estar entre 1 e 2147483647.\n");
+        return 1;
+    }
+    if (g.dim <= 0) {
+        fprintf(stderr, "Erro: a dimensao deve ser positiva.\n");
+        return 1;
+    }
+    if (g.componentes <= 0)
+        g.componentes = (int)k;
+    if (g.desvio <= 0.0 || g.alfa < 0.0) {
+        fprintf(stderr, "Erro: o desvio deve ser positivo e alfa nao pode ser negativo.\n");
+        return 1;
+    }
+    if (num_threads <= 0)
+        num_threads = 1;
+
+    // Texto no stdout ou em um arquivo .txt; binário em qualquer outro nome
+    s.texto = 1;
+    if (saida != NULL) {
+        size_t len = strlen(saida);
+        s.texto = (len >= 4 && strcmp(saida + len - 4, ".txt") == 0);
+    }
+    if (s.texto && s.elem_size == sizeof(float)) {
+        fprintf(stderr, "Erro: -f vale so para a saida binaria (-o input.bin).\n");
+        return 1;
+    }
+    s.f = (saida != NULL) ? fopen(saida, s.texto ? "w" : "wb") : stdout;
+    if (s.f == NULL) {
+        fprintf(stderr, "Erro: nao foi possivel criar '%s'.\n", saida);
+        return 1;
+    }
+    s.total = (uint64_t)k + (uint64_t)n;
+
+    if (prepara_gerador(&g) != 0) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para as componentes\n");
+        return 1;
+    }
+
+    // 1. Cabeçalho
+    if (s.texto) {
+        fprintf(s.f, "%ld\n%ld\n", k, n);
+    } else {
+        kmb_header_t h;
+        kmb_header_init(&h, (int)k, (int)n, g.dim, s.elem_size);
+        if (fwrite(&h, sizeof(h), 1, s.f) != 1)
+            s.erro = 1;
+    }
+
+    // 2. Registros, em paralelo
+    threads = (pthread_t *)malloc(sizeof(pthread_t) * num_threads);
+    dados = (thread_data_t *)malloc(sizeof(thread_data_t) * num_threads);
+    if (threads == NULL || dados == NULL) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para as threads\n");
+        return 1;
+    }
+    pthread_mutex_init(&s.mutex, NULL);
+    pthread_cond_init(&s.cond, NULL);
+    for (t = 0; t < num_threads; t++) {
+        dados[t].id = t;
+        dados[t].num_threads = num_threads;
+        dados[t].g = &g;
+        dados[t].saida = &s;
+        pthread_create(&threads[t], NULL, gera_blocos, &dados[t]);
+    }
+    for (t = 0; t < num_threads; t++)
+        pthread_join(threads[t], NULL);
+    pthread_mutex_destroy(&s.mutex);
+    pthread_cond_destroy(&s.cond);
+
+    if ((saida != NULL && fclose(s.f) != 0) || (saida == NULL && fflush(s.f) != 0))
+        s.erro = 1;
+    if (s.erro) {
+        fprintf(stderr, "Erro: falha ao gravar '%s'.\n", saida != NULL ? saida : "stdout");
+        return 1;
+    }
+
+    fprintf(stderr, "Gerados K=%ld chutes e N=%ld pontos (DIM=%d, %s, %d componentes, %d threads)%s%s\n",
+            k, n, g.dim, g.tipo == TIPO_UNIFORME ? "uniforme" : (g.tipo == TIPO_BLOBS ? "blobs" : "aniso"),
+            g.tipo == TIPO_UNIFORME ? 0 : g.componentes, num_threads,
+            saida != NULL ? " em " : "", saida != NULL ? saida : "");
+
+    libera_gerador(&g);
+    free(threads);
+    free(dados);
+    return 0;
+}
@@ -3,8 +3,10 @@ from random import uniform as uni
 # k = 50 & n = 1000000 for the contest
 k = int(sys.argv[1])
 n = int(sys.argv[2])
+# dimensão opcional (padrão 3, o formato original)
+dim = int(sys.argv[3]) if len(sys.argv) > 3 else 3
 
 print(k)
 print(n)
 for i in range(k+n):
-	print("%f %f %f" %(uni(-100,100), uni(-100,100), uni(-100,100)))
\ No newline at end of file
+	print(" ".join("%f" % uni(-100,100) for j in range(dim)))
\ No newline at end of file
@@ -0,0 +1,642 @@
+#ifndef KMEANS_ACCEL_H
+#define KMEANS_ACCEL_H
+
+// Modos acelerados da etapa de atribuição, compartilhados pela versão
+// sequencial e pela concorrente. Todas as funções trabalham sobre um
+// intervalo de pontos [ini, fim) ou de centróides [c_ini, c_fim), de modo que
+// cada thread chama a função com a sua própria fatia.
+//
+// As funções de atribuição recebem opcionalmente 'sum_local'/'count_local':
+// se não forem NULL, cada ponto é somado ao seu cluster logo depois de
+// atribuído (etapa fundida da versão concorrente), na mesma ordem de pontos.
+//
+// Os modos só evitam cálculos de distância cujo resultado não pode mudar o
+// cluster de um ponto: quando o ponto não é descartado, as K distâncias são
+// calculadas exatamente como no laço original (mesma ordem, mesmo desempate),
+// então os centróides finais são idênticos aos do modo exaustivo.
+//
+// A dimensão vem do dataset em tempo de execução. Os laços quentes são
+// escritos uma vez (funções "_impl", sempre expandidas) e KMEANS_DIM_DISPATCH
+// os instancia com 'dim' constante para as dimensões comuns, de modo que o
+// compilador desenrola os laços sobre as coordenadas; as demais dimensões
+// usam o laço genérico.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+
+#if defined(__GNUC__)
+#define KMEANS_FORCE_INLINE inline __attribute__((always_inline))
+#else
+#define KMEANS_FORCE_INLINE inline
+#endif
+
+// Executa CHAMADA(D) com D constante se 'dim' for uma dimensão especializada,
+// ou CHAMADA(dim) caso contrário. CHAMADA deve terminar com return.
+#define KMEANS_DIM_DISPATCH(dim, CHAMADA) \
+    switch (dim) {                        \
+    case 2:   CHAMADA(2);                 \
+    case 3:   CHAMADA(3);                 \
+    case 4:   CHAMADA(4);                 \
+    case 8:   CHAMADA(8);                 \
+    case 16:  CHAMADA(16);                \
+    case 32:  CHAMADA(32);                \
+    case 64:  CHAMADA(64);                \
+    case 128: CHAMADA(128);               \
+    default:  CHAMADA(dim);               \
+    }
+
+#define ALG_LLOYD   0   // Laço exaustivo original (K distâncias por ponto)
+#define ALG_HAMERLY 1   // Limites superior/inferior por ponto (Hamerly)
+#define ALG_YINYANG 2   // Um limite inferior por grupo de centróides (Yinyang)
+
+// Converte o nome passado na linha de comando (-a) para ALG_*; -1 se inválido.
+static inline int kmeans_parse_algoritmo(const char *nome) {
+    if (strcmp(nome, "lloyd") == 0) return ALG_LLOYD;
+    if (strcmp(nome, "hamerly") == 0) return ALG_HAMERLY;
+    if (strcmp(nome, "yinyang") == 0) return ALG_YINYANG;
+    return -1;
+}
+
+
+// Distância euclidiana ao quadrado, na mesma ordem de soma do laço original.
+static KMEANS_FORCE_INLINE double kmeans_dist2(const double *a, const double *b, int dim) {
+    double dx = 0.0;
+    int j;
+    for (j = 0; j < dim; j++)
+        dx += (a[j] - b[j])*(a[j] - b[j]);
+    return dx;
+}
+
+
+// Soma dos quadrados das distâncias dos pontos de cada cluster a uma origem
+// por cluster (-l/-Q): 'soma' tem K posições e 'origem' (K*DIM) são os
+// centróides usados na atribuição, de onde os pontos estão perto. Com |x|^2
+// no lugar de |x - origem|^2, a inércia de dados longe da origem do espaço
+// se perderia no cancelamento.
+typedef struct kmeans_quad_t {
+    double *soma;
+    const double *origem;
+} kmeans_quad_t;
+
+// Soma o ponto 'xi' nas somas locais do cluster 'c' (nada se sum_local == NULL).
+// Se 'quad_local' não for NULL, soma também |xi - origem[c]|^2: com as somas e
+// as contagens reduzidas, isso dá a inércia de cada cluster em relação a
+// qualquer centróide (kmeans_inercia_cluster) sem outra passada pelos pontos.
+static KMEANS_FORCE_INLINE void kmeans_accumulate(double *sum_local, int *count_local, kmeans_quad_t *quad_local,
+                                                  const double *xi, int c, int dim) {
+    double q = 0.0, d;
+    int j;
+    if (sum_local == NULL)
+        return;
+    count_local[c]++;
+    for (j = 0; j < dim; j++)
+        sum_local[c*dim + j] += xi[j];
+    if (quad_local != NULL) {
+        const double *o = quad_local->origem + (size_t)c * dim;
+        for (j = 0; j < dim; j++) {
+            d = xi[j] - o[j];
+            q += d * d;
+        }
+        quad_local->soma[c] += q;
+    }
+}
+
+// O mesmo para um ponto em float32 (modo float): a soma é feita em double.
+static KMEANS_FORCE_INLINE void kmeans_accumulate_f(double *sum_local, int *count_local, kmeans_quad_t *quad_local,
+                                                    const float *xi, int c, int dim) {
+    double q = 0.0, d;
+    int j;
+    if (sum_local == NULL)
+        return;
+    count_local[c]++;
+    for (j = 0; j < dim; j++)
+        sum_local[c*dim + j] += (double)xi[j];
+    if (quad_local != NULL) {
+        const double *o = quad_local->origem + (size_t)c * dim;
+        for (j = 0; j < dim; j++) {
+            d = (double)xi[j] - o[j];
+            q += d * d;
+        }
+        quad_local->soma[c] += q;
+    }
+}
+
+// Inércia de um cluster com 'n' pontos em relação ao centróide 'm', a partir
+// da soma 'quad' de |x - o|^2 dos pontos (kmeans_accumulate, com a origem 'o'
+// do cluster) e da soma 'soma' dos pontos (DIM coordenadas):
+// sum |x - m|^2 = quad - 2 (m - o).(soma - n o) + n |m - o|^2.
+// Com 'o' perto de 'm' (o centróide da última atribuição) não há cancelamento
+// entre termos grandes. Pequenos negativos do arredondamento viram 0.
+static inline double kmeans_inercia_cluster(double quad, const double *soma, int n, const double *m,
+                                            const double *o, int dim) {
+    double cruzado = 0.0, mo2 = 0.0, mo, r;
+    int j;
+    for (j = 0; j < dim; j++) {
+        mo = m[j] - o[j];
+        cruzado += mo * (soma[j] - (double)n * o[j]);
+        mo2 += mo * mo;
+    }
+    r = quad - 2.0 * cruzado + (double)n * mo2;
+    return (r > 0.0) ? r : 0.0;
+}
+
+
+// Inércia dos pontos [ini, fim) em relação às médias finais 'mean': soma das
+// distâncias ao quadrado de cada ponto ao centróide mais próximo (empate fica
+// com o de menor índice, como na atribuição). 'x' ou, no modo float, 'xf' são
+// os pontos. Se 'rotulo' não for NULL, grava nele o centróide de cada ponto.
+static inline double kmeans_inercia_range(const double *x, const float *xf, const double *mean, int k, int dim,
+                                          int ini, int fim, int *rotulo) {
+    double inercia = 0.0, d, dmin, dj;
+    int i, j, c, melhor;
+
+    for (i = ini; i < fim; i++) {
+        dmin = HUGE_VAL;
+        melhor = 0;
+        for (c = 0; c < k; c++) {
+            const double *m = mean + (size_t)c * dim;
+            if (xf != NULL) {
+                const float *p = xf + (size_t)i * dim;
+                d = 0.0;
+                for (j = 0; j < dim; j++) {
+                    dj = (double)p[j] - m[j];
+                    d += dj * dj;
+                }
+            } else {
+                d = kmeans_dist2(x + (size_t)i * dim, m, dim);
+            }
+            if (d < dmin) {
+                dmin = d;
+                melhor = c;
+            }
+        }
+        inercia += dmin;
+        if (rotulo != NULL)
+            rotulo[i] = melhor;
+    }
+    return inercia;
+}
+
+
+//  HAMERLY
+//
+// Para cada ponto i guardamos:
+//   upper[i] >= d(x_i, mean[cluster[i]])
+//   lower[i] <= d(x_i, mean[c]) para todo c != cluster[i]
+// e, para cada centróide, s[c] = metade da distância ao centróide mais
+// próximo. Se upper[i] < max(s[a], lower[i]), o centróide 'a' atual é
+// estritamente o mais próximo e o ponto é pulado. Quando os centróides se
+// movem, upper cresce com o deslocamento do próprio centróide e lower diminui
+// com o maior deslocamento entre os demais.
+
+typedef struct hamerly_t {
+    double *upper, *lower;    // Limites por ponto (N)
+    double *s;                // Metade da distância ao centróide mais próximo (K)
+    double *shift;            // Deslocamento de cada centróide na última atualização (K)
+    double max_shift, max_shift2;
+    int arg_shift;            // Centróide com o maior deslocamento
+} hamerly_t;
+
+
+// Limites iniciais dos pontos [ini, fim) (também para recomeçar com outros
+// centróides iniciais).
+static inline void hamerly_reset_range(hamerly_t *h, int ini, int fim) {
+    int i;
+    for (i = ini; i < fim; i++) {
+        h->upper[i] = HUGE_VAL;
+        h->lower[i] = 0.0;
+    }
+}
+
+// Aloca os limites. upper = infinito e lower = 0 são válidos para qualquer
+// atribuição inicial, então a primeira iteração não precisa de tratamento especial.
+// Retorna 0 se ok, -1 se faltar memória.
+static inline int hamerly_alloc(hamerly_t *h, int n, int k) {
+    int i;
+
+    h->upper = (double *)malloc(sizeof(double) * n);
+    h->lower = (double *)malloc(sizeof(double) * n);
+    h->s = (double *)malloc(sizeof(double) * k);
+    h->shift = (double *)malloc(sizeof(double) * k);
+    if (h->upper == NULL || h->lower == NULL || h->s == NULL || h->shift == NULL)
+        return -1;
+    hamerly_reset_range(h, 0, n);
+    for (i = 0; i < k; i++)
+        h->shift[i] = 0.0;
+    h->max_shift = h->max_shift2 = 0.0;
+    h->arg_shift = -1;
+    return 0;
+}
+
+static inline void hamerly_free(hamerly_t *h) {
+    free(h->upper);
+    free(h->lower);
+    free(h->s);
+    free(h->shift);
+}
+
+
+// Calcula s[c] para os centróides [c_ini, c_fim) a partir das médias atuais.
+static inline void hamerly_centers_range(hamerly_t *h, const double *mean, int k, int dim, int c_ini, int c_fim) {
+    int c, o;
+
+    for (c = c_ini; c < c_fim; c++) {
+        double dmin = HUGE_VAL;
+        for (o = 0; o < k; o++) {
+            if (o != c) {
+                double d = kmeans_dist2(mean + c*dim, mean + o*dim, dim);
+                if (d < dmin) dmin = d;
+            }
+        }
+        h->s[c] = 0.5 * sqrt(dmin);
+    }
+}
+
+
+// Registra o deslocamento dos centróides [c_ini, c_fim) entre 'old' e 'mean'.
+static inline void hamerly_shift_range(hamerly_t *h, const double *old, const double *mean, int dim, int c_ini, int c_fim) {
+    int c;
+    for (c = c_ini; c < c_fim; c++)
+        h->shift[c] = sqrt(kmeans_dist2(old + c*dim, mean + c*dim, dim));
+}
+
+
+// Maior e segundo maior deslocamento (O(K)); chamar depois de hamerly_shift_range.
+static inline void hamerly_shift_summary(hamerly_t *h, int k) {
+    int c;
+
+    h->max_shift = h->max_shift2 = 0.0;
+    h->arg_shift = -1;
+    for (c = 0; c < k; c++) {
+        if (h->shift[c] > h->max_shift) {
+            h->max_shift2 = h->max_shift;
+            h->max_shift = h->shift[c];
+            h->arg_shift = c;
+        } else if (h->shift[c] > h->max_shift2) {
+            h->max_shift2 = h->shift[c];
+        }
+    }
+}
+
+
+static KMEANS_FORCE_INLINE int hamerly_assign_impl(hamerly_t *h, const double *x, const double *mean, int *cluster,
+                                                   int k, int dim, int ini, int fim,
+                                                   double *sum_local, int *count_local, kmeans_quad_t *quad_local) {
+    int i, c, color, flips = 0;
+    double dmin, dmin2, dx, u, l, m;
+
+    for (i = ini; i < fim; i++) {
+        int a = cluster[i];
+
+        // Atualiza os limites com o movimento dos centróides
+        u = h->upper[i] + h->shift[a];
+        l = h->lower[i] - (a == h->arg_shift ? h->max_shift2 : h->max_shift);
+        m = (h->s[a] > l) ? h->s[a] : l;
+        if (u < m) {
+            h->upper[i] = u;
+            h->lower[i] = l;
+            kmeans_accumulate(sum_local, count_local, quad_local, x + (size_t)i*dim, a, dim);
+            continue;
+        }
+
+        // Aperta o limite superior com a distância exata ao centróide atual
+        u = sqrt(kmeans_dist2(x + (size_t)i*dim, mean + (size_t)a*dim, dim));
+        if (u < m) {
+            h->upper[i] = u;
+            h->lower[i] = l;
+            kmeans_accumulate(sum_local, count_local, quad_local, x + (size_t)i*dim, a, dim);
+            continue;
+        }
+
+        // Não deu para descartar: calcula as K distâncias como no laço original
+        dmin = -1;
+        dmin2 = HUGE_VAL;
+        color = a;
+        for (c = 0; c < k; c++) {
+            dx = kmeans_dist2(x + (size_t)i*dim, mean + (size_t)c*dim, dim);
+            if (dx < dmin || dmin == -1) {
+                if (dmin != -1) dmin2 = dmin;
+                color = c;
+                dmin = dx;
+            } else if (dx < dmin2) {
+                dmin2 = dx;
+            }
+        }
+        h->upper[i] = sqrt(dmin);
+        h->lower[i] = sqrt(dmin2);
+        if (color != a) {
+            flips++;
+            cluster[i] = color;
+        }
+        kmeans_accumulate(sum_local, count_local, quad_local, x + (size_t)i*dim, color, dim);
+    }
+    return flips;
+}
+
+// Etapa de atribuição com os limites de Hamerly para os pontos [ini, fim).
+// Deve ser chamada com 's' calculado para as médias atuais e 'shift' com o
+// deslocamento desde a chamada anterior. Retorna o número de flips.
+static inline int hamerly_assign_range(hamerly_t *h, const double *x, const double *mean, int *cluster,
+                                       int k, int dim, int ini, int fim,
+                                       double *sum_local, int *count_local, kmeans_quad_t *quad_local) {
+#define HAMERLY_CHAMADA(D) return hamerly_assign_impl(h, x, mean, cluster, k, D, ini, fim, sum_local, count_local, quad_local)
+    KMEANS_DIM_DISPATCH(dim, HAMERLY_CHAMADA)
+#undef HAMERLY_CHAMADA
+}
+
+
+//  YINYANG
+//
+// Os centróides são divididos em G grupos (agrupando os centróides iniciais
+// com algumas iterações de K-Means, ver yinyang_group). Para cada ponto guardamos upper[i] e um
+// limite inferior por grupo, lower[i][g] <= d(x_i, c) para todo c do grupo g
+// exceto o centróide atribuído. Filtros, do mais barato ao mais caro:
+//   1. global: upper < min_g lower[g]           -> o ponto é pulado
+//   2. grupo:  lower[g] > melhor distância atual -> o grupo inteiro é pulado
+//   3. local:  lower_antigo[g] - shift[c] > melhor distância -> c é pulado
+// Os limites por ponto ficam no yinyang_t, indexados pelo ponto, para que
+// qualquer thread possa atribuir qualquer faixa de pontos; o rascunho e o
+// resumo dos deslocamentos ficam em um yinyang_local_t por thread.
+
+typedef struct yinyang_t {
+    int g;                    // Número de grupos
+    int g_max;                // Grupos pedidos (yinyang_group recomeça deste valor)
+    int *grupo;               // Grupo de cada centróide (K)
+    int *membros;             // Centróides ordenados por grupo (K)
+    int *inicio_grupo;        // membros[inicio_grupo[g] .. inicio_grupo[g+1]) (G+1)
+    double *shift;            // Deslocamento de cada centróide na última atualização (K)
+    double *upper;            // (N)
+    double *lower;            // (N * G), linha por ponto
+
+    // Rascunho do agrupamento inicial
+    double *centro, *soma;
+    int *cont;
+} yinyang_t;
+
+typedef struct yinyang_local_t {
+    double *shift_grupo;      // Maior deslocamento dentro de cada grupo (G), cópia da thread
+
+    // Rascunho por ponto (G cada)
+    double *lower_antigo, *min1, *min2;
+    int *arg1;
+    void *raw;                // Bloco único com os arrays acima
+} yinyang_local_t;
+
+
+// Aloca o estado compartilhado para N pontos e K centróides em (até) 'g'
+// grupos. Os valores iniciais dos limites são escritos por yinyang_reset_range,
+// depois de yinyang_group. Retorna 0 se ok, -1 se faltar memória.
+static inline int yinyang_alloc(yinyang_t *yy, int n, int k, int dim, int g) {
+    if (g < 1) g = 1;
+    if (g > k) g = k;
+    yy->g = yy->g_max = g;
+    yy->upper = (double *)malloc(sizeof(double) * (n > 0 ? n : 1));
+    yy->lower = (double *)malloc(sizeof(double) * (n > 0 ? n : 1) * g);
+    yy->grupo = (int *)malloc(sizeof(int) * k);
+    yy->membros = (int *)malloc(sizeof(int) * k);
+    yy->inicio_grupo = (int *)malloc(sizeof(int) * (g + 1));
+    yy->shift = (double *)calloc(k, sizeof(double));
+    yy->centro = (double *)malloc(sizeof(double) * g * dim);
+    yy->soma = (double *)malloc(sizeof(double) * g * dim);
+    yy->cont = (int *)malloc(sizeof(int) * g);
+    if (yy->upper == NULL || yy->lower == NULL ||
+        yy->grupo == NULL || yy->membros == NULL || yy->inicio_grupo == NULL || yy->shift == NULL ||
+        yy->centro == NULL || yy->soma == NULL || yy->cont == NULL)
+        return -1;
+    return 0;
+}
+
+
+// Divide os K centróides iniciais nos grupos com 5 iterações de K-Means
+// sobre os próprios centróides. Grupos vazios são descartados (yy->g só diminui).
+static inline void yinyang_group(yinyang_t *yy, const double *mean, int k, int dim) {
+    int c, j, t, it, gg, ng, g = yy->g = yy->g_max;
+    double *centro = yy->centro, *soma = yy->soma;
+    int *cont = yy->cont;
+
+    // Centros iniciais dos grupos: centróides espaçados uniformemente no índice
+    for (gg = 0; gg < g; gg++)
+        memcpy(centro + gg*dim, mean + (size_t)(gg * (k / g)) * dim, sizeof(double) * dim);
+
+    for (it = 0; it < 5; it++) {
+        for (c = 0; c < k; c++) {
+            double dmin = -1;
+            for (gg = 0; gg < g; gg++) {
+                double d = kmeans_dist2(mean + c*dim, centro + gg*dim, dim);
+                if (d < dmin || dmin == -1) {
+                    dmin = d;
+                    yy->grupo[c] = gg;
+                }
+            }
+        }
+        memset(soma, 0, sizeof(double) * g * dim);
+        memset(cont, 0, sizeof(int) * g);
+        for (c = 0; c < k; c++) {
+            cont[yy->grupo[c]]++;
+            for (j = 0; j < dim; j++)
+                soma[yy->grupo[c]*dim + j] += mean[c*dim + j];
+        }
+        for (gg = 0; gg < g; gg++) {
+            if (cont[gg] > 0) {
+                for (j = 0; j < dim; j++)
+                    centro[gg*dim + j] = soma[gg*dim + j] / cont[gg];
+            }
+        }
+    }
+
+    // Renumera os grupos não vazios (cont vira o novo índice) e monta a lista de membros
+    ng = 0;
+    for (gg = 0; gg < g; gg++)
+        cont[gg] = (cont[gg] > 0) ? ng++ : -1;
+    for (c = 0; c < k; c++)
+        yy->grupo[c] = cont[yy->grupo[c]];
+    yy->g = ng;
+    t = 0;
+    for (gg = 0; gg < ng; gg++) {
+        yy->inicio_grupo[gg] = t;
+        for (c = 0; c < k; c++) {
+            if (yy->grupo[c] == gg)
+                yy->membros[t++] = c;
+        }
+    }
+    yy->inicio_grupo[ng] = t;
+}
+
+static inline void yinyang_free(yinyang_t *yy) {
+    free(yy->upper);
+    free(yy->lower);
+    free(yy->grupo);
+    free(yy->membros);
+    free(yy->inicio_grupo);
+    free(yy->shift);
+    free(yy->centro);
+    free(yy->soma);
+    free(yy->cont);
+}
+
+
+// Aloca o estado de uma thread, com espaço para os grupos de yinyang_alloc.
+// Os arrays ficam em um único bloco alinhado e arredondado para linhas de
+// cache inteiras: o rascunho é escrito a cada ponto e não pode dividir uma
+// linha com o de outra thread. Retorna 0 se ok, -1 se faltar memória.
+static inline int yinyang_local_alloc(yinyang_local_t *sl, const yinyang_t *yy) {
+    size_t linha = 64, tam = ((sizeof(double) * yy->g + linha - 1) / linha) * linha;
+    char *p;
+
+    sl->raw = calloc(1, 5 * tam + linha);
+    if (sl->raw == NULL)
+        return -1;
+    p = (char *)(((uintptr_t)sl->raw + linha - 1) & ~(uintptr_t)(linha - 1));
+    sl->shift_grupo = (double *)p;
+    sl->lower_antigo = (double *)(p + tam);
+    sl->min1 = (double *)(p + 2 * tam);
+    sl->min2 = (double *)(p + 3 * tam);
+    sl->arg1 = (int *)(p + 4 * tam);
+    return 0;
+}
+
+// Limites iniciais dos pontos [ini, fim): upper = infinito e lower = 0 são
+// válidos para qualquer atribuição inicial.
+static inline void yinyang_reset_range(yinyang_t *yy, int ini, int fim) {
+    size_t i;
+    for (i = (size_t)ini; i < (size_t)fim; i++)
+        yy->upper[i] = HUGE_VAL;
+    for (i = (size_t)ini * yy->g; i < (size_t)fim * yy->g; i++)
+        yy->lower[i] = 0.0;
+}
+
+static inline void yinyang_local_free(yinyang_local_t *sl) {
+    free(sl->raw);
+}
+
+
+// Registra o deslocamento dos centróides [c_ini, c_fim) entre 'old' e 'mean'.
+static inline void yinyang_shift_range(yinyang_t *yy, const double *old, const double *mean, int dim, int c_ini, int c_fim) {
+    int c;
+    for (c = c_ini; c < c_fim; c++)
+        yy->shift[c] = sqrt(kmeans_dist2(old + c*dim, mean + c*dim, dim));
+}
+
+// Maior deslocamento de cada grupo (O(K)); chamar depois de yinyang_shift_range.
+// O resultado vai para o estado da thread: cada thread resume os deslocamentos
+// por conta própria, sem outra barreira antes da atribuição.
+static inline void yinyang_shift_summary(const yinyang_t *yy, yinyang_local_t *sl) {
+    int gg, t;
+    for (gg = 0; gg < yy->g; gg++) {
+        double m = 0.0;
+        for (t = yy->inicio_grupo[gg]; t < yy->inicio_grupo[gg + 1]; t++) {
+            if (yy->shift[yy->membros[t]] > m)
+                m = yy->shift[yy->membros[t]];
+        }
+        sl->shift_grupo[gg] = m;
+    }
+}
+
+
+static KMEANS_FORCE_INLINE int yinyang_assign_impl(yinyang_t *yy, yinyang_local_t *sl, const double *x,
+                                                   const double *mean, int *cluster, int k, int dim, int ini, int fim,
+                                                   double *sum_local, int *count_local, kmeans_quad_t *quad_local) {
+    int i, gg, t, c, flips = 0;
+    int G = yy->g;
+    (void)k;
+
+    for (i = ini; i < fim; i++) {
+        double *lb = yy->lower + (size_t)i * G;
+        const double *xi = x + (size_t)i * dim;
+        int a = cluster[i], best;
+        double u, glob = HUGE_VAL, da2, dbest2, ubest;
+
+        // Atualiza os limites com o movimento dos centróides
+        u = yy->upper[i] + yy->shift[a];
+        for (gg = 0; gg < G; gg++) {
+            sl->lower_antigo[gg] = lb[gg];
+            lb[gg] -= sl->shift_grupo[gg];
+            if (lb[gg] < glob) glob = lb[gg];
+        }
+
+        // 1. Filtro global (com o limite superior relaxado e depois o exato)
+        if (u < glob) {
+            yy->upper[i] = u;
+            kmeans_accumulate(sum_local, count_local, quad_local, xi, a, dim);
+            continue;
+        }
+        da2 = kmeans_dist2(xi, mean + (size_t)a * dim, dim);
+        u = sqrt(da2);
+        if (u < glob) {
+            yy->upper[i] = u;
+            kmeans_accumulate(sum_local, count_local, quad_local, xi, a, dim);
+            continue;
+        }
+
+        // 2. Filtro de grupo e 3. filtro local. O vencedor é o de menor
+        // distância ao quadrado e, no empate, o de menor índice (como no laço exaustivo).
+        best = a;
+        dbest2 = da2;
+        ubest = u;
+        for (gg = 0; gg < G; gg++) {
+            sl->arg1[gg] = -2; // Grupo não examinado
+            if (lb[gg] > ubest)
+                continue;
+            sl->min1[gg] = sl->min2[gg] = HUGE_VAL;
+            sl->arg1[gg] = -1;
+            for (t = yy->inicio_grupo[gg]; t < yy->inicio_grupo[gg + 1]; t++) {
+                double d2, d, limite;
+                c = yy->membros[t];
+                limite = sl->lower_antigo[gg] - yy->shift[c];
+                if (c != a && limite > ubest) {
+                    // c não pode vencer; o limite ainda vale para o novo lower[g]
+                    d = limite;
+                } else {
+                    d2 = (c == a) ? da2 : kmeans_dist2(xi, mean + (size_t)c * dim, dim);
+                    d = (c == a) ? u : sqrt(d2);
+                    if (d2 < dbest2 || (d2 == dbest2 && c < best)) {
+                        best = c;
+                        dbest2 = d2;
+                        ubest = d;
+                    }
+                }
+                if (d < sl->min1[gg]) {
+                    sl->min2[gg] = sl->min1[gg];
+                    sl->min1[gg] = d;
+                    sl->arg1[gg] = c;
+                } else if (d < sl->min2[gg]) {
+                    sl->min2[gg] = d;
+                }
+            }
+        }
+
+        // Novos limites inferiores dos grupos examinados (sem o vencedor)
+        for (gg = 0; gg < G; gg++) {
+            if (sl->arg1[gg] == -2)
+                continue;
+            lb[gg] = (sl->arg1[gg] == best) ? sl->min2[gg] : sl->min1[gg];
+        }
+        // O centróide antigo passa a ser um "outro" centróide do seu grupo
+        if (best != a && u < lb[yy->grupo[a]])
+            lb[yy->grupo[a]] = u;
+
+        yy->upper[i] = ubest;
+        if (best != a) {
+            flips++;
+            cluster[i] = best;
+        }
+        kmeans_accumulate(sum_local, count_local, quad_local, xi, best, dim);
+    }
+    return flips;
+}
+
+// Etapa de atribuição Yinyang para os pontos [ini, fim), com o rascunho da
+// thread 'sl'. Deve ser chamada com 'shift' e 'sl->shift_grupo' refletindo o
+// deslocamento desde a chamada anterior. Retorna o número de flips.
+static inline int yinyang_assign_range(yinyang_t *yy, yinyang_local_t *sl, const double *x,
+                                       const double *mean, int *cluster, int k, int dim, int ini, int fim,
+                                       double *sum_local, int *count_local, kmeans_quad_t *quad_local) {
+#define YINYANG_CHAMADA(D) return yinyang_assign_impl(yy, sl, x, mean, cluster, k, D, ini, fim, sum_local, count_local, quad_local)
+    KMEANS_DIM_DISPATCH(dim, YINYANG_CHAMADA)
+#undef YINYANG_CHAMADA
+}
+
+#endif
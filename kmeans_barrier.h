@@ -0,0 +1,227 @@
+#ifndef KMEANS_BARRIER_H
+#define KMEANS_BARRIER_H
+
+// Barreiras para as threads do K-Means, escolhidas em tempo de execução:
+//
+//   BARRIER_CONDVAR  mutex + variável de condição (a barreira original).
+//                    Toda chegada passa pelo mutex e quem espera dorme no futex.
+//   BARRIER_SPIN     contador atômico com inversão de sentido (sense-reversing).
+//                    Quem espera gira por um número limitado de voltas e só
+//                    então dorme (futex no Linux, sched_yield nos demais).
+//   BARRIER_DISSEM   barreira de disseminação: ceil(log2 T) rodadas em que cada
+//                    thread sinaliza a thread (id + 2^r) mod T e espera um sinal
+//                    em uma flag só sua. Não há nenhuma variável disputada por
+//                    todas as threads, o que escala melhor com muitos núcleos.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+#define BARRIER_CONDVAR 0
+#define BARRIER_SPIN    1
+#define BARRIER_DISSEM  2
+
+#define BARRIER_MAX_ROUNDS 16        // Disseminação: até 65536 threads
+#define BARRIER_SPIN_LIMIT 1024      // Voltas (pause) antes de dormir/ceder o núcleo
+#define BARRIER_CACHE_LINE 64
+
+// Estado por thread, ocupando linhas de cache só suas (2*16*4 + 8 + 56 = 192 bytes)
+typedef struct kbarrier_thread_t {
+    atomic_int flags[2][BARRIER_MAX_ROUNDS];  // Disseminação: sinais recebidos
+    int parity;
+    int sense;
+    char pad[BARRIER_CACHE_LINE - 2 * sizeof(int)];
+} kbarrier_thread_t;
+
+typedef struct kbarrier_t {
+    int tipo;
+    int n;               // Número de threads
+    int rounds;          // Disseminação: ceil(log2 n)
+
+    // BARRIER_CONDVAR
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int counter;
+    int geracao;         // Protege contra despertares espúrios do pthread_cond_wait
+
+    // BARRIER_SPIN (contador e sentido em linhas de cache separadas)
+    char pad0[BARRIER_CACHE_LINE];
+    atomic_int count;
+    char pad1[BARRIER_CACHE_LINE];
+    atomic_int sense;
+    atomic_int dormindo; // Threads bloqueadas no futex
+    char pad2[BARRIER_CACHE_LINE];
+
+    kbarrier_thread_t *local;   // n entradas alinhadas a linha de cache
+    void *local_raw;
+} kbarrier_t;
+
+
+// Converte o nome passado na linha de comando (-b) para BARRIER_*; -1 se inválido.
+static inline int kbarrier_parse_tipo(const char *nome) {
+    if (strcmp(nome, "condvar") == 0) return BARRIER_CONDVAR;
+    if (strcmp(nome, "spin") == 0) return BARRIER_SPIN;
+    if (strcmp(nome, "dissem") == 0) return BARRIER_DISSEM;
+    return -1;
+}
+
+static inline const char *kbarrier_nome(int tipo) {
+    static const char *nomes[] = { "condvar", "spin", "dissem" };
+    return (tipo >= 0 && tipo <= BARRIER_DISSEM) ? nomes[tipo] : "?";
+}
+
+
+static inline void kbarrier_pause(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// Bloqueia enquanto *addr == valor (ou cede o núcleo, fora do Linux).
+static inline void kbarrier_sleep(atomic_int *addr, int valor) {
+#ifdef __linux__
+    syscall(SYS_futex, (int *)addr, FUTEX_WAIT_PRIVATE, valor, NULL, NULL, 0);
+#else
+    (void)addr;
+    (void)valor;
+    sched_yield();
+#endif
+}
+
+static inline void kbarrier_wake_all(atomic_int *addr) {
+#ifdef __linux__
+    syscall(SYS_futex, (int *)addr, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+    (void)addr;
+#endif
+}
+
+
+// Inicializa a barreira para 'n' threads. Retorna 0 se ok, -1 se faltar memória.
+static inline int kbarrier_init(kbarrier_t *b, int tipo, int n) {
+    int i;
+
+    memset(b, 0, sizeof(*b));
+    b->tipo = tipo;
+    b->n = n;
+    for (b->rounds = 0; (1 << b->rounds) < n; b->rounds++)
+        ;
+
+    pthread_mutex_init(&b->mutex, NULL);
+    pthread_cond_init(&b->cond, NULL);
+    atomic_init(&b->count, n);
+    atomic_init(&b->sense, 0);
+    atomic_init(&b->dormindo, 0);
+
+    b->local_raw = malloc(sizeof(kbarrier_thread_t) * n + BARRIER_CACHE_LINE);
+    if (b->local_raw == NULL)
+        return -1;
+    b->local = (kbarrier_thread_t *)(((uintptr_t)b->local_raw + BARRIER_CACHE_LINE - 1) & ~(uintptr_t)(BARRIER_CACHE_LINE - 1));
+    for (i = 0; i < n; i++) {
+        int p, r;
+        for (p = 0; p < 2; p++)
+            for (r = 0; r < BARRIER_MAX_ROUNDS; r++)
+                atomic_init(&b->local[i].flags[p][r], 0);
+        b->local[i].parity = 0;
+        b->local[i].sense = (tipo == BARRIER_DISSEM) ? 1 : 0;
+    }
+    return 0;
+}
+
+static inline void kbarrier_destroy(kbarrier_t *b) {
+    pthread_mutex_destroy(&b->mutex);
+    pthread_cond_destroy(&b->cond);
+    free(b->local_raw);
+}
+
+
+static inline void kbarrier_wait_condvar(kbarrier_t *b) {
+    pthread_mutex_lock(&b->mutex);
+    b->counter++;
+    if (b->counter == b->n) {
+        b->counter = 0;
+        b->geracao++;
+        pthread_cond_broadcast(&b->cond);
+    } else {
+        int geracao = b->geracao;
+        while (geracao == b->geracao)
+            pthread_cond_wait(&b->cond, &b->mutex);
+    }
+    pthread_mutex_unlock(&b->mutex);
+}
+
+
+static inline void kbarrier_wait_spin(kbarrier_t *b, int id) {
+    int sense = !b->local[id].sense;
+    int voltas = 0;
+
+    b->local[id].sense = sense;
+    if (atomic_fetch_sub(&b->count, 1) == 1) {
+        // Última a chegar: rearma o contador e inverte o sentido global
+        atomic_store(&b->count, b->n);
+        atomic_store(&b->sense, sense);
+        if (atomic_load(&b->dormindo) > 0)
+            kbarrier_wake_all(&b->sense);
+        return;
+    }
+    while (atomic_load_explicit(&b->sense, memory_order_acquire) != sense) {
+        if (++voltas < BARRIER_SPIN_LIMIT) {
+            kbarrier_pause();
+        } else {
+            // Espera longa: dorme até o sentido mudar
+            atomic_fetch_add(&b->dormindo, 1);
+            while (atomic_load(&b->sense) != sense)
+                kbarrier_sleep(&b->sense, !sense);
+            atomic_fetch_sub(&b->dormindo, 1);
+            break;
+        }
+    }
+}
+
+
+static inline void kbarrier_wait_dissem(kbarrier_t *b, int id) {
+    kbarrier_thread_t *eu = &b->local[id];
+    int r, voltas;
+
+    for (r = 0; r < b->rounds; r++) {
+        kbarrier_thread_t *parceiro = &b->local[(id + (1 << r)) % b->n];
+        atomic_store_explicit(&parceiro->flags[eu->parity][r], eu->sense, memory_order_release);
+        voltas = 0;
+        while (atomic_load_explicit(&eu->flags[eu->parity][r], memory_order_acquire) != eu->sense) {
+            if (++voltas < BARRIER_SPIN_LIMIT)
+                kbarrier_pause();
+            else
+                sched_yield();
+        }
+    }
+    if (eu->parity == 1)
+        eu->sense = !eu->sense;
+    eu->parity = 1 - eu->parity;
+}
+
+
+// Espera até que as 'n' threads cheguem à barreira. 'id' é o índice da
+// thread (0..n-1), usado pelo estado local das barreiras spin e dissem.
+static inline void kbarrier_wait(kbarrier_t *b, int id) {
+    if (b->tipo == BARRIER_SPIN)
+        kbarrier_wait_spin(b, id);
+    else if (b->tipo == BARRIER_DISSEM)
+        kbarrier_wait_dissem(b, id);
+    else
+        kbarrier_wait_condvar(b);
+}
+
+#endif
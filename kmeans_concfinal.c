@@ -3,48 +3,325 @@
 #include <math.h>
 #include <time.h>       
 #include <pthread.h>    
-
-#define DIM 3
+#include <unistd.h>
+#include "kmeans_io.h"
+#include "kmeans_accel.h"
+#include "kmeans_simd.h"
+#include "kmeans_barrier.h"
+#include "kmeans_sched.h"
+#include "kmeans_numa.h"
+#include "kmeans_init.h"
+#include "kmeans_stream.h"
+#include "kmeans_stop.h"
+#include "kmeans_prof.h"
 
 // Variáveis globais de sincronização 
-pthread_mutex_t barrier_mutex;
-pthread_cond_t barrier_cond;
-int barrier_counter = 0;
+kbarrier_t barreira;    // Implementação escolhida com -b (ver kmeans_barrier.h)
+ksched_t escalonador;   // Distribuição dos pontos escolhida com -e (ver kmeans_sched.h)
 int num_threads_global; 
+kstream_t fluxo;                // Leitura em lotes dos modos -m e -o (ver kmeans_stream.h)
+kstream_lote_t *lote_atual;     // Lote em processamento (escrito pela thread 0)
+
+// Modo de predição (-A): cada thread formata os rótulos da sua fatia do lote
+// em um buffer próprio e a thread escritora grava os buffers de um lote, na
+// ordem das threads, enquanto as threads de cálculo atribuem o seguinte.
+// Os buffers se alternam entre os lotes pares e ímpares (buffer duplo).
+typedef struct predicao_t {
+    int distancias;            // -D: cada linha leva também a distância ao centróide
+    const char *formato;       // Formato da distância ("%.6f" ou, com -P, "%.17g")
+    char **buf[2];             // buf[b][t]: texto da fatia da thread t em um lote de paridade b
+    size_t *len[2];
+    int pronto[2];             // 1 = lote formatado, esperando a escritora
+    int fim;                   // Não há mais lotes: a escritora termina
+    // Escritos pela thread 0 antes da barreira de cada lote, também por
+    // paridade: com uma barreira por lote, a thread 0 já pega o lote seguinte
+    // enquanto outra thread ainda pode estar lendo o valor deste
+    kstream_lote_t *lote[2];
+    int para[2];               // Sair do laço (fim da entrada ou erro na escrita)
+    int erro;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} predicao_t;
+predicao_t predicao;
+
+// Reinícios (-R): o mesmo pool de threads roda 'total' sorteios, um depois do
+// outro, sobre os mesmos pontos; fica o de menor inércia. Escrito pela thread 0.
+// Com 'mean_melhor' NULL (sem -R nem -K) a inércia nem é calculada.
+typedef struct reinicios_t {
+    int total;
+    unsigned long long semente;   // O reinício r usa a semente + r
+    double *mean_melhor;          // Centróides finais do melhor reinício (K*DIM)
+    double melhor_inercia;
+    int melhor;
+    kstop_t melhor_parada;        // Critério e iterações do melhor reinício
+} reinicios_t;
+
+// Saída final (-l e -Q): os rótulos de cada fatia são convertidos para o
+// formato do arquivo pela própria thread (kml_preenche) e a inércia de cada
+// cluster sai da redução das somas da última iteração, com |x - centróide|^2
+// somado na atribuição (kmeans_accumulate), sem outra passada pelos pontos.
+typedef struct saida_t {
+    const char *rotulos;   // -l: arquivo de rótulos, ou NULL
+    const char *inercias;  // -Q: CSV com a inércia de cada cluster, ou NULL
+    int texto, tam;        // Formato dos rótulos (ver kml_preenche)
+    double *inercia;       // Inércia de cada cluster com as médias finais (K)
+    int *pontos;           // Pontos de cada cluster (K)
+} saida_t;
 
-// Estrutura de dados para threads
+// Estrutura de dados para threads. Cada entrada começa em uma linha de cache
+// (o array é alinhado em main) e os campos que a thread escreve durante a
+// execução ficam no fim, em uma linha só deles: as outras threads só os leem
+// depois das barreiras e nenhuma escrita divide linha com dados de outra thread.
 typedef struct thread_data_t { 
-    int id;                
+    _Alignas(BARRIER_CACHE_LINE) int id;
     int n, k;              
     int start_n, end_n;    
-    
-    int *flips_global_ptr; 
-    int flips_local;       
 
     // Ponteiros para os dados GLOBAIS
-    double *x, *mean, *sum;
-    int *cluster, *count;
+    // 'mean' e 'mean_next' se alternam a cada iteração (buffer duplo): as
+    // threads leem um enquanto a redução escreve as novas médias no outro.
+    double *x, *mean, *mean_next;
+    int *cluster;
+    double **mean_final_ptr;   // Buffer com as médias finais (escrito pela thread 0)
+    // Cópias SoA de 'mean' e 'mean_next' para o kernel de distâncias (modo Lloyd)
+    kmeans_centros_t *centros, *centros_next;
     
     // Ponteiros para dados LOCAIS da thread
     double *sum_local;
     int *count_local;
+    kmeans_quad_t *quad_local;  // &quad com -l/-Q, ou NULL
+    kmeans_quad_t quad;    // Soma de |x - centróide|^2 por cluster
+    double *soma_c;        // Rascunho de fecha_saida (DIM)
     
     struct thread_data_t *all_thread_data; 
+
+    // Modo da etapa de atribuição (ALG_*) e estado dos limites
+    int algoritmo;
+    hamerly_t *hamerly;
+    yinyang_t *yinyang;
+    yinyang_local_t yy_local;   // Rascunho Yinyang desta thread
+
+    // Inicialização dos centróides (-k), executada por todas as threads
+    kinit_t *init;
+
+    // Critérios de parada (-I, -f, -t); o resultado é gravado pela thread 0
+    kstop_t *parada;
+    reinicios_t *reinicios;
+    saida_t *saida;        // Saída final (-l, -Q); NULL sem ela
+
+    // Medição de tempo de parede por fase (-W); NULL quando desligada
+    kprof_t *prof;
+
+    // Leitura paralela da entrada texto
+    dataset_t *ds;
+
+    // Modos em lotes: pontos já vistos por centróide (mini-batch, taxa de
+    // aprendizado) ou atribuídos a ele na passada (-o), e passadas do mini-batch
+    long long *vistos;
+    int passadas;
+    double *somas_lotes;       // Modo -o: somas de cada centróide na passada (K*DIM)
+
+    // Escritos pela própria thread (linha de cache própria)
+    _Alignas(BARRIER_CACHE_LINE) int flips_local;   // Uma escrita por iteração; o laço conta em um registrador
+    double desloc_local;   // Maior deslocamento entre os centróides da fatia (só com -t)
+    double inercia_local;  // Inércia da fatia no fim de um reinício (só com -R)
+    long registros;        // Linhas de coordenadas na fatia do texto desta thread
+    int erro_leitura;
+    int cpu;               // Núcleo em que a thread se fixa (-c); -1 sem fixação
+    void *rotulos;         // Rótulos da fatia no formato do arquivo (-l)
+    size_t rotulos_len;
     
 } thread_data_t;
 
 
 // Barreira para sincronia de threads
-void barrier_wait() {
-    pthread_mutex_lock(&barrier_mutex);
-    barrier_counter++; 
-    if (barrier_counter == num_threads_global) {
-        barrier_counter = 0; 
-        pthread_cond_broadcast(&barrier_cond);
-    } else {
-        pthread_cond_wait(&barrier_cond, &barrier_mutex);
+void barrier_wait(int id) {
+    kbarrier_wait(&barreira, id);
+}
+
+
+// Barreira medida (-W): fecha a fase 'fase' e conta a espera em KPROF_BARREIRA.
+void espera_medida(thread_data_t *data, int fase) {
+    kprof_fase(data->prof, data->id, fase);
+    barrier_wait(data->id);
+    kprof_fase(data->prof, data->id, KPROF_BARREIRA);
+}
+
+
+// Etapa 0 (Paralela): cada thread converte a sua fatia da entrada texto.
+// A fatia é alinhada a quebras de linha; uma primeira passada conta as linhas
+// para que cada thread saiba o índice global do seu primeiro registro.
+// Retorna 0 se ok ou -1 (em todas as threads) se a entrada estiver malformada.
+int parse_worker_slice(thread_data_t *data) {
+    dataset_t *ds = data->ds;
+    size_t ini, fim;
+    long primeiro = 0, total = 0;
+    int t;
+
+    text_chunk(ds, data->id, num_threads_global, &ini, &fim);
+
+    // Com a fixação ligada, a thread toca primeiro as páginas da sua fatia de
+    // pontos, que as outras threads podem escrever durante a conversão
+    if (data->cpu >= 0)
+        dataset_touch_points(ds, data->start_n, data->end_n);
+
+    // 0.1 Contagem das linhas da fatia
+    data->registros = text_count_records(ds, ini, fim);
+    barrier_wait(data->id);
+
+    for (t = 0; t < num_threads_global; t++) {
+        if (t < data->id)
+            primeiro += data->all_thread_data[t].registros;
+        total += data->all_thread_data[t].registros;
+    }
+    if (total != (long)ds->k + ds->n) {
+        data->erro_leitura = 1;
+        return -1; // Todas as threads veem o mesmo total e saem juntas
+    }
+
+    // 0.2 Conversão direto para 'mean'/'x'
+    data->erro_leitura = (text_parse_records(ds, ini, fim, primeiro) != 0);
+    barrier_wait(data->id);
+
+    for (t = 0; t < num_threads_global; t++) {
+        if (data->all_thread_data[t].erro_leitura)
+            return -1;
+    }
+    return 0;
+}
+
+
+// Atribui os pontos [ini, fim) com o modo escolhido em -a e, se 'sum_local'
+// não for NULL, soma cada ponto no seu cluster (e |x - centróide|^2, com -l/-Q).
+// Retorna o número de flips.
+int atribui_pontos(thread_data_t *data, const void *pontos, const double *mean, const kmeans_centros_t *centros,
+                   int ini, int fim, double *sum_local, int *count_local) {
+    int k = data->k, dim = data->ds->dim;
+
+    if (data->algoritmo == ALG_HAMERLY)
+        return hamerly_assign_range(data->hamerly, data->x, mean, data->cluster, k, dim, ini, fim,
+                                    sum_local, count_local, data->quad_local);
+    if (data->algoritmo == ALG_YINYANG)
+        return yinyang_assign_range(data->yinyang, &data->yy_local, data->x, mean, data->cluster, k, dim, ini, fim,
+                                    sum_local, count_local, data->quad_local);
+    return kmeans_lloyd_assign_range(centros, pontos, data->cluster, ini, fim, sum_local, count_local,
+                                     data->quad_local);
+}
+
+// Soma nos arrays LOCAIS os pontos [ini, fim), já atribuídos (blocos roubados).
+void soma_pontos(thread_data_t *data, int ini, int fim, double *sum_local, int *count_local) {
+    int i, dim = data->ds->dim;
+
+    for (i = ini; i < fim; i++) {
+        if (data->ds->xf != NULL)
+            kmeans_accumulate_f(sum_local, count_local, data->quad_local, data->ds->xf + (size_t)i*dim,
+                                data->cluster[i], dim);
+        else
+            kmeans_accumulate(sum_local, count_local, data->quad_local, data->x + (size_t)i*dim, data->cluster[i], dim);
+    }
+}
+
+
+// 0.1 CENTRÓIDES INICIAIS (-k): k-means++ ou k-means|| sobre os pontos, com
+// as barreiras das threads; com -k input ficam os chutes da entrada. Em seguida
+// o estado que depende deles (grupos do Yinyang ou cópia SoA do modo Lloyd).
+// Chamada por todas as threads no início e a cada reinício. Termina sempre
+// com uma barreira, depois que cada thread zerou a sua fatia de rótulos e de
+// limites: com -e steal, outra thread pode atribuir blocos desta fatia logo
+// na primeira iteração.
+void centroides_iniciais(thread_data_t *data, int start_k, int end_k) {
+    int id = data->id;
+
+    kinit_run(data->init, id, num_threads_global, barrier_wait);
+
+    if (data->algoritmo == ALG_YINYANG) {
+        // Os grupos dependem dos centróides iniciais, que só existem após a leitura
+        if (id == 0)
+            yinyang_group(data->yinyang, data->mean, data->k, data->ds->dim);
+        barrier_wait(data->id);
+        yinyang_reset_range(data->yinyang, data->start_n, data->end_n);
+    } else if (data->algoritmo == ALG_LLOYD) {
+        // Cópia SoA dos centróides iniciais (cada thread a sua fatia de K)
+        kmeans_centros_load_range(data->centros, data->mean, start_k, end_k);
+    }
+    barrier_wait(data->id);
+}
+
+// Fim do reinício 'r' (-R): cada thread calcula a inércia da sua fatia com as
+// médias finais e a thread 0 soma as fatias (na ordem t = 0..T-1) e guarda os
+// centróides se forem os melhores até aqui. Termina com todas as threads
+// sincronizadas, antes de um novo sorteio sobrescrever 'mean'.
+void fecha_reinicio(thread_data_t *data, int r) {
+    reinicios_t *re = data->reinicios;
+    int dim = data->ds->dim;
+    double inercia;
+    int t;
+
+    // BARREIRA (médias finais publicadas pela thread 0)
+    barrier_wait(data->id);
+    data->inercia_local = kmeans_inercia_range(data->x, data->ds->xf, *data->mean_final_ptr, data->k, dim,
+                                               data->start_n, data->end_n, NULL);
+    barrier_wait(data->id);
+
+    if (data->id == 0) {
+        inercia = 0.0;
+        for (t = 0; t < num_threads_global; t++)
+            inercia += data->all_thread_data[t].inercia_local;
+        if (re->total > 1)
+            fprintf(stderr, "Reinicio %d (semente %llu): inercia %.6f, parada: %s na iteracao %d\n", r,
+                    re->semente + r, inercia, kstop_nome(data->parada->criterio), data->parada->iteracao);
+        if (r == 0 || inercia < re->melhor_inercia) {
+            re->melhor = r;
+            re->melhor_inercia = inercia;
+            re->melhor_parada = *data->parada;
+            memcpy(re->mean_melhor, *data->mean_final_ptr, sizeof(double) * data->k * dim);
+        }
+        if (r + 1 < re->total) {
+            // Os reinícios seguintes ao primeiro sorteiam todos os centróides,
+            // mesmo na varredura de K
+            kinit_semente(data->init, re->semente + r + 1);
+            data->init->k_ini = 0;
+        }
+    }
+    barrier_wait(data->id);
+}
+
+
+// Fim da execução com -l/-Q, depois da checagem de saída da última iteração:
+// cada thread reduz (na ordem t = 0..T-1) as contagens, as somas e as somas de
+// |x - origem|^2 da última atribuição para a sua fatia [start_k, end_k) de
+// centróides e calcula a inércia de cada um com as médias finais
+// 'mean_final' (as médias desses mesmos rótulos); 'origem' são os centróides
+// usados nessa atribuição. Depois converte a sua fatia de rótulos para o
+// formato do arquivo, em paralelo com as outras; a gravação fica com a main.
+void fecha_saida(thread_data_t *data, const double *mean_final, const double *origem, int start_k, int end_k) {
+    saida_t *sd = data->saida;
+    int dim = data->ds->dim;
+    int c, j, t;
+
+    for (c = start_k; c < end_k; c++) {
+        double quad = 0.0;
+        int count_c = 0;
+        for (t = 0; t < num_threads_global; t++) {
+            count_c += data->all_thread_data[t].count_local[c];
+            quad += data->all_thread_data[t].quad.soma[c];
+        }
+        for (j = 0; j < dim; j++) {
+            data->soma_c[j] = 0.0;
+            for (t = 0; t < num_threads_global; t++)
+                data->soma_c[j] += data->all_thread_data[t].sum_local[c*dim+j];
+        }
+        sd->pontos[c] = count_c;
+        sd->inercia[c] = kmeans_inercia_cluster(quad, data->soma_c, count_c, mean_final + (size_t)c * dim,
+                                                origem + (size_t)c * dim, dim);
+    }
+
+    if (sd->rotulos != NULL) {
+        data->rotulos = malloc(kml_limite(data->end_n - data->start_n, sd->texto, sd->tam) + 1);
+        if (data->rotulos != NULL)
+            data->rotulos_len = kml_preenche(data->rotulos, data->cluster, data->start_n, data->end_n,
+                                             sd->texto, sd->tam);
     }
-    pthread_mutex_unlock(&barrier_mutex);
 }
 
 
@@ -60,179 +337,1433 @@ void *kmeans_worker(void *arg) {
     
     // Ponteiros GLOBAIS
     double *x = data->x;
+    const void *pontos = (data->ds->xf != NULL) ? (const void *)data->ds->xf : (const void *)x; // Modo float
     double *mean = data->mean;
-    double *sum = data->sum;
-    int *cluster = data->cluster;
-    int *count = data->count;
+    double *mean_next = data->mean_next;
+    double *troca;
+    kmeans_centros_t *centros = data->centros;
+    kmeans_centros_t *centros_next = data->centros_next;
+    kmeans_centros_t *troca_centros;
     
     // Ponteiros LOCAIS
     double *sum_local = data->sum_local;
     int *count_local = data->count_local;
+    kmeans_quad_t *quad_local = data->quad_local;
 
-    int i, j, c;
-    double dmin, dx;
-    int color;
+    int j, c;
+    int dim = data->ds->dim;   // Número de coordenadas, lido da entrada
+    int flips_local, total_flips;
+    int iteracao = 0;            // Contínua entre reinícios (marcas dos blocos roubados)
+    int iteracao_reinicio = 0;   // Iterações do reinício atual (critérios de parada)
+    int reinicio = 0;
+    int criterio;
+    double desloc;
+    int i;
+
+    // Fatia de centróides desta thread (cálculos O(K) e O(K^2) distribuídos)
+    int start_k = k * id / num_threads_global;
+    int end_k = k * (id + 1) / num_threads_global;
+
+    // Fixação no núcleo (-c) antes da primeira escrita nos dados desta thread:
+    // as páginas da fatia de 'cluster' (e de 'x', abaixo) e dos arrays LOCAIS
+    // ficam no nó NUMA do núcleo
+    if (data->cpu >= 0 && knuma_fixa(data->cpu) != 0)
+        data->cpu = -1;
+    kprof_marca(data->prof, id);
+    for (i = start_n; i < end_n; i++)
+        data->cluster[i] = 0;
+
+    // 0. ETAPA DE LEITURA (Paralela, O(tamanho da entrada/T))
+    if (data->ds->texto != NULL) {
+        if (parse_worker_slice(data) != 0)
+            return NULL;
+    } else if (data->ds->origem != NULL) {
+        // Pontos do binário copiados (ou convertidos para float) por fatia
+        dataset_copy_points(data->ds, start_n, end_n);
+        barrier_wait(data->id);
+    }
+    kprof_fase(data->prof, id, KPROF_LEITURA);
+
+    centroides_iniciais(data, start_k, end_k);
+    kprof_fase(data->prof, id, KPROF_INICIALIZACAO);
 
     // Loop principal (até a convergência)
     while (1) {
+        iteracao++;
+        iteracao_reinicio++;
+        kprof_iteracao(data->prof, id);
         
-        // 1. ETAPA DE ATRIBUIÇÃO (Paralela, O(N*K/T)) 
-        data->flips_local = 0; 
-        for (i = start_n; i < end_n; i++) {
-            dmin = -1;
-            color = cluster[i];
-
-            for (c = 0; c < k; c++) {
-                dx = 0.0;
-                for (j = 0; j < DIM; j++)
-                    dx += (x[i*DIM+j] - mean[c*DIM+j])*(x[i*DIM+j] - mean[c*DIM+j]);
-                
-                if (dx < dmin || dmin == -1) {
-                    color = c;
-                    dmin = dx;
-                }
+        // 1. ETAPA FUNDIDA DE ATRIBUIÇÃO + SOMA LOCAL (Paralela, O(N*K/T), SEM CONTENÇÃO)
+        // Cada ponto é somado nos arrays LOCAIS logo depois de atribuído, em uma
+        // única passada pela fatia; os flips ficam em um registrador.
+        
+        // 1.1. Zera os arrays LOCAIS
+        for (c = 0; c < k; c++) {
+            count_local[c] = 0;
+            for (j = 0; j < dim; j++) {
+                sum_local[c * dim + j] = 0.0;
+            }
+            if (quad_local != NULL)
+                quad_local->soma[c] = 0.0;
+        }
+        
+        // 1.2. Atribuição e soma
+        flips_local = 0;
+        if (quad_local != NULL)
+            quad_local->origem = mean; // Distâncias aos centróides desta atribuição
+        if (data->algoritmo == ALG_HAMERLY) {
+            // Distâncias entre centróides (fatia de K desta thread)
+            hamerly_centers_range(data->hamerly, mean, k, dim, start_k, end_k);
+            
+            // BARREIRA 0 (s[] completo, só no modo Hamerly)
+            espera_medida(data, KPROF_ATRIBUICAO);
+        }
+        if (escalonador.tipo == SCHED_STEAL) {
+            // Blocos da própria fila, do início, com a soma; depois blocos
+            // roubados do fim das outras filas, só com a atribuição; por fim a
+            // soma dos blocos que as outras threads levaram desta fila.
+            int b, vitima, ini_b, fim_b;
+            while (ksched_proximo(&escalonador, id, &ini_b, &fim_b) >= 0)
+                flips_local += atribui_pontos(data, pontos, mean, centros, ini_b, fim_b, sum_local, count_local);
+            while ((b = ksched_rouba(&escalonador, id, &vitima, &ini_b, &fim_b)) >= 0) {
+                flips_local += atribui_pontos(data, pontos, mean, centros, ini_b, fim_b, NULL, NULL);
+                ksched_marca_feito(&escalonador, vitima, b, iteracao);
             }
-            if (cluster[i] != color) {
-                data->flips_local++;  
-                cluster[i] = color;   
+            for (b = escalonador.filas[id].corte; b < escalonador.filas[id].nblocos; b++) {
+                ksched_espera_feito(&escalonador, id, b, iteracao);
+                ksched_bloco_faixa(&escalonador.filas[id], b, &ini_b, &fim_b);
+                soma_pontos(data, ini_b, fim_b, sum_local, count_local);
             }
+        } else {
+            flips_local = atribui_pontos(data, pontos, mean, centros, start_n, end_n, sum_local, count_local);
         }
+        data->flips_local = flips_local;
         
-        // BARREIRA 1 (Fim da Atribuição)
-        barrier_wait();
+        // BARREIRA 1 (Fim da Atribuição e da Soma Local)
+        espera_medida(data, KPROF_ATRIBUICAO);
+        if (escalonador.tipo == SCHED_STEAL)
+            ksched_recarrega(&escalonador, id); // Ninguém mais retira blocos nesta iteração
 
-        // 2. ETAPA DE "CONTABILIDADE" (Serial, O(T+K)) 
-        if (id == 0) {
-            // 2.1. Reduzir (somar) os flips
-            int total_flips = 0;
-            for (int t = 0; t < num_threads_global; t++) {
-                total_flips += data->all_thread_data[t].flips_local;
-            }
-            *data->flips_global_ptr = total_flips; 
-
-            if (total_flips > 0) {
-                // 2.2. Zera os arrays GLOBAIS 'sum' e 'count'
-                for (c = 0; c < k; c++) {
-                    count[c] = 0;
-                    for (j = 0; j < DIM; j++) {
-                        sum[c * DIM + j] = 0.0;
+        // 2. ETAPA DE CONTABILIDADE + REDUÇÃO GLOBAL E MÉDIA (Paralela, O(T*K/T + T))
+        // 2.1. Reduzir (somar) os flips: cada thread soma os T contadores por
+        // conta própria, o que evita mais uma barreira para publicar o total.
+        total_flips = 0;
+        for (int t = 0; t < num_threads_global; t++) {
+            total_flips += data->all_thread_data[t].flips_local;
+        }
+        kprof_fase(data->prof, id, KPROF_CONTABILIDADE);
+
+        if (total_flips > 0) {
+            // 2.2 Redução Global direto para as novas médias, só para a fatia
+            // [start_k, end_k) de centróides desta thread. As somas de cada
+            // (c, j) seguem a ordem t = 0..T-1, então o resultado não depende
+            // de qual thread reduz cada centróide.
+            for (c = start_k; c < end_k; c++) {
+                int count_c = 0;
+                for (int t = 0; t < num_threads_global; t++)
+                    count_c += data->all_thread_data[t].count_local[c];
+                for (j = 0; j < dim; j++) {
+                    double sum_cj = 0.0;
+                    for (int t = 0; t < num_threads_global; t++) {
+                        thread_data_t* other_thread = &data->all_thread_data[t];
+                        if (other_thread->count_local[c] > 0)
+                            sum_cj += other_thread->sum_local[c*dim+j];
                     }
+                    // Cluster vazio mantém a média anterior
+                    mean_next[c*dim+j] = (count_c > 0) ? sum_cj / count_c : mean[c*dim+j];
                 }
-            } 
-        } 
+            }
+            
+            // 2.3 Deslocamento dos centróides da fatia (usado para relaxar os
+            // limites) ou cópia SoA da fatia para o kernel de distâncias
+            if (data->algoritmo == ALG_LLOYD)
+                kmeans_centros_load_range(centros_next, mean_next, start_k, end_k);
+            else if (data->algoritmo == ALG_HAMERLY)
+                hamerly_shift_range(data->hamerly, mean, mean_next, dim, start_k, end_k);
+            else if (data->algoritmo == ALG_YINYANG)
+                yinyang_shift_range(data->yinyang, mean, mean_next, dim, start_k, end_k);
+            if (data->parada->eps_desloc > 0.0)
+                data->desloc_local = kstop_desloc_range(mean, mean_next, dim, start_k, end_k);
+        } else if (id == 0) {
+            *data->mean_final_ptr = mean;
+        }
         
-        // BARREIRA 2 (Fim da Contabilidade)
-        barrier_wait();
+        // BARREIRA 2 (Fim da Redução)
+        espera_medida(data, KPROF_REDUCAO);
         
-        // 3. CHECAGEM DE SAÍDA (Paralela)
-        if (*data->flips_global_ptr == 0) {
-            break; // Convergiu! Sai do loop while(1)
+        // 3. CHECAGEM DE SAÍDA (Paralela): todas as threads avaliam os mesmos
+        // totais (flips e deslocamentos de todas as fatias) e saem juntas
+        desloc = HUGE_VAL;
+        if (data->parada->eps_desloc > 0.0 && total_flips > 0) {
+            desloc = 0.0;
+            for (int t = 0; t < num_threads_global; t++) {
+                if (data->all_thread_data[t].desloc_local > desloc)
+                    desloc = data->all_thread_data[t].desloc_local;
+            }
         }
+        criterio = kstop_avalia(data->parada, iteracao_reinicio, total_flips, data->n, desloc);
+        if (criterio != STOP_NONE) {
+            // Parada antecipada: as médias finais são as recém-calculadas
+            if (id == 0) {
+                if (total_flips > 0)
+                    *data->mean_final_ptr = mean_next;
+                kstop_registra(data->parada, criterio, iteracao_reinicio);
+            }
+            kprof_fase(data->prof, id, KPROF_CHECAGEM);
+            if (data->reinicios->mean_melhor == NULL) {
+                // Médias finais: as recém-calculadas ou, sem flips, as atuais
+                if (data->saida != NULL)
+                    fecha_saida(data, (total_flips > 0) ? mean_next : mean, mean, start_k, end_k);
+                break; // Sai do loop while(1)
+            }
+            fecha_reinicio(data, reinicio);
+            if (++reinicio == data->reinicios->total)
+                break;
+
+            // Próximo reinício (-R): buffers e rótulos como no início, limites
+            // da fatia recomeçados e um novo sorteio dos centróides (que só
+            // termina depois que todas as threads zeraram as suas fatias)
+            mean = data->mean;
+            mean_next = data->mean_next;
+            centros = data->centros;
+            centros_next = data->centros_next;
+            for (i = start_n; i < end_n; i++)
+                data->cluster[i] = 0;
+            if (data->algoritmo == ALG_HAMERLY)
+                hamerly_reset_range(data->hamerly, start_n, end_n);
+            centroides_iniciais(data, start_k, end_k);
+            kprof_fase(data->prof, id, KPROF_INICIALIZACAO);
+            iteracao_reinicio = 0;
+            continue;
+        }
+        
+        // 3.1 Resumo dos deslocamentos (O(K)). O do Hamerly é lido só depois
+        // da BARREIRA 0 da próxima iteração; o do Yinyang vai para a fatia.
+        if (data->algoritmo == ALG_HAMERLY && id == 0)
+            hamerly_shift_summary(data->hamerly, k);
+        else if (data->algoritmo == ALG_YINYANG)
+            yinyang_shift_summary(data->yinyang, &data->yy_local);
         
-        // 4. ETAPA DE SOMA LOCAL (Paralela, O(N/T), SEM CONTENÇÃO)
+        // 4. TROCA DOS BUFFERS DE MÉDIAS (cada thread troca as suas cópias dos ponteiros)
+        troca = mean;
+        mean = mean_next;
+        mean_next = troca;
+        troca_centros = centros;
+        centros = centros_next;
+        centros_next = troca_centros;
+        kprof_fase(data->prof, id, KPROF_CHECAGEM);
         
-        // 4.1. Zera os arrays LOCAIS
+    } // Fim do while(1)
+    
+    return NULL; 
+}
+
+
+// Função de trabalho do modo mini-batch (-m). Os pontos chegam em lotes da
+// thread leitora; cada lote é atribuído em paralelo com os centróides atuais
+// e cada centróide c anda em direção à média dos seus b pontos do lote com
+// taxa b/v, onde v é o total de pontos já atribuídos a ele: é a média
+// corrente de todos os pontos que c recebeu (taxa 1/v por ponto).
+void *kmeans_minibatch_worker(void *arg) {
+    thread_data_t *data = (thread_data_t *)arg;
+
+    int id = data->id;
+    int k = data->k;
+    int dim = fluxo.dim;
+    double *mean = data->mean;
+    kmeans_centros_t *centros = data->centros;
+    double *sum_local = data->sum_local;
+    int *count_local = data->count_local;
+    kstream_lote_t *lote;
+    int primeiro_lote = 1, passada = 0;
+    int j, c;
+
+    // Fatia de centróides desta thread (atualização distribuída)
+    int start_k = k * id / num_threads_global;
+    int end_k = k * (id + 1) / num_threads_global;
+
+    if (data->cpu >= 0 && knuma_fixa(data->cpu) != 0)
+        data->cpu = -1;
+    kmeans_centros_load_range(centros, mean, start_k, end_k);
+
+    while (1) {
+        int ini, fim;
+
+        // 1. PRÓXIMO LOTE (a thread 0 espera a leitora; no fim de uma
+        // passada, pede a próxima enquanto houver)
+        if (id == 0) {
+            lote_atual = kstream_pega(&fluxo);
+            while (lote_atual->n == 0 && ++passada < data->passadas && kstream_recomeca(&fluxo) == 0)
+                lote_atual = kstream_pega(&fluxo);
+        }
+        
+        // BARREIRA 1 (lote disponível e centróides do lote anterior atualizados)
+        barrier_wait(id);
+        lote = lote_atual;
+        if (lote->n == 0)
+            break;
+
+        // 1.1 Centróides iniciais (-k) sorteados entre os pontos do primeiro lote
+        if (primeiro_lote && data->init->metodo != INIT_INPUT) {
+            if (id == 0)
+                kinit_pontos(data->init, lote->n, lote->x, lote->xf);
+            barrier_wait(id);
+            kinit_run(data->init, id, num_threads_global, barrier_wait);
+            kmeans_centros_load_range(centros, mean, start_k, end_k);
+            barrier_wait(id);
+        }
+        primeiro_lote = 0;
+
+        // 2. ATRIBUIÇÃO + SOMA LOCAL da fatia do lote
         for (c = 0; c < k; c++) {
             count_local[c] = 0;
-            for (j = 0; j < DIM; j++) {
-                sum_local[c * DIM + j] = 0.0;
+            for (j = 0; j < dim; j++)
+                sum_local[c * dim + j] = 0.0;
+        }
+        ini = (int)((long long)lote->n * id / num_threads_global);
+        fim = (int)((long long)lote->n * (id + 1) / num_threads_global);
+        kmeans_lloyd_assign_range(centros, (lote->xf != NULL) ? (const void *)lote->xf : (const void *)lote->x,
+                                  data->cluster, ini, fim, sum_local, count_local, NULL);
+
+        // BARREIRA 2 (Fim da Atribuição): o lote volta para a leitora
+        barrier_wait(id);
+        if (id == 0)
+            kstream_devolve(&fluxo);
+
+        // 3. ATUALIZAÇÃO dos centróides da fatia [start_k, end_k), somando
+        // as threads na ordem t = 0..T-1
+        for (c = start_k; c < end_k; c++) {
+            int count_c = 0;
+            for (int t = 0; t < num_threads_global; t++)
+                count_c += data->all_thread_data[t].count_local[c];
+            if (count_c == 0)
+                continue;
+            data->vistos[c] += count_c;
+            for (j = 0; j < dim; j++) {
+                double sum_cj = 0.0;
+                for (int t = 0; t < num_threads_global; t++) {
+                    thread_data_t *other_thread = &data->all_thread_data[t];
+                    if (other_thread->count_local[c] > 0)
+                        sum_cj += other_thread->sum_local[c*dim+j];
+                }
+                mean[c*dim+j] += (sum_cj - count_c * mean[c*dim+j]) / (double)data->vistos[c];
             }
         }
-        
-        // 4.2. Soma nos arrays LOCAIS
-        for (i = start_n; i < end_n; i++) {
-            c = cluster[i]; 
-            
-            count_local[c]++;
-            for (j = 0; j < DIM; j++) {
-                sum_local[c*DIM+j] += x[i*DIM+j];
+        kmeans_centros_load_range(centros, mean, start_k, end_k);
+    }
+    return NULL;
+}
+
+
+// Função de trabalho do modo Lloyd fora da memória (-o). Cada iteração é
+// uma passada pela entrada, lida em lotes; só os centróides e o rótulo de
+// cada ponto ficam na memória. Cada lote é atribuído em paralelo (fatias de
+// pontos) e depois somado em paralelo por fatia de centróides: cada thread
+// percorre o lote inteiro na ordem dos pontos e soma só os pontos dos seus
+// centróides. Assim cada soma (c, j) segue a ordem i = 0..N-1, como na
+// versão sequencial, e os centróides finais são os mesmos dela, bit a bit,
+// para qualquer número de threads.
+void *kmeans_foradamemoria_worker(void *arg) {
+    thread_data_t *data = (thread_data_t *)arg;
+
+    int id = data->id;
+    int k = data->k;
+    int dim = fluxo.dim;
+    double *mean = data->mean;
+    double *somas = data->somas_lotes;
+    long long *contagem = data->vistos;
+    kmeans_centros_t *centros = data->centros;
+    kstream_lote_t *lote;
+    int flips_local, total_flips;
+    int iteracao = 0, criterio;
+    double desloc;
+    int i, j, c;
+
+    // Fatia de centróides desta thread (soma e média distribuídas)
+    int start_k = k * id / num_threads_global;
+    int end_k = k * (id + 1) / num_threads_global;
+
+    if (data->cpu >= 0 && knuma_fixa(data->cpu) != 0)
+        data->cpu = -1;
+    kmeans_centros_load_range(centros, mean, start_k, end_k);
+
+    while (1) {
+        int segura = 0;   // Thread 0: há um lote de dados ainda não devolvido
+
+        iteracao++;
+
+        // 1. Zera as somas da fatia de centróides
+        for (c = start_k; c < end_k; c++) {
+            contagem[c] = 0;
+            for (j = 0; j < dim; j++)
+                somas[c*dim+j] = 0.0;
+        }
+        flips_local = 0;
+
+        // 2. PASSADA PELOS LOTES
+        while (1) {
+            int ini, fim;
+            int *rotulos;
+
+            // A thread 0 pega o próximo lote; a leitora já enche o seguinte
+            if (id == 0)
+                lote_atual = kstream_pega(&fluxo);
+
+            // BARREIRA 1 (lote disponível; todas terminaram o lote anterior)
+            barrier_wait(id);
+            if (id == 0 && segura)
+                kstream_devolve(&fluxo);
+            segura = 1;
+            lote = lote_atual;
+            if (lote->n == 0)
+                break; // Fim da passada (o lote vazio fica com a thread 0)
+            rotulos = data->cluster + lote->primeiro;
+
+            // 2.1 Atribuição da fatia de pontos do lote
+            ini = (int)((long long)lote->n * id / num_threads_global);
+            fim = (int)((long long)lote->n * (id + 1) / num_threads_global);
+            flips_local += kmeans_lloyd_assign_range(centros, (lote->xf != NULL) ? (const void *)lote->xf : (const void *)lote->x,
+                                                     rotulos, ini, fim, NULL, NULL, NULL);
+
+            // BARREIRA 2 (rótulos do lote completos)
+            barrier_wait(id);
+
+            // 2.2 Soma, na ordem dos pontos, dos pontos dos centróides desta thread
+            for (i = 0; i < lote->n; i++) {
+                c = rotulos[i];
+                if (c < start_k || c >= end_k)
+                    continue;
+                contagem[c]++;
+                if (lote->xf != NULL) {
+                    const float *p = lote->xf + (size_t)i * dim;
+                    for (j = 0; j < dim; j++)
+                        somas[c*dim+j] += p[j];
+                } else {
+                    const double *p = lote->x + (size_t)i * dim;
+                    for (j = 0; j < dim; j++)
+                        somas[c*dim+j] += p[j];
+                }
             }
         }
-        
-        // BARREIRA 3 (Fim da Soma Local)
-        barrier_wait();
-        
-        // 5. ETAPA DE REDUÇÃO GLOBAL E MÉDIA (Serial, O(T*K + K)) 
-        if (id == 0) {
-            // 5.1 Redução Global (Soma os resultados de todas as threads)
-            for (int t = 0; t < num_threads_global; t++) {
-                thread_data_t* other_thread = &data->all_thread_data[t];
-                for (c = 0; c < k; c++) {
-                    if (other_thread->count_local[c] > 0) {
-                        count[c] += other_thread->count_local[c];
-                        for (j = 0; j < DIM; j++) {
-                            sum[c*DIM+j] += other_thread->sum_local[c*DIM+j];
-                        }
+        data->flips_local = flips_local;
+
+        // BARREIRA 3 (flips da passada publicados)
+        barrier_wait(id);
+        total_flips = 0;
+        for (int t = 0; t < num_threads_global; t++)
+            total_flips += data->all_thread_data[t].flips_local;
+
+        // 3. NOVAS MÉDIAS da fatia (cluster vazio mantém a média anterior),
+        // com o maior deslocamento da fatia
+        if (total_flips > 0) {
+            data->desloc_local = 0.0;
+            for (c = start_k; c < end_k; c++) {
+                double d2 = 0.0;
+                for (j = 0; j < dim; j++) {
+                    if (contagem[c] > 0) {
+                        double novo = somas[c*dim+j] / contagem[c];
+                        d2 += (novo - mean[c*dim+j]) * (novo - mean[c*dim+j]);
+                        mean[c*dim+j] = novo;
                     }
                 }
+                if (sqrt(d2) > data->desloc_local)
+                    data->desloc_local = sqrt(d2);
             }
-            
-            // 5.2 Cálculo Final da Média
-            for (c = 0; c < k; c++) {
-                if (count[c] > 0) {
-                    for (j = 0; j < DIM; j++) {
-                        mean[c*DIM+j] = sum[c*DIM+j] / count[c];
-                    }
+            kmeans_centros_load_range(centros, mean, start_k, end_k);
+            // Volta ao primeiro ponto, a menos que o laço já vá parar pelos
+            // flips ou pelas iterações (o deslocamento só é conhecido depois
+            // da barreira; parar por ele deixa uma releitura pendente)
+            if (id == 0 && kstop_avalia(data->parada, iteracao, total_flips, fluxo.n, HUGE_VAL) == STOP_NONE)
+                kstream_recomeca(&fluxo);
+        }
+
+        // BARREIRA 4 (Fim da Redução)
+        barrier_wait(id);
+        if (fluxo.erro)
+            break;
+        desloc = HUGE_VAL;
+        if (data->parada->eps_desloc > 0.0 && total_flips > 0) {
+            desloc = 0.0;
+            for (int t = 0; t < num_threads_global; t++) {
+                if (data->all_thread_data[t].desloc_local > desloc)
+                    desloc = data->all_thread_data[t].desloc_local;
+            }
+        }
+        if ((criterio = kstop_avalia(data->parada, iteracao, total_flips, fluxo.n, desloc)) != STOP_NONE) {
+            if (id == 0)
+                kstop_registra(data->parada, criterio, iteracao);
+            break;
+        }
+    }
+    return NULL;
+}
+
+
+// Modos em lotes: K-Means sobre a entrada lida em lotes de 'lote' pontos,
+// com memória limitada aos 2 lotes (mais um rótulo por ponto no modo -o).
+// 'exato' escolhe o Lloyd fora da memória (-o, até convergir); senão é o
+// mini-batch (-m), com 'passadas' passadas.
+int executa_lotes(const char *entrada, int num_threads, int lote, int exato, int passadas, int tipo_barreira,
+                  int politica, int kernel, int precisao, int metodo_init, unsigned long long semente,
+                  kstop_t *parada, const char *formato) {
+    int i, j, k, dim;
+    int *cluster, *cpus = NULL;
+    size_t rotulos;
+    long long *vistos;
+    double *somas = NULL;
+    kmeans_centros_t centros = {0};
+    knuma_topologia_t topologia = {0};
+    kinit_t init = {0};
+    pthread_t *threads;
+    thread_data_t *thread_data;
+    void *thread_data_raw;
+    clock_t inicio = clock(), fim;
+
+    if (num_threads <= 0) {
+        fprintf(stderr, "Erro: Numero de threads deve ser positivo (maior que 0).\n");
+        return 1;
+    }
+    if (kstream_open(entrada, &fluxo) != 0 ||
+        kstream_start(&fluxo, lote, precisao == PRECISAO_FLOAT) != 0) {
+        kstream_fecha(&fluxo);
+        return 1;
+    }
+    k = fluxo.k;
+    dim = fluxo.dim;
+    precisao = fluxo.precisao_float ? PRECISAO_FLOAT : PRECISAO_DOUBLE;
+    num_threads_global = num_threads;
+
+    if (exato)
+        fprintf(stderr, "Iniciando K-Means fora da memoria com %d threads (lotes de %d pontos, N = %lld, barreira %s, kernel %s, pontos em %s)\n",
+                num_threads, lote, fluxo.n, kbarrier_nome(tipo_barreira), kmeans_kernel_nome(kernel),
+                precisao == PRECISAO_FLOAT ? "float" : "double");
+    else
+        fprintf(stderr, "Iniciando K-Means mini-batch com %d threads (lotes de %d pontos, %d passada(s), N = %lld, barreira %s, kernel %s, pontos em %s, inicializacao %s)\n",
+                num_threads, lote, passadas, fluxo.n, kbarrier_nome(tipo_barreira), kmeans_kernel_nome(kernel),
+                precisao == PRECISAO_FLOAT ? "float" : "double", kinit_nome(metodo_init));
+
+    // Rótulos: um por ponto no modo -o (zerados, como na versão sequencial),
+    // só os do lote no mini-batch
+    rotulos = exato ? (size_t)fluxo.n : (size_t)lote;
+    cluster = (int *)calloc(rotulos > 0 ? rotulos : 1, sizeof(int));
+    vistos = (long long *)calloc(k, sizeof(long long));
+    if (exato)
+        somas = (double *)malloc(sizeof(double) * k * dim);
+    threads = (pthread_t *)malloc(num_threads * sizeof(pthread_t));
+    thread_data_raw = malloc(num_threads * sizeof(thread_data_t) + BARRIER_CACHE_LINE);
+    if (cluster == NULL || vistos == NULL || threads == NULL || thread_data_raw == NULL || (exato && somas == NULL) ||
+        kmeans_centros_alloc(&centros, k, dim, kernel, precisao) != 0 ||
+        kinit_alloc(&init, metodo_init, semente, lote, k, dim, NULL, NULL, fluxo.mean, num_threads) != 0) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para o modo em lotes\n");
+        return 1;
+    }
+    thread_data = (thread_data_t *)(((uintptr_t)thread_data_raw + BARRIER_CACHE_LINE - 1) & ~(uintptr_t)(BARRIER_CACHE_LINE - 1));
+    if (kbarrier_init(&barreira, tipo_barreira, num_threads) != 0) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para a barreira\n");
+        return 1;
+    }
+    if (politica != PIN_NONE) {
+        cpus = (int *)malloc(sizeof(int) * num_threads);
+        if (cpus == NULL || knuma_topologia(&topologia) != 0) {
+            fprintf(stderr, "Erro: Falha ao alocar memoria para a topologia\n");
+            return 1;
+        }
+        knuma_plano(&topologia, politica, num_threads, cpus);
+    }
+
+    for (i = 0; i < num_threads; i++) {
+        memset(&thread_data[i], 0, sizeof(thread_data_t));
+        thread_data[i].id = i;
+        thread_data[i].k = k;
+        thread_data[i].mean = fluxo.mean;
+        thread_data[i].cluster = cluster;
+        thread_data[i].centros = &centros;
+        thread_data[i].all_thread_data = thread_data;
+        thread_data[i].init = &init;
+        thread_data[i].vistos = vistos;
+        thread_data[i].passadas = passadas;
+        thread_data[i].somas_lotes = somas;
+        thread_data[i].parada = parada;
+        thread_data[i].cpu = (cpus != NULL) ? cpus[i] : -1;
+        thread_data[i].sum_local = (double *)kmeans_pages_alloc(sizeof(double) * k * dim);
+        thread_data[i].count_local = (int *)kmeans_pages_alloc(sizeof(int) * k);
+        if (thread_data[i].sum_local == NULL || thread_data[i].count_local == NULL) {
+            fprintf(stderr, "Erro: Falha ao alocar memoria local para a thread %d\n", i);
+            return 1;
+        }
+        pthread_create(&threads[i], NULL, exato ? kmeans_foradamemoria_worker : kmeans_minibatch_worker,
+                       (void *)&thread_data[i]);
+    }
+    for (i = 0; i < num_threads; i++)
+        pthread_join(threads[i], NULL);
+    if (fluxo.erro) {
+        kstream_fecha(&fluxo);
+        return 1;
+    }
+    if (exato)
+        kstop_relatorio(parada);
+
+    for (i = 0; i < k; i++) {
+        for (j = 0; j < dim; j++)
+            printf(formato, fluxo.mean[i*dim+j]);
+        printf("\n");
+    }
+
+    fim = clock();
+    fprintf(stderr, "Pontos processados: %lld (memoria dos lotes: %zu bytes, rotulos: %zu bytes)\n", fluxo.lidos,
+            2 * (size_t)lote * dim * (precisao == PRECISAO_FLOAT ? sizeof(float) : sizeof(double)), sizeof(int) * rotulos);
+    fprintf(stderr, "Tempo de CPU total (Opcao 2, %s): %f segundos\n", exato ? "fora da memoria" : "mini-batch",
+            (double)(fim - inicio) / CLOCKS_PER_SEC);
+
+    kstream_fecha(&fluxo);
+    kbarrier_destroy(&barreira);
+    kmeans_centros_free(&centros);
+    kinit_free(&init);
+    for (i = 0; i < num_threads; i++) {
+        kmeans_pages_free(thread_data[i].sum_local, sizeof(double) * k * dim);
+        kmeans_pages_free(thread_data[i].count_local, sizeof(int) * k);
+    }
+    if (politica != PIN_NONE) {
+        knuma_topologia_free(&topologia);
+        free(cpus);
+    }
+    free(cluster);
+    free(vistos);
+    free(somas);
+    free(threads);
+    free(thread_data_raw);
+    return 0;
+}
+
+// Tempo de parede em segundos (tabela da varredura de K).
+double relogio(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+// Varredura de K (-K k_min:k_max:passo): os pontos são lidos uma vez e o
+// mesmo pool de threads agrupa o dataset para K = k_min, k_min + passo, ...,
+// k_max. Cada K parte da solução do anterior (warm start: os centróides do K
+// anterior e os novos sorteados com k-means++ a partir deles, ver
+// kmeans_init.h); o primeiro K usa o método de -k. Com -R, cada K roda os
+// reinícios e fica o de menor inércia. O stdout recebe uma tabela CSV com K,
+// iterações, critério de parada, inércia e tempo de parede de cada K.
+int executa_varredura(const char *entrada, int num_threads, int k_min, int k_max, int passo, int algoritmo,
+                      int grupos, int tipo_barreira, int tipo_sched, int politica, int kernel, int precisao,
+                      int metodo_init, unsigned long long semente, int total_reinicios, kstop_t *parada) {
+    int i, k, k_ant = 0, n, dim;
+    double *mean, *mean_next, *mean_final, inicio, t0;
+    int *cluster, *cpus = NULL;
+    dataset_t ds;
+    hamerly_t hamerly;
+    yinyang_t yinyang;
+    kmeans_centros_t centros[2] = {{0}};
+    knuma_topologia_t topologia = {0};
+    kinit_t init = {0};
+    reinicios_t reinicios = {0};
+    pthread_t *threads;
+    thread_data_t *thread_data;
+    void *thread_data_raw;
+
+    if (num_threads <= 0) {
+        fprintf(stderr, "Erro: Numero de threads deve ser positivo (maior que 0).\n");
+        return 1;
+    }
+    inicio = relogio();
+    if (dataset_open(entrada, &ds) != 0)
+        return 1;
+    if ((precisao = kmeans_dataset_precisao(&ds, precisao, algoritmo)) < 0 ||
+        (politica != PIN_NONE && dataset_private_points(&ds) != 0)) {
+        dataset_free(&ds);
+        return 1;
+    }
+    n = ds.n;
+    dim = ds.dim;
+    if (k_max > n) {
+        fprintf(stderr, "Erro: a varredura vai ate K = %d, mas a entrada tem %d pontos.\n", k_max, n);
+        dataset_free(&ds);
+        return 1;
+    }
+    num_threads_global = num_threads;
+
+    // Os chutes da entrada servem a um K só: a varredura sorteia o primeiro K
+    if (metodo_init == INIT_INPUT)
+        metodo_init = INIT_KMEANSPP;
+
+    fprintf(stderr, "Iniciando varredura de K = %d a %d (passo %d) com %d threads (barreira %s, escalonamento %s, kernel %s, pontos em %s, inicializacao %s, %d reinicio(s) por K)\n",
+            k_min, k_max, passo, num_threads, kbarrier_nome(tipo_barreira), ksched_nome(tipo_sched),
+            kmeans_kernel_nome(kernel), precisao == PRECISAO_FLOAT ? "float" : "double", kinit_nome(metodo_init),
+            total_reinicios);
+
+    // Buffers para o maior K; cada K usa as primeiras linhas
+    mean = (double *)malloc(sizeof(double) * k_max * dim);
+    mean_next = (double *)malloc(sizeof(double) * k_max * dim);
+    reinicios.mean_melhor = (double *)malloc(sizeof(double) * k_max * dim);
+    reinicios.total = total_reinicios;
+    reinicios.semente = semente;
+    cluster = (int *)kmeans_pages_alloc(sizeof(int) * n);
+    threads = (pthread_t *)malloc(num_threads * sizeof(pthread_t));
+    thread_data_raw = malloc(num_threads * sizeof(thread_data_t) + BARRIER_CACHE_LINE);
+    if (mean == NULL || mean_next == NULL || reinicios.mean_melhor == NULL || cluster == NULL || threads == NULL ||
+        thread_data_raw == NULL || (algoritmo == ALG_HAMERLY && hamerly_alloc(&hamerly, n, k_max) != 0) ||
+        kinit_alloc(&init, metodo_init, semente, n, k_min, dim, ds.x, ds.xf, mean, num_threads) != 0) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para a varredura de K\n");
+        return 1;
+    }
+    thread_data = (thread_data_t *)(((uintptr_t)thread_data_raw + BARRIER_CACHE_LINE - 1) & ~(uintptr_t)(BARRIER_CACHE_LINE - 1));
+    if (kbarrier_init(&barreira, tipo_barreira, num_threads) != 0) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para a barreira\n");
+        return 1;
+    }
+    if (politica != PIN_NONE) {
+        cpus = (int *)malloc(sizeof(int) * num_threads);
+        if (cpus == NULL || knuma_topologia(&topologia) != 0) {
+            fprintf(stderr, "Erro: Falha ao alocar memoria para a topologia\n");
+            return 1;
+        }
+        knuma_plano(&topologia, politica, num_threads, cpus);
+    }
+
+    // Campos que não mudam com K (os arrays LOCAIS têm espaço para k_max)
+    for (i = 0; i < num_threads; i++) {
+        memset(&thread_data[i], 0, sizeof(thread_data_t));
+        thread_data[i].id = i;
+        thread_data[i].n = n;
+        thread_data[i].start_n = i * (n / num_threads);
+        thread_data[i].end_n = (i == num_threads - 1) ? n : (i + 1) * (n / num_threads);
+        thread_data[i].x = ds.x;
+        thread_data[i].mean = mean;
+        thread_data[i].mean_next = mean_next;
+        thread_data[i].cluster = cluster;
+        thread_data[i].mean_final_ptr = &mean_final;
+        thread_data[i].centros = &centros[0];
+        thread_data[i].centros_next = &centros[1];
+        thread_data[i].all_thread_data = thread_data;
+        thread_data[i].algoritmo = algoritmo;
+        thread_data[i].hamerly = &hamerly;
+        thread_data[i].yinyang = &yinyang;
+        thread_data[i].init = &init;
+        thread_data[i].parada = parada;
+        thread_data[i].reinicios = &reinicios;
+        thread_data[i].cpu = (cpus != NULL) ? cpus[i] : -1;
+        thread_data[i].ds = &ds;
+        thread_data[i].sum_local = (double *)kmeans_pages_alloc(sizeof(double) * k_max * dim);
+        thread_data[i].count_local = (int *)kmeans_pages_alloc(sizeof(int) * k_max);
+        if (thread_data[i].sum_local == NULL || thread_data[i].count_local == NULL) {
+            fprintf(stderr, "Erro: Falha ao alocar memoria local para a thread %d\n", i);
+            return 1;
+        }
+    }
+
+    printf("k,iteracoes,parada,inercia,tempo_s\n");
+    for (k = k_min; k <= k_max; k += passo) {
+        t0 = relogio();
+
+        // Estado que depende de K
+        if (algoritmo == ALG_LLOYD &&
+            (kmeans_centros_alloc(&centros[0], k, dim, kernel, precisao) != 0 ||
+             kmeans_centros_alloc(&centros[1], k, dim, kernel, precisao) != 0)) {
+            fprintf(stderr, "Erro: Falha ao alocar memoria para os centroides\n");
+            return 1;
+        }
+        if (algoritmo == ALG_HAMERLY)
+            hamerly_reset_range(&hamerly, 0, n);
+        if (algoritmo == ALG_YINYANG && yinyang_alloc(&yinyang, n, k, dim, grupos > 0 ? grupos : k / 10) != 0) {
+            fprintf(stderr, "Erro: Falha ao alocar memoria para os limites do Yinyang\n");
+            return 1;
+        }
+        if (ksched_init(&escalonador, tipo_sched, num_threads) != 0) {
+            fprintf(stderr, "Erro: Falha ao alocar memoria para o escalonador\n");
+            return 1;
+        }
+
+        // Warm start: os centróides do K anterior ficam nas primeiras linhas
+        // de 'mean' e só os novos são sorteados
+        if (k_ant > 0)
+            memcpy(mean, reinicios.mean_melhor, sizeof(double) * k_ant * dim);
+        init.k = k;
+        init.k_ini = k_ant;
+        kinit_semente(&init, semente);
+        parada->criterio = STOP_NONE;
+        mean_final = mean;
+
+        for (i = 0; i < num_threads; i++) {
+            thread_data[i].k = k;
+            thread_data[i].flips_local = 0;
+            if (algoritmo == ALG_YINYANG && yinyang_local_alloc(&thread_data[i].yy_local, &yinyang) != 0) {
+                fprintf(stderr, "Erro: Falha ao alocar o rascunho do Yinyang para a thread %d\n", i);
+                return 1;
+            }
+            if (tipo_sched == SCHED_STEAL &&
+                ksched_fila_init(&escalonador, i, thread_data[i].start_n, thread_data[i].end_n,
+                                 ksched_bloco_pontos(dim, precisao == PRECISAO_FLOAT ? sizeof(float) : sizeof(double))) != 0) {
+                fprintf(stderr, "Erro: Falha ao alocar a fila de blocos da thread %d\n", i);
+                return 1;
+            }
+            pthread_create(&threads[i], NULL, kmeans_worker, (void *)&thread_data[i]);
+        }
+        for (i = 0; i < num_threads; i++)
+            pthread_join(threads[i], NULL);
+        for (i = 0; i < num_threads; i++) {
+            if (thread_data[i].erro_leitura) {
+                fprintf(stderr, "Erro: entrada texto deve ter %ld linhas com %d coordenadas.\n", (long)ds.k + n, dim);
+                return 1;
+            }
+        }
+        dataset_text_release(&ds); // Só o primeiro K converte a entrada
+
+        printf("%d,%d,%s,%.6f,%.6f\n", k, reinicios.melhor_parada.iteracao, kstop_nome(reinicios.melhor_parada.criterio),
+               reinicios.melhor_inercia, relogio() - t0);
+        fflush(stdout);
+
+        if (algoritmo == ALG_LLOYD) {
+            kmeans_centros_free(&centros[0]);
+            kmeans_centros_free(&centros[1]);
+        }
+        if (algoritmo == ALG_YINYANG) {
+            for (i = 0; i < num_threads; i++)
+                yinyang_local_free(&thread_data[i].yy_local);
+            yinyang_free(&yinyang);
+        }
+        ksched_destroy(&escalonador);
+        k_ant = k;
+    }
+    fprintf(stderr, "Tempo de parede total (varredura de K, leitura inclusa): %f segundos\n", relogio() - inicio);
+
+    dataset_free(&ds);
+    kbarrier_destroy(&barreira);
+    kinit_free(&init);
+    if (algoritmo == ALG_HAMERLY)
+        hamerly_free(&hamerly);
+    for (i = 0; i < num_threads; i++) {
+        kmeans_pages_free(thread_data[i].sum_local, sizeof(double) * k_max * dim);
+        kmeans_pages_free(thread_data[i].count_local, sizeof(int) * k_max);
+    }
+    if (politica != PIN_NONE) {
+        knuma_topologia_free(&topologia);
+        free(cpus);
+    }
+    kmeans_pages_free(cluster, sizeof(int) * n);
+    free(mean);
+    free(mean_next);
+    free(reinicios.mean_melhor);
+    free(threads);
+    free(thread_data_raw);
+    return 0;
+}
+
+
+// Centróides para o modo de predição: um por linha (a saída deste programa),
+// com DIM igual ao número de coordenadas da primeira linha. Retorna o array
+// K*DIM (malloc) ou NULL em caso de erro (mensagem já impressa).
+double *le_centroides(const char *path, int *k, int *dim) {
+    kstream_t s;
+    double *mean = NULL;
+    const char *linha, *fim;
+    int cap = 0, r;
+
+    *k = *dim = 0;
+    if (kstream_abre(path, &s) != 0) {
+        kstream_fecha(&s);
+        return NULL;
+    }
+    while ((linha = kstream_linha(&s, &fim)) != NULL) {
+        if (*dim == 0) {
+            dataset_t v;
+            memset(&v, 0, sizeof(v));
+            v.texto = linha;
+            v.texto_len = (size_t)(fim - linha);
+            if ((*dim = text_count_fields(&v, 0)) == 0)
+                continue; // Linha em branco
+        }
+        if (*k == cap) {
+            double *novo;
+            cap = (cap > 0) ? cap * 2 : 64;
+            novo = (double *)realloc(mean, sizeof(double) * (size_t)cap * *dim);
+            if (novo == NULL) {
+                fprintf(stderr, "Erro: Falha ao alocar memoria para os centroides\n");
+                break;
+            }
+            mean = novo;
+        }
+        r = kstream_registro(linha, fim, *dim, mean + (size_t)*k * *dim, NULL);
+        if (r < 0) {
+            fprintf(stderr, "Erro: o centroide %d de '%s' nao tem %d coordenadas.\n", *k + 1, path, *dim);
+            break;
+        }
+        *k += r;
+    }
+    if (linha != NULL || s.erro || *k == 0) {
+        if (linha == NULL)
+            fprintf(stderr, "Erro: '%s' nao tem centroides.\n", path);
+        free(mean);
+        mean = NULL;
+    }
+    kstream_fecha(&s);
+    return mean;
+}
+
+
+// Função de trabalho do modo de predição (-A). Os centróides não mudam: cada
+// lote da leitora é dividido entre as threads, que atribuem a sua fatia com
+// o kernel do modo Lloyd e formatam os rótulos (e as distâncias, com -D) em
+// um buffer próprio. Uma barreira por lote: depois dela, a thread 0 devolve
+// o lote anterior à leitora e entrega os seus buffers à escritora, então a
+// leitura do próximo lote, a atribuição deste e a escrita do anterior se sobrepõem.
+void *kmeans_predicao_worker(void *arg) {
+    thread_data_t *data = (thread_data_t *)arg;
+
+    int id = data->id;
+    int k = data->k;
+    int dim = fluxo.dim;
+    const double *mean = data->mean;
+    kmeans_centros_t *centros = data->centros;
+    int *rotulo = data->cluster;
+    kstream_lote_t *lote;
+    int b = 0, segura = 0;
+    int i, j;
+
+    if (data->cpu >= 0 && knuma_fixa(data->cpu) != 0)
+        data->cpu = -1;
+    kmeans_centros_load_range(centros, mean, k * id / num_threads_global, k * (id + 1) / num_threads_global);
+
+    while (1) {
+        int ini, fim;
+        char *out;
+        size_t len = 0;
+
+        // 1. PRÓXIMO LOTE: a thread 0 espera a escritora terminar os buffers
+        // desta paridade (os do lote de 2 atrás) e a leitora encher o lote
+        if (id == 0) {
+            pthread_mutex_lock(&predicao.mutex);
+            while (predicao.pronto[b] && !predicao.erro)
+                pthread_cond_wait(&predicao.cond, &predicao.mutex);
+            predicao.para[b] = predicao.erro;
+            pthread_mutex_unlock(&predicao.mutex);
+            predicao.lote[b] = kstream_pega(&fluxo);
+            if (predicao.lote[b]->n == 0)
+                predicao.para[b] = 1;
+        }
+
+        // BARREIRA (lote disponível, lote anterior formatado por todas as
+        // threads; centróides carregados na primeira vez)
+        barrier_wait(id);
+        lote = predicao.lote[b];
+
+        // A thread 0 devolve o lote anterior à leitora e entrega os seus buffers à escritora
+        if (id == 0 && segura) {
+            kstream_devolve(&fluxo);
+            pthread_mutex_lock(&predicao.mutex);
+            predicao.pronto[b ^ 1] = 1;
+            pthread_cond_broadcast(&predicao.cond);
+            pthread_mutex_unlock(&predicao.mutex);
+        }
+        segura = 1;
+        if (predicao.para[b])
+            break;
+
+        // 2. ATRIBUIÇÃO da fatia do lote
+        ini = (int)((long long)lote->n * id / num_threads_global);
+        fim = (int)((long long)lote->n * (id + 1) / num_threads_global);
+        kmeans_lloyd_assign_range(centros, (lote->xf != NULL) ? (const void *)lote->xf : (const void *)lote->x,
+                                  rotulo, ini, fim, NULL, NULL, NULL);
+
+        // 3. FORMATAÇÃO: uma linha por ponto
+        out = predicao.buf[b][id];
+        for (i = ini; i < fim; i++) {
+            len += (size_t)kml_escreve_rotulo(out + len, rotulo[i]);
+            if (predicao.distancias) {
+                const double *c = mean + (size_t)rotulo[i] * dim;
+                double d2 = 0.0, d;
+                int r;
+                for (j = 0; j < dim; j++) {
+                    d = ((lote->xf != NULL) ? (double)lote->xf[(size_t)i * dim + j] : lote->x[(size_t)i * dim + j]) - c[j];
+                    d2 += d * d;
                 }
+                out[len++] = ' ';
+                r = snprintf(out + len, 32, predicao.formato, sqrt(d2));
+                if (r >= 32) // Distância enorme: "%f" não cabe na linha
+                    r = snprintf(out + len, 32, "%.17g", sqrt(d2));
+                len += (size_t)r;
             }
+            out[len++] = '\n';
         }
-        
-        // BARREIRA 4 (Fim da Média)
-        barrier_wait();
-        
-    } // Fim do while(1)
-    
-    return NULL; 
+        predicao.len[b][id] = len;
+        b ^= 1;
+    }
+    return NULL;
+}
+
+// Thread escritora do modo de predição: grava os lotes formatados, na ordem.
+void *kmeans_predicao_escritor(void *arg) {
+    int num_threads = *(int *)arg;
+    int b = 0, t, ok;
+
+    while (1) {
+        pthread_mutex_lock(&predicao.mutex);
+        while (!predicao.pronto[b] && !predicao.fim)
+            pthread_cond_wait(&predicao.cond, &predicao.mutex);
+        if (!predicao.pronto[b]) {
+            pthread_mutex_unlock(&predicao.mutex);
+            break;
+        }
+        pthread_mutex_unlock(&predicao.mutex);
+
+        ok = 1;
+        for (t = 0; t < num_threads && ok; t++)
+            ok = (fwrite(predicao.buf[b][t], 1, predicao.len[b][t], stdout) == predicao.len[b][t]);
+
+        pthread_mutex_lock(&predicao.mutex);
+        predicao.pronto[b] = 0;
+        if (!ok)
+            predicao.erro = 1;
+        pthread_cond_broadcast(&predicao.cond);
+        pthread_mutex_unlock(&predicao.mutex);
+        b ^= 1;
+    }
+    return NULL;
+}
+
+// Modo de predição (-A): rotula os pontos de 'entrada' (ou do stdin) com o
+// centróide mais próximo dentre os de 'arquivo_centroides', lidos uma vez.
+// O stdout recebe uma linha por ponto, na ordem da entrada: o índice do
+// centróide (0 a K-1) e, com 'distancias', a distância até ele.
+int executa_predicao(const char *arquivo_centroides, const char *entrada, int num_threads, int lote,
+                     int distancias, int tipo_barreira, int politica, int kernel, int precisao, int todos_digitos) {
+    int i, b, k, dim;
+    int *rotulo, *cpus = NULL;
+    double *mean;
+    size_t cap;
+    kmeans_centros_t centros = {0};
+    knuma_topologia_t topologia = {0};
+    pthread_t *threads, escritor;
+    thread_data_t *thread_data;
+    void *thread_data_raw;
+    clock_t inicio = clock(), fim;
+    double inicio_parede = relogio(), tempo;
+
+    if (num_threads <= 0) {
+        fprintf(stderr, "Erro: Numero de threads deve ser positivo (maior que 0).\n");
+        return 1;
+    }
+    if ((mean = le_centroides(arquivo_centroides, &k, &dim)) == NULL)
+        return 1;
+    if (kstream_open_pontos(entrada, &fluxo, dim) != 0 ||
+        kstream_start(&fluxo, lote, precisao == PRECISAO_FLOAT) != 0) {
+        kstream_fecha(&fluxo);
+        free(mean);
+        return 1;
+    }
+    precisao = fluxo.precisao_float ? PRECISAO_FLOAT : PRECISAO_DOUBLE;
+    num_threads_global = num_threads;
+
+    fprintf(stderr, "Iniciando predicao com %d threads (K = %d, DIM = %d, lotes de %d pontos, barreira %s, kernel %s, pontos em %s)\n",
+            num_threads, k, dim, lote, kbarrier_nome(tipo_barreira), kmeans_kernel_nome(kernel),
+            precisao == PRECISAO_FLOAT ? "float" : "double");
+
+    // Buffers de saída: a maior fatia, com o rótulo e a distância de cada ponto
+    memset(&predicao, 0, sizeof(predicao));
+    predicao.distancias = distancias;
+    predicao.formato = todos_digitos ? "%.17g" : "%.6f";
+    cap = (size_t)(lote / num_threads + 1) * (12 + (distancias ? 33 : 0));
+    rotulo = (int *)calloc(lote, sizeof(int));
+    threads = (pthread_t *)malloc(num_threads * sizeof(pthread_t));
+    thread_data_raw = malloc(num_threads * sizeof(thread_data_t) + BARRIER_CACHE_LINE);
+    if (rotulo == NULL || threads == NULL || thread_data_raw == NULL ||
+        kmeans_centros_alloc(&centros, k, dim, kernel, precisao) != 0) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para o modo de predicao\n");
+        return 1;
+    }
+    for (b = 0; b < 2; b++) {
+        predicao.buf[b] = (char **)calloc(num_threads, sizeof(char *));
+        predicao.len[b] = (size_t *)calloc(num_threads, sizeof(size_t));
+        if (predicao.buf[b] == NULL || predicao.len[b] == NULL) {
+            fprintf(stderr, "Erro: Falha ao alocar memoria para o modo de predicao\n");
+            return 1;
+        }
+        for (i = 0; i < num_threads; i++) {
+            if ((predicao.buf[b][i] = (char *)kmeans_pages_alloc(cap)) == NULL) {
+                fprintf(stderr, "Erro: Falha ao alocar memoria local para a thread %d\n", i);
+                return 1;
+            }
+        }
+    }
+    pthread_mutex_init(&predicao.mutex, NULL);
+    pthread_cond_init(&predicao.cond, NULL);
+    thread_data = (thread_data_t *)(((uintptr_t)thread_data_raw + BARRIER_CACHE_LINE - 1) & ~(uintptr_t)(BARRIER_CACHE_LINE - 1));
+    if (kbarrier_init(&barreira, tipo_barreira, num_threads) != 0) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para a barreira\n");
+        return 1;
+    }
+    if (politica != PIN_NONE) {
+        cpus = (int *)malloc(sizeof(int) * num_threads);
+        if (cpus == NULL || knuma_topologia(&topologia) != 0) {
+            fprintf(stderr, "Erro: Falha ao alocar memoria para a topologia\n");
+            return 1;
+        }
+        knuma_plano(&topologia, politica, num_threads, cpus);
+    }
+
+    pthread_create(&escritor, NULL, kmeans_predicao_escritor, &num_threads);
+    for (i = 0; i < num_threads; i++) {
+        memset(&thread_data[i], 0, sizeof(thread_data_t));
+        thread_data[i].id = i;
+        thread_data[i].k = k;
+        thread_data[i].mean = mean;
+        thread_data[i].cluster = rotulo;
+        thread_data[i].centros = &centros;
+        thread_data[i].all_thread_data = thread_data;
+        thread_data[i].cpu = (cpus != NULL) ? cpus[i] : -1;
+        pthread_create(&threads[i], NULL, kmeans_predicao_worker, (void *)&thread_data[i]);
+    }
+    for (i = 0; i < num_threads; i++)
+        pthread_join(threads[i], NULL);
+
+    // O último lote formatado já foi entregue; a escritora termina depois dele
+    pthread_mutex_lock(&predicao.mutex);
+    predicao.fim = 1;
+    pthread_cond_broadcast(&predicao.cond);
+    pthread_mutex_unlock(&predicao.mutex);
+    pthread_join(escritor, NULL);
+    if (fflush(stdout) != 0)
+        predicao.erro = 1;
+
+    fim = clock();
+    tempo = relogio() - inicio_parede;
+    if (predicao.erro)
+        fprintf(stderr, "Erro: falha ao gravar os rotulos.\n");
+    fprintf(stderr, "Pontos rotulados: %lld (%.0f pontos por segundo)\n", fluxo.lidos,
+            tempo > 0.0 ? fluxo.lidos / tempo : 0.0);
+    fprintf(stderr, "Tempo de CPU total (Opcao 2, predicao): %f segundos\n", (double)(fim - inicio) / CLOCKS_PER_SEC);
+    fprintf(stderr, "Tempo de parede total (Opcao 2, predicao): %f segundos\n", tempo);
+    i = (fluxo.erro || predicao.erro) ? 1 : 0;
+
+    kstream_fecha(&fluxo);
+    kbarrier_destroy(&barreira);
+    kmeans_centros_free(&centros);
+    pthread_mutex_destroy(&predicao.mutex);
+    pthread_cond_destroy(&predicao.cond);
+    for (b = 0; b < 2; b++) {
+        for (k = 0; k < num_threads; k++)
+            kmeans_pages_free(predicao.buf[b][k], cap);
+        free(predicao.buf[b]);
+        free(predicao.len[b]);
+    }
+    if (politica != PIN_NONE) {
+        knuma_topologia_free(&topologia);
+        free(cpus);
+    }
+    free(mean);
+    free(rotulo);
+    free(threads);
+    free(thread_data_raw);
+    return i;
+}
+
+
+// Grava a saída final (-l, -Q) depois do join: a inércia total no stderr
+// (soma dos clusters na ordem c = 0..K-1), o CSV das inércias e os buffers de
+// rótulos das threads, em ordem. Retorna 0 se ok, -1 se falhar.
+int escreve_saida(const saida_t *sd, thread_data_t *thread_data, int num_threads, int k, int n,
+                  int todos_digitos) {
+    void **bufs;
+    size_t *lens;
+    double total = 0.0;
+    int c, t, ret;
+
+    for (c = 0; c < k; c++)
+        total += sd->inercia[c];
+    fprintf(stderr, todos_digitos ? "Inercia total: %.17g\n" : "Inercia total: %.6f\n", total);
+    if (sd->inercias != NULL &&
+        kml_grava_inercias(sd->inercias, k, sd->pontos, sd->inercia, todos_digitos ? "%.17g" : "%.6f") != 0)
+        return -1;
+    if (sd->rotulos == NULL)
+        return 0;
+
+    bufs = (void **)malloc(sizeof(void *) * num_threads);
+    lens = (size_t *)malloc(sizeof(size_t) * num_threads);
+    if (bufs == NULL || lens == NULL) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para os rotulos\n");
+        free(bufs);
+        free(lens);
+        return -1;
+    }
+    ret = 0;
+    for (t = 0; t < num_threads; t++) {
+        bufs[t] = thread_data[t].rotulos;
+        lens[t] = thread_data[t].rotulos_len;
+        if (bufs[t] == NULL)
+            ret = -1;
+    }
+    if (ret != 0)
+        fprintf(stderr, "Erro: Falha ao alocar memoria para os rotulos\n");
+    else
+        ret = kml_grava(sd->rotulos, k, n, sd->texto, sd->tam, bufs, lens, num_threads);
+    free(bufs);
+    free(lens);
+    return ret;
 }
 
 
 // Função Main
 int main(int argc, char *argv[]) {
-    int i, j, k, n, c;
-    double *x, *mean, *sum;
-    int *cluster, *count;
-    int flips_global; 
+    int i, j, k, n, dim;
+    double *x, *mean, *mean_next, *mean_final;
+    int *cluster;
+    dataset_t ds;
+    const char *entrada = NULL;
+    int opt;
+    int algoritmo = ALG_LLOYD;
+    hamerly_t hamerly;
+    yinyang_t yinyang;
+    int grupos = 0;
+    int tipo_barreira = BARRIER_CONDVAR;
+    int tipo_sched = SCHED_STATIC;
+    int politica = PIN_NONE;
+    knuma_topologia_t topologia = {0};
+    int *cpus = NULL;
+    int metodo_init = INIT_INPUT;
+    unsigned long long semente = 1;
+    kinit_t init = {0};
+    kmeans_centros_t centros[2] = {{0}};
+    int kernel = KERNEL_AUTO;
+    int precisao = PRECISAO_DOUBLE;
+    const char *formato = "%5.2f ";
+    int lote = 0, passadas = 1, exato = 0;
+    kstop_t parada = {0};
+    reinicios_t reinicios = {0};
+    saida_t saida = {0};
+    int k_min = 0, k_max = 0, passo_k = 1;
+    const char *relatorio = NULL;
+    kprof_t prof;
+    const char *arquivo_centroides = NULL;
+    int distancias = 0, lote_predicao = 65536, todos_digitos = 0;
 
     clock_t inicio, fim;
-    double tempo_total;
+    double tempo_total, inicio_parede, t_escrita;
     
     int num_threads;
     pthread_t *threads;
     thread_data_t *thread_data;
+    void *thread_data_raw;
+
+    // Opções: -i <arquivo> lê o dataset (binário ou texto, ver kmeans_io.h) em vez do stdin
+    //         -a <lloyd|hamerly|yinyang> escolhe o modo da etapa de atribuição (ver kmeans_accel.h)
+    //         -g <grupos> número de grupos de centróides do Yinyang (padrão K/10)
+    //         -b <condvar|spin|dissem> implementação da barreira (ver kmeans_barrier.h)
+    //         -e <static|steal> distribuição dos pontos entre as threads (ver kmeans_sched.h)
+    //         -c <none|compact|scatter> fixa as threads em núcleos, com first-touch (ver kmeans_numa.h)
+    //         -s <auto|scalar|avx2|avx512> kernel de distâncias do modo Lloyd (ver kmeans_simd.h)
+    //         -p <double|float> tipo dos pontos no modo Lloyd (float: metade da memória)
+    //         -P imprime os centróides com todos os dígitos (para comparar precisões)
+    //         -k <input|kmeanspp|kmeanspar> centróides iniciais: chutes da entrada ou sorteio (ver kmeans_init.h)
+    //         -S <semente> semente do sorteio de -k (padrão 1)
+    //         -m <lote> modo mini-batch: lê a entrada em lotes de <lote> pontos (ver kmeans_stream.h)
+    //         -E <passadas> passadas pela entrada no modo mini-batch (padrão 1)
+    //         -o <lote> Lloyd exato fora da memória: uma passada em lotes por iteração
+    //         -I <n>, -f <eps>, -t <eps> critérios de parada extras (ver kmeans_stop.h)
+    //         -R <reinicios> roda <reinicios> sorteios de -k com os pontos lidos uma vez e fica o de menor inércia
+    //         -K <k_min:k_max[:passo]> varredura de K com os pontos lidos uma vez; imprime a tabela (CSV) de cada K
+    //         -W <arquivo> grava o tempo de parede de cada fase por thread e iteração, em JSON ou .csv (ver kmeans_prof.h)
+    //         -A <centroides> modo de predição: rotula os pontos da entrada com os centróides do arquivo
+    //         -D com -A, imprime também a distância de cada ponto ao seu centróide
+    //         -L <lote> pontos por lote no modo de predição (padrão 65536)
+    //         -l <arquivo> grava o rótulo final de cada ponto, em binário compacto ou .txt (ver kmeans_io.h)
+    //         -Q <arquivo> grava o CSV com os pontos e a inércia de cada cluster
+    reinicios.total = 1;
+    while ((opt = getopt(argc, argv, "i:a:g:b:e:c:s:p:Pk:S:m:E:o:I:f:t:R:K:W:A:DL:l:Q:")) != -1) {
+        if (opt == 'i') {
+            entrada = optarg;
+        } else if (opt == 'a' && (algoritmo = kmeans_parse_algoritmo(optarg)) >= 0) {
+            continue;
+        } else if (opt == 'g' && (grupos = atoi(optarg)) > 0) {
+            continue;
+        } else if (opt == 'b' && (tipo_barreira = kbarrier_parse_tipo(optarg)) >= 0) {
+            continue;
+        } else if (opt == 'e' && (tipo_sched = ksched_parse_tipo(optarg)) >= 0) {
+            continue;
+        } else if (opt == 'c' && (politica = knuma_parse_politica(optarg)) >= 0) {
+            continue;
+        } else if (opt == 's' && (kernel = kmeans_parse_kernel(optarg)) >= KERNEL_AUTO) {
+            continue;
+        } else if (opt == 'p' && (precisao = kmeans_parse_precisao(optarg)) >= 0) {
+            continue;
+        } else if (opt == 'P') {
+            formato = "%.17g ";
+            todos_digitos = 1;
+        } else if (opt == 'k' && (metodo_init = kinit_parse_metodo(optarg)) >= 0) {
+            continue;
+        } else if (opt == 'S') {
+            semente = strtoull(optarg, NULL, 10);
+        } else if (opt == 'm' && (lote = atoi(optarg)) > 0) {
+            exato = 0;
+        } else if (opt == 'E' && (passadas = atoi(optarg)) > 0) {
+            continue;
+        } else if (opt == 'o' && (lote = atoi(optarg)) > 0) {
+            exato = 1;
+        } else if (opt == 'I' && (parada.max_iter = atoi(optarg)) > 0) {
+            continue;
+        } else if (opt == 'f' && (parada.eps_flips = atof(optarg)) > 0.0) {
+            continue;
+        } else if (opt == 't' && (parada.eps_desloc = atof(optarg)) > 0.0) {
+            continue;
+        } else if (opt == 'R' && (reinicios.total = atoi(optarg)) > 0) {
+            continue;
+        } else if (opt == 'K' && sscanf(optarg, "%d:%d:%d", &k_min, &k_max, &passo_k) >= 2 &&
+                   k_min > 0 && k_max >= k_min && passo_k > 0) {
+            continue;
+        } else if (opt == 'W') {
+            relatorio = optarg;
+        } else if (opt == 'A') {
+            arquivo_centroides = optarg;
+        } else if (opt == 'D') {
+            distancias = 1;
+        } else if (opt == 'L' && (lote_predicao = atoi(optarg)) > 0) {
+            continue;
+        } else if (opt == 'l') {
+            saida.rotulos = optarg;
+        } else if (opt == 'Q') {
+            saida.inercias = optarg;
+        } else {
+            argc = 0; // Força a mensagem de uso abaixo
+            break;
+        }
+    }
+
+    if (argc - optind != 1) {
+        // Imprime o erro no stderr (console)
+        fprintf(stderr, "Erro: Voce deve especificar o numero de threads.\n");
+        fprintf(stderr, "Uso: cat input.txt | %s [-a lloyd|hamerly|yinyang] [-g grupos] [-b condvar|spin|dissem] [-e static|steal] [-c none|compact|scatter] [-s auto|scalar|avx2|avx512] [-p double|float] [-P] [-k input|kmeanspp|kmeanspar] [-S semente] [-m lote [-E passadas] | -o lote] [-I max_iter] [-f eps_flips] [-t eps_desloc] [-R reinicios] [-K k_min:k_max[:passo]] [-W relatorio.json|.csv] [-l rotulos.bin|.txt] [-Q inercias.csv] <numero_de_threads> > output.txt\n", argv[0]);
+        fprintf(stderr, "     cat pontos.txt | %s -A centroides.txt [-D] [-L lote] [-b condvar|spin|dissem] [-c none|compact|scatter] [-s auto|scalar|avx2|avx512] [-p double|float] [-P] <numero_de_threads> > rotulos.txt\n", argv[0]);
+        fprintf(stderr, "     %s -i input.bin [-a lloyd|hamerly|yinyang] [-g grupos] [-b condvar|spin|dissem] [-e static|steal] [-c none|compact|scatter] [-s auto|scalar|avx2|avx512] [-p double|float] [-P] [-k input|kmeanspp|kmeanspar] [-S semente] [-m lote [-E passadas] | -o lote] [-I max_iter] [-f eps_flips] [-t eps_desloc] [-R reinicios] [-K k_min:k_max[:passo]] [-W relatorio.json|.csv] [-l rotulos.bin|.txt] [-Q inercias.csv] <numero_de_threads> > output.txt\n", argv[0]);
+        return 1; // Sai do programa
+    }
+
+    if ((kernel = kmeans_kernel_select(kernel)) < 0)
+        return 1;
+
+    // Os rótulos e as inércias são os da última iteração de uma única execução
+    // com os pontos na memória
+    if ((saida.rotulos != NULL || saida.inercias != NULL) &&
+        (arquivo_centroides != NULL || k_min > 0 || lote > 0 || reinicios.total > 1)) {
+        fprintf(stderr, "Erro: -l e -Q nao se aplicam a -A, -K, -m, -o e -R.\n");
+        return 1;
+    }
+
+    // Predição: os centróides são lidos uma vez e a entrada é rotulada em lotes
+    if (arquivo_centroides != NULL) {
+        if (k_min > 0 || lote > 0 || reinicios.total > 1 || relatorio != NULL || metodo_init != INIT_INPUT) {
+            fprintf(stderr, "Erro: a predicao (-A) nao se aplica a -K, -m, -o, -R, -W e -k.\n");
+            return 1;
+        }
+        // Os limites de Hamerly/Yinyang podam distâncias entre iterações e
+        // não valem para pontos vistos uma vez só: a predição usa o kernel do Lloyd
+        if (algoritmo != ALG_LLOYD || tipo_sched != SCHED_STATIC) {
+            fprintf(stderr, "Erro: a predicao (-A) usa -a lloyd e -e static.\n");
+            return 1;
+        }
+        return executa_predicao(arquivo_centroides, entrada, atoi(argv[optind]), lote_predicao, distancias,
+                                tipo_barreira, politica, kernel, precisao, todos_digitos);
+    }
+    if (relatorio != NULL && (k_min > 0 || lote > 0)) {
+        fprintf(stderr, "Erro: o relatorio de tempos (-W) mede o kmeans_worker e nao se aplica a -K, -m e -o.\n");
+        return 1;
+    }
+
+    // Varredura de K: a entrada é lida uma vez para todos os K
+    if (k_min > 0) {
+        if (lote > 0) {
+            fprintf(stderr, "Erro: a varredura de K (-K) nao se aplica aos modos em lotes (-m, -o).\n");
+            return 1;
+        }
+        return executa_varredura(entrada, atoi(argv[optind]), k_min, k_max, passo_k, algoritmo, grupos,
+                                 tipo_barreira, tipo_sched, politica, kernel, precisao, metodo_init, semente,
+                                 reinicios.total, &parada);
+    }
+
+    // Modos em lotes (mini-batch e fora da memória): a entrada não é carregada inteira
+    if (lote > 0) {
+        if (algoritmo != ALG_LLOYD || tipo_sched != SCHED_STATIC) {
+            fprintf(stderr, "Erro: os modos em lotes (-m, -o) usam -a lloyd e -e static.\n");
+            return 1;
+        }
+        if (reinicios.total > 1) {
+            fprintf(stderr, "Erro: os reinicios (-R) nao se aplicam aos modos em lotes (-m, -o).\n");
+            return 1;
+        }
+        if (exato && metodo_init != INIT_INPUT) {
+            fprintf(stderr, "Erro: o modo fora da memoria (-o) usa os centroides da entrada (-k input).\n");
+            return 1;
+        }
+        return executa_lotes(entrada, atoi(argv[optind]), lote, exato, passadas, tipo_barreira, politica,
+                             kernel, precisao, metodo_init, semente, &parada, formato);
+    }
+
+    // Reinícios com os chutes da entrada dariam sempre o mesmo resultado
+    if (reinicios.total > 1 && metodo_init == INIT_INPUT)
+        metodo_init = INIT_KMEANSPP;
+    reinicios.semente = semente;
 
     inicio = clock(); 
+    inicio_parede = kprof_agora();
 
     // 1. FASE DE SETUP (Leitura + Alocação) 
-    scanf("%d", &k);
-    scanf("%d", &n);
-
-    // Aloca arrays GLOBAIS
-    x = (double *)malloc(sizeof(double)*DIM*n);
-    mean = (double *)malloc(sizeof(double)*DIM*k);
-    sum= (double *)malloc(sizeof(double)*DIM*k);
-    cluster = (int *)malloc(sizeof(int)*n);
-    count = (int *)malloc(sizeof(int)*k);
-    
-    // Leitura dos dados
-    for (i = 0; i<n; i++) 
-        cluster[i] = 0;
-    for (i = 0; i<k; i++)
-        scanf("%lf %lf %lf", mean+i*DIM, mean+i*DIM+1, mean+i*DIM+2);
-    for (i = 0; i<n; i++)
-        scanf("%lf %lf %lf", x+i*DIM, x+i*DIM+1, x+i*DIM+2);
+    // A entrada é lida de uma vez; se for texto, as coordenadas são convertidas
+    // pelas próprias threads (Etapa 0 do kmeans_worker)
+    if (dataset_open(entrada, &ds) != 0)
+        return 1;
+    if ((precisao = kmeans_dataset_precisao(&ds, precisao, algoritmo)) < 0 ||
+        (politica != PIN_NONE && dataset_private_points(&ds) != 0)) {
+        dataset_free(&ds);
+        return 1;
+    }
+    k = ds.k;
+    n = ds.n;
+    dim = ds.dim; // Número de coordenadas, lido da entrada
+
+    // Arrays GLOBAIS: 'x' e 'mean' vêm do dataset (mapeado ou convertido do texto)
+    x = ds.x;
+    mean = ds.mean;
+    mean_next = (double *)malloc(sizeof(double)*dim*k);
+    mean_final = mean;
+    // Zerado pelas threads, cada uma na sua fatia (first-touch)
+    cluster = (int *)kmeans_pages_alloc(sizeof(int)*n);
+    if (reinicios.total > 1 && (reinicios.mean_melhor = (double *)malloc(sizeof(double)*dim*k)) == NULL) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para os reinicios\n");
+        return 1;
+    }
+    if (saida.rotulos != NULL || saida.inercias != NULL) {
+        saida.texto = (saida.rotulos != NULL && kml_eh_texto(saida.rotulos));
+        saida.tam = kml_tam_rotulo(k);
+        saida.inercia = (double *)malloc(sizeof(double) * k);
+        saida.pontos = (int *)malloc(sizeof(int) * k);
+        if (saida.inercia == NULL || saida.pontos == NULL) {
+            fprintf(stderr, "Erro: Falha ao alocar memoria para as inercias\n");
+            return 1;
+        }
+    }
+
+    if (algoritmo == ALG_LLOYD &&
+        (kmeans_centros_alloc(&centros[0], k, dim, kernel, precisao) != 0 ||
+         kmeans_centros_alloc(&centros[1], k, dim, kernel, precisao) != 0)) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para os centroides\n");
+        return 1;
+    }
+    if (algoritmo == ALG_HAMERLY && hamerly_alloc(&hamerly, n, k) != 0) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para os limites de Hamerly\n");
+        return 1;
+    }
+    if (algoritmo == ALG_YINYANG && yinyang_alloc(&yinyang, n, k, dim, grupos > 0 ? grupos : k / 10) != 0) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para os limites do Yinyang\n");
+        return 1;
+    }
     
-    flips_global = n; 
 
     // 2. SETUP DAS THREADS
     
-    if (argc != 2) {
-        // Imprime o erro no stderr (console)
-        fprintf(stderr, "Erro: Voce deve especificar o numero de threads.\n");
-        fprintf(stderr, "Uso: cat input.txt | %s <numero_de_threads> > output.txt\n", argv[0]);
-        return 1; // Sai do programa
-    }
-    
-    num_threads = atoi(argv[1]); // Converte o argumento (ex: "4") para um inteiro
+    num_threads = atoi(argv[optind]); // Converte o argumento (ex: "4") para um inteiro
 
     // Validação
     if (num_threads <= 0) {
@@ -242,14 +1773,37 @@ int main(int argc, char *argv[]) {
     
     num_threads_global = num_threads; 
     
-    fprintf(stderr, "Iniciando K-Means com %d threads (Opcao 2: Reducao Local)\n", num_threads);
+    fprintf(stderr, "Iniciando K-Means com %d threads (Opcao 2: Reducao Local, barreira %s, escalonamento %s, kernel %s, pontos em %s, inicializacao %s)\n", num_threads, kbarrier_nome(tipo_barreira), ksched_nome(tipo_sched), kmeans_kernel_nome(kernel), precisao == PRECISAO_FLOAT ? "float" : "double", kinit_nome(metodo_init));
 
     threads = (pthread_t *)malloc(num_threads * sizeof(pthread_t));
-    thread_data = (thread_data_t *)malloc(num_threads * sizeof(thread_data_t));
+    // Entradas alinhadas a linha de cache (ver thread_data_t)
+    thread_data_raw = malloc(num_threads * sizeof(thread_data_t) + BARRIER_CACHE_LINE);
+    thread_data = (thread_data_t *)(((uintptr_t)thread_data_raw + BARRIER_CACHE_LINE - 1) & ~(uintptr_t)(BARRIER_CACHE_LINE - 1));
 
-    pthread_mutex_init(&barrier_mutex, NULL);
-    pthread_cond_init(&barrier_cond, NULL);
-    barrier_counter = 0;
+    if (kbarrier_init(&barreira, tipo_barreira, num_threads) != 0) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para a barreira\n");
+        return 1;
+    }
+    if (ksched_init(&escalonador, tipo_sched, num_threads) != 0) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para o escalonador\n");
+        return 1;
+    }
+    if (politica != PIN_NONE) {
+        cpus = (int *)malloc(sizeof(int) * num_threads);
+        if (cpus == NULL || knuma_topologia(&topologia) != 0) {
+            fprintf(stderr, "Erro: Falha ao alocar memoria para a topologia\n");
+            return 1;
+        }
+        knuma_plano(&topologia, politica, num_threads, cpus);
+    }
+    if (kinit_alloc(&init, metodo_init, semente, n, k, dim, ds.x, ds.xf, mean, num_threads) != 0) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para a inicializacao\n");
+        return 1;
+    }
+    if (relatorio != NULL && kprof_init(&prof, num_threads) != 0) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para o relatorio de tempos\n");
+        return 1;
+    }
 
     // 3. LANÇAMENTO DAS THREADS
     for (i = 0; i < num_threads; i++) {
@@ -262,63 +1816,168 @@ int main(int argc, char *argv[]) {
         thread_data[i].n = n;
         thread_data[i].start_n = start_n;
         thread_data[i].end_n = end_n;
-        thread_data[i].flips_global_ptr = &flips_global; 
         thread_data[i].flips_local = 0;
         
         // Passa ponteiros para arrays GLOBAIS
         thread_data[i].x = x;
         thread_data[i].mean = mean;
-        thread_data[i].sum = sum;
+        thread_data[i].mean_next = mean_next;
         thread_data[i].cluster = cluster;
-        thread_data[i].count = count;
+        thread_data[i].mean_final_ptr = &mean_final;
+        thread_data[i].centros = &centros[0];
+        thread_data[i].centros_next = &centros[1];
         
         thread_data[i].all_thread_data = thread_data; 
+        thread_data[i].algoritmo = algoritmo;
+        thread_data[i].hamerly = &hamerly;
+        thread_data[i].yinyang = &yinyang;
+        thread_data[i].init = &init;
+        thread_data[i].parada = &parada;
+        thread_data[i].reinicios = &reinicios;
+        thread_data[i].saida = (saida.inercia != NULL) ? &saida : NULL;
+        thread_data[i].rotulos = NULL;
+        thread_data[i].rotulos_len = 0;
+        thread_data[i].prof = (relatorio != NULL) ? &prof : NULL;
+        if (algoritmo == ALG_YINYANG && yinyang_local_alloc(&thread_data[i].yy_local, &yinyang) != 0) {
+            fprintf(stderr, "Erro: Falha ao alocar o rascunho do Yinyang para a thread %d\n", i);
+            return 1;
+        }
+        if (tipo_sched == SCHED_STEAL &&
+            ksched_fila_init(&escalonador, i, start_n, end_n,
+                             ksched_bloco_pontos(dim, precisao == PRECISAO_FLOAT ? sizeof(float) : sizeof(double))) != 0) {
+            fprintf(stderr, "Erro: Falha ao alocar a fila de blocos da thread %d\n", i);
+            return 1;
+        }
+        thread_data[i].cpu = (cpus != NULL) ? cpus[i] : -1;
+        thread_data[i].ds = &ds;
+        thread_data[i].registros = 0;
+        thread_data[i].erro_leitura = 0;
         
-        // Aloca arrays LOCAIS para esta thread
-        thread_data[i].sum_local = (double *)malloc(sizeof(double) * k * DIM);
-        thread_data[i].count_local = (int *)malloc(sizeof(int) * k);
-        if (thread_data[i].sum_local == NULL || thread_data[i].count_local == NULL) {
+        // Aloca arrays LOCAIS para esta thread (zerados por ela, a cada iteração)
+        thread_data[i].sum_local = (double *)kmeans_pages_alloc(sizeof(double) * k * dim);
+        thread_data[i].count_local = (int *)kmeans_pages_alloc(sizeof(int) * k);
+        thread_data[i].quad_local = NULL;
+        thread_data[i].quad.soma = NULL;
+        thread_data[i].soma_c = NULL;
+        if (saida.inercia != NULL) {
+            thread_data[i].quad_local = &thread_data[i].quad;
+            thread_data[i].quad.soma = (double *)kmeans_pages_alloc(sizeof(double) * k);
+            thread_data[i].soma_c = (double *)malloc(sizeof(double) * dim);
+        }
+        if (thread_data[i].sum_local == NULL || thread_data[i].count_local == NULL ||
+            (saida.inercia != NULL && (thread_data[i].quad.soma == NULL || thread_data[i].soma_c == NULL))) {
             fprintf(stderr, "Erro: Falha ao alocar memoria local para a thread %d\n", i);
             return 1;
         }
 
         pthread_create(&threads[i], NULL, kmeans_worker, (void *)&thread_data[i]);
     }
+    if (relatorio != NULL)
+        prof.setup = kprof_agora() - inicio_parede;
 
     // 4. ESPERA (Join) 
     for (i = 0; i < num_threads; i++) {
         pthread_join(threads[i], NULL);
     }
+    for (i = 0; i < num_threads; i++) {
+        if (thread_data[i].erro_leitura) {
+            fprintf(stderr, "Erro: entrada texto deve ter %ld linhas com %d coordenadas.\n", (long)k + n, dim);
+            return 1;
+        }
+    }
+    dataset_text_release(&ds);
+    if (reinicios.total > 1) {
+        fprintf(stderr, "Melhor reinicio: %d de %d (semente %llu, inercia %.6f)\n", reinicios.melhor, reinicios.total,
+                reinicios.semente + reinicios.melhor, reinicios.melhor_inercia);
+        mean_final = reinicios.mean_melhor;
+    } else {
+        kstop_relatorio(&parada);
+    }
+
+    // 4.1 Relatório de posicionamento (-c): núcleo e nó de cada thread e o nó
+    // em que ficou a maior parte das páginas de cada um dos seus dados
+    if (politica != PIN_NONE) {
+        fprintf(stderr, "Posicionamento (%s, %d nos NUMA):\n", knuma_nome(politica), topologia.nnos);
+        for (i = 0; i < num_threads; i++) {
+            thread_data_t *td = &thread_data[i];
+            size_t tam_ponto = (size_t)dim * (ds.xf != NULL ? sizeof(float) : sizeof(double));
+            const char *pontos = (ds.xf != NULL) ? (const char *)ds.xf : (const char *)ds.x;
+            char b0[16], b1[16], b2[16], b3[16];
+            int no_cpu = -1;
+            for (j = 0; j < topologia.ncpus; j++) {
+                if (topologia.cpus[j].cpu == td->cpu)
+                    no_cpu = topologia.cpus[j].no;
+            }
+            if (td->cpu < 0)
+                fprintf(stderr, "  Thread %d: sem fixacao", i);
+            else
+                fprintf(stderr, "  Thread %d: cpu %d (no %s)", i, td->cpu, knuma_no_str(no_cpu, b0, sizeof(b0)));
+            fprintf(stderr, " | x: no %s | cluster: no %s | somas locais: no %s\n",
+                    knuma_no_str(knuma_no_da_faixa(pontos + tam_ponto * td->start_n, tam_ponto * (td->end_n - td->start_n)), b1, sizeof(b1)),
+                    knuma_no_str(knuma_no_da_faixa(cluster + td->start_n, sizeof(int) * (td->end_n - td->start_n)), b2, sizeof(b2)),
+                    knuma_no_str(knuma_no_da_faixa(td->sum_local, sizeof(double) * k * dim), b3, sizeof(b3)));
+        }
+    }
     
     // 5. FASE DE ESCRITA (Resultados)
+    t_escrita = kprof_agora();
     for (i = 0; i < k; i++) {
-        for (j = 0; j < DIM; j++)
-            printf("%5.2f ", mean[i*DIM+j]); 
+        for (j = 0; j < dim; j++)
+            printf(formato, mean_final[i*dim+j]); 
         printf("\n");
     }
+    fflush(stdout);
+    if (saida.inercia != NULL && escreve_saida(&saida, thread_data, num_threads, k, n, todos_digitos) != 0)
+        return 1;
 
     // 6. CÁLCULO E IMPRESSÃO DO TEMPO
+    // O tempo de CPU soma todas as threads; o de parede é o que mede a aceleração
     fim = clock(); 
     tempo_total = (double)(fim - inicio) / CLOCKS_PER_SEC;
 
     fprintf(stderr, "Tempo de CPU total (Opcao 2): %f segundos\n", tempo_total);
+    fprintf(stderr, "Tempo de parede total (Opcao 2): %f segundos\n", kprof_agora() - inicio_parede);
+    if (relatorio != NULL) {
+        prof.escrita = kprof_agora() - t_escrita;
+        prof.total = kprof_agora() - inicio_parede;
+        if (kprof_escreve(&prof, relatorio, "concfinal") != 0)
+            return 1;
+        kprof_free(&prof);
+    }
     
     // 7. LIMPEZA
-    free(x);
-    free(mean);
-    free(sum);
-    free(cluster);
-    free(count);
+    dataset_free(&ds); // 'x' e 'mean'
+    free(mean_next);
+    free(reinicios.mean_melhor);
+    kmeans_pages_free(cluster, sizeof(int)*n);
+    kmeans_centros_free(&centros[0]);
+    kmeans_centros_free(&centros[1]);
+    if (algoritmo == ALG_HAMERLY)
+        hamerly_free(&hamerly);
     
-    pthread_mutex_destroy(&barrier_mutex);
-    pthread_cond_destroy(&barrier_cond);
+    kbarrier_destroy(&barreira);
+    kinit_free(&init);
+    ksched_destroy(&escalonador);
     
     // Libera os arrays LOCAIS de cada thread
     for (i = 0; i < num_threads; i++) {
-        free(thread_data[i].sum_local);
-        free(thread_data[i].count_local);
+        kmeans_pages_free(thread_data[i].sum_local, sizeof(double) * k * dim);
+        kmeans_pages_free(thread_data[i].count_local, sizeof(int) * k);
+        kmeans_pages_free(thread_data[i].quad.soma, sizeof(double) * k);
+        free(thread_data[i].soma_c);
+        free(thread_data[i].rotulos);
+        if (algoritmo == ALG_YINYANG)
+            yinyang_local_free(&thread_data[i].yy_local);
     }
+    free(saida.inercia);
+    free(saida.pontos);
+    if (algoritmo == ALG_YINYANG)
+        yinyang_free(&yinyang);
     
+    if (politica != PIN_NONE) {
+        knuma_topologia_free(&topologia);
+        free(cpus);
+    }
     free(threads);
-    free(thread_data);
+    free(thread_data_raw);
 }
\ No newline at end of file
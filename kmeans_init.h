@@ -0,0 +1,483 @@
+#ifndef KMEANS_INIT_H
+#define KMEANS_INIT_H
+
+// Inicialização dos centróides (opção -k), compartilhada pela versão
+// sequencial e pela concorrente:
+//
+//   INIT_INPUT      os K "chutes" lidos da entrada (o original).
+//   INIT_KMEANSPP   k-means++: o primeiro centróide é um ponto sorteado e cada
+//                   um dos seguintes é sorteado com probabilidade proporcional
+//                   a D(x)^2, a distância ao quadrado até o centróide mais
+//                   próximo já escolhido. K passadas pelos pontos.
+//   INIT_KMEANSPAR  k-means|| (versão escalável): em KINIT_RODADAS passadas,
+//                   cada ponto é sorteado de forma independente com
+//                   probabilidade l*D(x)^2/psi (l = 2K, psi = soma de D^2).
+//                   Os candidatos, com peso igual ao número de pontos mais
+//                   próximos de cada um, são reduzidos a K com k-means++
+//                   ponderado (na thread 0, sem passar pelos pontos).
+//
+// kinit_run executa o protocolo em cada thread do conjunto, chamando 'espera'
+// (a barreira) entre as etapas; a versão sequencial o chama com uma thread só.
+// As passadas são divididas em blocos de KINIT_BLOCO pontos, as somas de D^2
+// são feitas por bloco e depois na ordem dos blocos, e o sorteio do k-means||
+// usa um hash de (semente, rodada, ponto): os centróides escolhidos dependem
+// só da semente (-S), e não do número de threads.
+//
+// Os centróides são pontos do dataset e substituem os chutes em 'mean'. Os
+// pontos são lidos de 'x' ou, no modo float, de 'xf' (convertidos para double).
+//
+// Com k_ini > 0 (varredura de K, -K), os centróides [0, k_ini) de 'mean' são
+// mantidos (a solução do K anterior) e só os seguintes são sorteados, com
+// k-means++ a partir deles, qualquer que seja o método.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "kmeans_accel.h"
+
+#define INIT_INPUT     0   // Chutes da entrada
+#define INIT_KMEANSPP  1   // k-means++
+#define INIT_KMEANSPAR 2   // k-means||
+
+#define KINIT_BLOCO    1024   // Pontos por bloco das somas de D^2
+#define KINIT_RODADAS  5      // Rodadas de sorteio do k-means||
+#define KINIT_SOBRA    2      // l = KINIT_SOBRA * K pontos sorteados por rodada, em média
+
+typedef struct kinit_t {
+    int metodo;
+    uint64_t semente;
+    int n, k, dim, nblocos;
+    int k_ini;                // Centróides já presentes em 'mean' (0 = sorteia todos)
+    const double *x;          // Pontos (um dos dois)
+    const float *xf;
+    double *mean;             // Saída: K centróides
+
+    double *d2;               // D(x)^2 de cada ponto (N); no fim do k-means||, D^2 dos candidatos
+    double *soma_bloco;       // Soma de D^2 de cada bloco (nblocos)
+    uint64_t rng;             // Gerador da thread 0
+    int escolhido;            // k-means++: ponto sorteado na rodada (escrito pela thread 0)
+
+    // k-means||
+    int *prox;                // Candidato mais próximo de cada ponto (N)
+    int *amostra;             // Sorteados na rodada, na faixa de pontos de cada thread (N); no fim, pesos
+    int *namostras;           // Sorteados por thread na rodada (T)
+    int *cand;                // Pontos candidatos (até N)
+    int ncand, novos_ini;     // Candidatos [novos_ini, ncand) são os da última rodada
+} kinit_t;
+
+
+// Converte o nome passado na linha de comando (-k) para INIT_*; -1 se inválido.
+static inline int kinit_parse_metodo(const char *nome) {
+    if (strcmp(nome, "input") == 0) return INIT_INPUT;
+    if (strcmp(nome, "kmeanspp") == 0) return INIT_KMEANSPP;
+    if (strcmp(nome, "kmeanspar") == 0) return INIT_KMEANSPAR;
+    return -1;
+}
+
+static inline const char *kinit_nome(int metodo) {
+    static const char *nomes[] = { "input", "kmeanspp", "kmeanspar" };
+    return (metodo >= 0 && metodo <= INIT_KMEANSPAR) ? nomes[metodo] : "?";
+}
+
+
+// Gerador splitmix64: mistura de 64 bits e número uniforme em [0, 1).
+static inline uint64_t kinit_mix(uint64_t z) {
+    z += 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static inline double kinit_uniforme(uint64_t *estado) {
+    *estado += 0x9e3779b97f4a7c15ULL;
+    return (double)(kinit_mix(*estado) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Índice uniforme em [0, n).
+static inline int kinit_indice(uint64_t *estado, int n) {
+    int i = (int)(kinit_uniforme(estado) * n);
+    return (i < n) ? i : n - 1;
+}
+
+
+// Aloca o estado para 'num_threads' threads. 'x' ou 'xf' (o outro NULL) são
+// os pontos e 'mean' recebe os centróides. Retorna 0 se ok, -1 se faltar memória.
+static inline int kinit_alloc(kinit_t *ki, int metodo, uint64_t semente, int n, int k, int dim,
+                              const double *x, const float *xf, double *mean, int num_threads) {
+    size_t np = (size_t)(n > 0 ? n : 1);
+
+    memset(ki, 0, sizeof(*ki));
+    ki->metodo = metodo;
+    ki->semente = semente;
+    ki->rng = semente;
+    ki->n = n;
+    ki->k = k;
+    ki->dim = dim;
+    ki->nblocos = (n + KINIT_BLOCO - 1) / KINIT_BLOCO;
+    ki->x = x;
+    ki->xf = xf;
+    ki->mean = mean;
+    if (metodo == INIT_INPUT)
+        return 0;
+
+    ki->d2 = (double *)malloc(sizeof(double) * np);
+    ki->soma_bloco = (double *)malloc(sizeof(double) * (ki->nblocos > 0 ? ki->nblocos : 1));
+    if (ki->d2 == NULL || ki->soma_bloco == NULL)
+        return -1;
+    if (metodo == INIT_KMEANSPAR) {
+        ki->prox = (int *)malloc(sizeof(int) * np);
+        ki->amostra = (int *)malloc(sizeof(int) * np);
+        ki->cand = (int *)malloc(sizeof(int) * np);
+        ki->namostras = (int *)calloc(num_threads, sizeof(int));
+        if (ki->prox == NULL || ki->amostra == NULL || ki->cand == NULL || ki->namostras == NULL)
+            return -1;
+    }
+    return 0;
+}
+
+// Troca a semente (um novo sorteio, como nos reinícios de -R).
+static inline void kinit_semente(kinit_t *ki, uint64_t semente) {
+    ki->semente = semente;
+    ki->rng = semente;
+}
+
+// Troca os pontos sorteados por outros 'n' pontos (no máximo o 'n' passado a
+// kinit_alloc), como o primeiro lote do modo mini-batch.
+static inline void kinit_pontos(kinit_t *ki, int n, const double *x, const float *xf) {
+    ki->n = n;
+    ki->nblocos = (n + KINIT_BLOCO - 1) / KINIT_BLOCO;
+    ki->x = x;
+    ki->xf = xf;
+}
+
+static inline void kinit_free(kinit_t *ki) {
+    free(ki->d2);
+    free(ki->soma_bloco);
+    free(ki->prox);
+    free(ki->amostra);
+    free(ki->cand);
+    free(ki->namostras);
+}
+
+// 'espera' para uma única thread (versão sequencial).
+static inline void kinit_sem_barreira(int id) {
+    (void)id;
+}
+
+
+// Blocos [*b_ini, *b_fim) da thread 'id' entre 'num_threads'.
+static inline void kinit_blocos(const kinit_t *ki, int id, int num_threads, int *b_ini, int *b_fim) {
+    *b_ini = (int)((long)ki->nblocos * id / num_threads);
+    *b_fim = (int)((long)ki->nblocos * (id + 1) / num_threads);
+}
+
+// Distância ao quadrado entre os pontos i e j.
+static KMEANS_FORCE_INLINE double kinit_dist2(const kinit_t *ki, int i, int j, int dim) {
+    if (ki->xf != NULL) {
+        const float *a = ki->xf + (size_t)i * dim, *b = ki->xf + (size_t)j * dim;
+        double dx = 0.0;
+        int t;
+        for (t = 0; t < dim; t++)
+            dx += ((double)a[t] - (double)b[t]) * ((double)a[t] - (double)b[t]);
+        return dx;
+    }
+    return kmeans_dist2(ki->x + (size_t)i * dim, ki->x + (size_t)j * dim, dim);
+}
+
+static KMEANS_FORCE_INLINE void kinit_atualiza_impl(kinit_t *ki, int b_ini, int b_fim,
+                                                    const int *centros, int nc, int base, int dim) {
+    int b, i, c;
+
+    for (b = b_ini; b < b_fim; b++) {
+        int ini = b * KINIT_BLOCO;
+        int fim = (ini + KINIT_BLOCO < ki->n) ? ini + KINIT_BLOCO : ki->n;
+        double soma = 0.0;
+        for (i = ini; i < fim; i++) {
+            double menor = ki->d2[i];
+            for (c = 0; c < nc; c++) {
+                double d = kinit_dist2(ki, i, centros[c], dim);
+                if (d < menor) {
+                    menor = d;
+                    if (ki->prox != NULL)
+                        ki->prox[i] = base + c;
+                }
+            }
+            ki->d2[i] = menor;
+            soma += menor;
+        }
+        ki->soma_bloco[b] = soma;
+    }
+}
+
+// D^2 dos pontos dos blocos [b_ini, b_fim) passa a considerar também os 'nc'
+// centros (pontos) de 'centros'; com o k-means||, prox[i] recebe base + c do
+// mais próximo. Recalcula a soma de cada bloco.
+static inline void kinit_atualiza(kinit_t *ki, int b_ini, int b_fim, const int *centros, int nc, int base) {
+#define KINIT_CHAMADA(D) kinit_atualiza_impl(ki, b_ini, b_fim, centros, nc, base, D); return
+    KMEANS_DIM_DISPATCH(ki->dim, KINIT_CHAMADA)
+#undef KINIT_CHAMADA
+}
+
+// Soma de D^2 de todos os pontos, na ordem dos blocos.
+static inline double kinit_total(const kinit_t *ki) {
+    double total = 0.0;
+    int b;
+    for (b = 0; b < ki->nblocos; b++)
+        total += ki->soma_bloco[b];
+    return total;
+}
+
+// Sorteia um ponto com probabilidade proporcional a D^2 (ou uniforme, se
+// todos os pontos já coincidem com algum centro).
+static inline int kinit_sorteia_ponto(kinit_t *ki) {
+    double total = kinit_total(ki), u, acumulado = 0.0;
+    int b, i, ultimo_bloco = 0, ultimo = -1;
+
+    if (!(total > 0.0))
+        return kinit_indice(&ki->rng, ki->n);
+    u = kinit_uniforme(&ki->rng) * total;
+    for (b = 0; b < ki->nblocos; b++) {
+        if (ki->soma_bloco[b] > 0.0)
+            ultimo_bloco = b;
+        if (acumulado + ki->soma_bloco[b] > u)
+            break;
+        acumulado += ki->soma_bloco[b];
+    }
+    if (b == ki->nblocos)
+        b = ultimo_bloco; // Arredondamento: fica com o último bloco com peso
+    for (i = b * KINIT_BLOCO; i < ki->n && i < (b + 1) * KINIT_BLOCO; i++) {
+        if (ki->d2[i] > 0.0)
+            ultimo = i;
+        acumulado += ki->d2[i];
+        if (acumulado > u && ki->d2[i] > 0.0)
+            return i;
+    }
+    return ultimo;
+}
+
+// Copia o ponto i para o centróide c.
+static inline void kinit_copia(kinit_t *ki, int c, int i) {
+    int j;
+    for (j = 0; j < ki->dim; j++)
+        ki->mean[(size_t)c * ki->dim + j] = (ki->xf != NULL) ? (double)ki->xf[(size_t)i * ki->dim + j]
+                                                             : ki->x[(size_t)i * ki->dim + j];
+}
+
+
+// k-means++ ponderado sobre os 'm' candidatos do k-means|| com pesos em
+// ki->amostra (thread 0). Usa ki->d2[0..m) como D^2 de cada candidato.
+static inline void kinit_reduz_candidatos(kinit_t *ki) {
+    int m = ki->ncand, c, a, escolhido = 0;
+    int *peso = ki->amostra;
+    double *d2 = ki->d2;
+
+    if (m <= ki->k) {
+        // Poucos candidatos: todos viram centróides e o resto é sorteado
+        for (c = 0; c < m; c++)
+            kinit_copia(ki, c, ki->cand[c]);
+        for (c = m; c < ki->k; c++)
+            kinit_copia(ki, c, kinit_indice(&ki->rng, ki->n));
+        return;
+    }
+
+    for (a = 0; a < m; a++)
+        d2[a] = HUGE_VAL;
+    for (c = 0; c < ki->k; c++) {
+        double total = 0.0, u, acumulado = 0.0;
+        if (c == 0) {
+            for (a = 0; a < m; a++)
+                total += peso[a];
+        } else {
+            for (a = 0; a < m; a++)
+                total += peso[a] * d2[a];
+        }
+        if (total > 0.0) {
+            u = kinit_uniforme(&ki->rng) * total;
+            for (a = 0; a < m; a++) {
+                double p = (c == 0) ? (double)peso[a] : peso[a] * d2[a];
+                if (p > 0.0)
+                    escolhido = a;
+                acumulado += p;
+                if (acumulado > u && p > 0.0)
+                    break;
+            }
+        } else {
+            escolhido = kinit_indice(&ki->rng, m);
+        }
+        kinit_copia(ki, c, ki->cand[escolhido]);
+        for (a = 0; a < m; a++) {
+            double d = kinit_dist2(ki, ki->cand[a], ki->cand[escolhido], ki->dim);
+            if (d < d2[a])
+                d2[a] = d;
+        }
+    }
+}
+
+
+static inline void kinit_kmeanspp(kinit_t *ki, int id, int num_threads, void (*espera)(int)) {
+    int b_ini, b_fim, i, c;
+
+    kinit_blocos(ki, id, num_threads, &b_ini, &b_fim);
+    for (i = b_ini * KINIT_BLOCO; i < b_fim * KINIT_BLOCO && i < ki->n; i++)
+        ki->d2[i] = HUGE_VAL;
+    if (id == 0) {
+        ki->escolhido = kinit_indice(&ki->rng, ki->n);
+        kinit_copia(ki, 0, ki->escolhido);
+    }
+    espera(id);
+
+    for (c = 1; c < ki->k; c++) {
+        int centro = ki->escolhido;
+        kinit_atualiza(ki, b_ini, b_fim, &centro, 1, 0);
+        espera(id);
+        if (id == 0) {
+            ki->escolhido = kinit_sorteia_ponto(ki);
+            kinit_copia(ki, c, ki->escolhido);
+        }
+        espera(id);
+    }
+}
+
+
+static KMEANS_FORCE_INLINE void kinit_d2_medias_impl(kinit_t *ki, int b_ini, int b_fim, int dim) {
+    int b, i, c, j;
+
+    for (b = b_ini; b < b_fim; b++) {
+        int ini = b * KINIT_BLOCO;
+        int fim = (ini + KINIT_BLOCO < ki->n) ? ini + KINIT_BLOCO : ki->n;
+        double soma = 0.0;
+        for (i = ini; i < fim; i++) {
+            double menor = HUGE_VAL;
+            for (c = 0; c < ki->k_ini; c++) {
+                const double *m = ki->mean + (size_t)c * dim;
+                double d = 0.0;
+                if (ki->xf != NULL) {
+                    for (j = 0; j < dim; j++)
+                        d += ((double)ki->xf[(size_t)i * dim + j] - m[j]) * ((double)ki->xf[(size_t)i * dim + j] - m[j]);
+                } else {
+                    d = kmeans_dist2(ki->x + (size_t)i * dim, m, dim);
+                }
+                if (d < menor)
+                    menor = d;
+            }
+            ki->d2[i] = menor;
+            soma += menor;
+        }
+        ki->soma_bloco[b] = soma;
+    }
+}
+
+// D^2 dos pontos dos blocos [b_ini, b_fim) em relação aos k_ini centróides
+// de 'mean' (não a pontos, como kinit_atualiza). Recalcula a soma de cada bloco.
+static inline void kinit_d2_medias(kinit_t *ki, int b_ini, int b_fim) {
+#define KINIT_CHAMADA(D) kinit_d2_medias_impl(ki, b_ini, b_fim, D); return
+    KMEANS_DIM_DISPATCH(ki->dim, KINIT_CHAMADA)
+#undef KINIT_CHAMADA
+}
+
+// Amplia os k_ini centróides de 'mean' para K: rodadas do k-means++ para os
+// centróides [k_ini, K) a partir do D^2 em relação aos já presentes.
+static inline void kinit_amplia(kinit_t *ki, int id, int num_threads, void (*espera)(int)) {
+    int b_ini, b_fim, c;
+
+    kinit_blocos(ki, id, num_threads, &b_ini, &b_fim);
+    kinit_d2_medias(ki, b_ini, b_fim);
+    espera(id);
+
+    for (c = ki->k_ini; c < ki->k; c++) {
+        if (id == 0) {
+            ki->escolhido = kinit_sorteia_ponto(ki);
+            kinit_copia(ki, c, ki->escolhido);
+        }
+        espera(id);
+        if (c + 1 < ki->k) {
+            int centro = ki->escolhido;
+            kinit_atualiza(ki, b_ini, b_fim, &centro, 1, 0);
+            espera(id);
+        }
+    }
+}
+
+
+static inline void kinit_kmeanspar(kinit_t *ki, int id, int num_threads, void (*espera)(int)) {
+    int b_ini, b_fim, i, r, t, ini, fim;
+    double l = (double)KINIT_SOBRA * ki->k;
+
+    kinit_blocos(ki, id, num_threads, &b_ini, &b_fim);
+    ini = b_ini * KINIT_BLOCO;
+    fim = (b_fim * KINIT_BLOCO < ki->n) ? b_fim * KINIT_BLOCO : ki->n;
+    for (i = ini; i < fim; i++) {
+        ki->d2[i] = HUGE_VAL;
+        ki->prox[i] = 0;
+    }
+    if (id == 0) {
+        ki->cand[0] = kinit_indice(&ki->rng, ki->n);
+        ki->ncand = 1;
+        ki->novos_ini = 0;
+    }
+    espera(id);
+
+    for (r = 0; ; r++) {
+        // D^2 com os candidatos novos (todas as threads)
+        kinit_atualiza(ki, b_ini, b_fim, ki->cand + ki->novos_ini, ki->ncand - ki->novos_ini, ki->novos_ini);
+        espera(id);
+        if (r == KINIT_RODADAS)
+            break;
+
+        // Sorteio independente de cada ponto da faixa desta thread
+        {
+            double psi = kinit_total(ki);
+            int cont = 0;
+            for (i = ini; i < fim && psi > 0.0; i++) {
+                uint64_t h = kinit_mix(ki->semente ^ kinit_mix(((uint64_t)(r + 1) << 32) | (uint32_t)i));
+                double u = (double)(h >> 11) * (1.0 / 9007199254740992.0);
+                if (u * psi < l * ki->d2[i])
+                    ki->amostra[ini + cont++] = i;
+            }
+            ki->namostras[id] = cont;
+        }
+        espera(id);
+
+        // Os sorteados entram como candidatos na ordem dos pontos
+        if (id == 0) {
+            ki->novos_ini = ki->ncand;
+            for (t = 0; t < num_threads; t++) {
+                int tb_ini, tb_fim, s;
+                kinit_blocos(ki, t, num_threads, &tb_ini, &tb_fim);
+                for (s = 0; s < ki->namostras[t]; s++)
+                    ki->cand[ki->ncand++] = ki->amostra[tb_ini * KINIT_BLOCO + s];
+            }
+        }
+        espera(id);
+    }
+
+    // Peso de cada candidato e redução a K centróides (thread 0)
+    if (id == 0) {
+        for (i = 0; i < ki->ncand; i++)
+            ki->amostra[i] = 0;
+        for (i = 0; i < ki->n; i++)
+            ki->amostra[ki->prox[i]]++;
+        kinit_reduz_candidatos(ki);
+    }
+    espera(id);
+}
+
+
+// Escolhe os K centróides iniciais em 'mean' com o método de 'ki', executado
+// pela thread 'id' de 'num_threads' (todas devem chamar). 'espera(id)' deve
+// bloquear até todas as threads chegarem. Ao retornar, 'mean' está completo
+// em todas as threads.
+static inline void kinit_run(kinit_t *ki, int id, int num_threads, void (*espera)(int)) {
+    if (ki->metodo == INIT_INPUT || ki->n <= 0)
+        return;
+    if (ki->k_ini > 0)
+        kinit_amplia(ki, id, num_threads, espera);
+    else if (ki->metodo == INIT_KMEANSPP)
+        kinit_kmeanspp(ki, id, num_threads, espera);
+    else
+        kinit_kmeanspar(ki, id, num_threads, espera);
+}
+
+#endif
@@ -0,0 +1,851 @@
+#ifndef KMEANS_IO_H
+#define KMEANS_IO_H
+
+// Entrada/saída de datasets do K-Means.
+//
+// Além do formato texto gerado pelo geninput.py (K, N e depois K+N linhas de
+// coordenadas; DIM é o número de coordenadas da primeira linha), os programas
+// aceitam um formato binário compacto que pode ser mapeado em memória (mmap)
+// diretamente nos arrays 'mean' e 'x', sem nenhuma conversão ou cópia:
+//
+//   offset  0: magic "KMB1"            (4 bytes)
+//   offset  4: versao                  (uint32, = 1)
+//   offset  8: K                       (uint32)
+//   offset 12: DIM                     (uint32)
+//   offset 16: N                       (uint64)
+//   offset 24: tamanho do elemento     (uint32, 8 = double, 4 = float)
+//   offset 28..63: reservado (zeros)
+//   offset 64: K*DIM coordenadas dos centróides, seguidas de N*DIM coordenadas
+//              dos pontos, em ordem de linha (mesma ordem do arquivo texto).
+//
+// O cabeçalho tem 64 bytes para que os dados comecem alinhados a uma linha de
+// cache. Os valores são gravados na ordem de bytes nativa da máquina.
+//
+// No modo float (-p float, ver dataset_use_float) os pontos ficam em 'xf'
+// (float32) e os centróides continuam em double. Um arquivo binário com
+// elementos de 4 bytes é mapeado direto em 'xf'; só os K centróides são
+// convertidos.
+//
+// Pontos que precisam ser copiados de um binário (conversão para float ou
+// cópia privada, ver dataset_private_points) vão para um buffer cujas páginas
+// ainda não foram tocadas; a cópia fica pendente em 'origem' e pode ser feita
+// por faixas (dataset_copy_points), cada thread escrevendo as suas páginas.
+//
+// A entrada texto é lida de uma vez só para a memória e convertida em fatias
+// alinhadas a quebras de linha (text_chunk/text_count_records/
+// text_parse_records), o que permite que cada thread converta a sua parte.
+//
+// Os rótulos finais (opção -l dos programas) vão para um arquivo texto (um
+// rótulo por linha, se o nome termina em ".txt") ou para um binário compacto
+// com rótulos de 1, 2 ou 4 bytes, o menor tamanho que comporta K:
+//
+//   offset  0: magic "KML1"            (4 bytes)
+//   offset  4: versao                  (uint32, = 1)
+//   offset  8: K                       (uint32)
+//   offset 12: tamanho do rótulo       (uint32, 1 = uint8, 2 = uint16, 4 = uint32)
+//   offset 16: N                       (uint64)
+//   offset 24..31: reservado (zeros)
+//   offset 32: N rótulos, na ordem dos pontos
+//
+// As fatias do arquivo são preenchidas em buffers separados (kml_preenche),
+// um por thread, e gravadas em ordem por kml_grava. A inércia de cada
+// cluster (opção -Q) vai para um CSV "cluster,pontos,inercia" (kml_grava_inercias).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#define KMEANS_IO_NO_MMAP
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define KMB_MAGIC "KMB1"
+#define KMB_VERSAO 1
+#define KMB_HEADER_SIZE 64
+
+#define KML_MAGIC "KML1"
+#define KML_VERSAO 1
+
+typedef struct kmb_header_t {
+    char magic[4];
+    uint32_t versao;
+    uint32_t k;
+    uint32_t dim;
+    uint64_t n;
+    uint32_t elem_size;
+    uint8_t reservado[KMB_HEADER_SIZE - 28];
+} kmb_header_t;
+
+typedef struct kml_header_t {
+    char magic[4];
+    uint32_t versao;
+    uint32_t k;
+    uint32_t tam_rotulo;
+    uint64_t n;
+    uint8_t reservado[8];
+} kml_header_t;
+
+// Dataset carregado na memória. 'mean' e 'x' (ou 'xf') apontam para dentro do
+// mapeamento do arquivo ('map') ou para os buffers 'dados' (malloc) e 'dados_p'
+// (kmeans_pages_alloc). Enquanto 'texto' != NULL, as coordenadas ainda não
+// foram convertidas; enquanto 'origem' != NULL, os pontos ainda não foram copiados.
+typedef struct dataset_t {
+    int k, n, dim;
+    double *x, *mean;
+    float *xf;           // Pontos em float32 (modo float); então x == NULL
+    void *dados_p;       // Buffer dos pontos copiados ('xf' ou cópia de 'x'), se houver
+    size_t dados_p_size;
+    const void *origem;  // Pontos do binário pendentes de cópia para 'dados_p'
+    int origem_elem;     // Tamanho de cada coordenada em 'origem' (8 ou 4)
+
+    void *map;           // Mapeamento do arquivo (-i), se houver
+    size_t map_size;
+    void *dados;         // Buffer alocado com as coordenadas, se houver
+
+    const char *texto;   // Entrada texto pendente de conversão
+    size_t texto_len;
+    size_t texto_ini;    // Início da primeira linha de coordenadas
+    char *buf;           // Conteúdo lido com fread (stdin), se houver
+} dataset_t;
+
+
+// Preenche um cabeçalho binário para K centróides e N pontos de dimensão DIM.
+static inline void kmb_header_init(kmb_header_t *h, int k, int n, int dim, int elem_size) {
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, KMB_MAGIC, 4);
+    h->versao = KMB_VERSAO;
+    h->k = (uint32_t)k;
+    h->dim = (uint32_t)dim;
+    h->n = (uint64_t)n;
+    h->elem_size = (uint32_t)elem_size;
+}
+
+
+// Valida um cabeçalho lido do disco, com no máximo 'n_max' pontos (os arrays
+// carregados inteiros são indexados com int). Retorna 0 se ok, -1 (com mensagem) se não.
+static inline int kmb_header_check(const kmb_header_t *h, const char *path, uint64_t n_max) {
+    if (memcmp(h->magic, KMB_MAGIC, 4) != 0) {
+        fprintf(stderr, "Erro: '%s' nao e um dataset binario (magic invalido).\n", path);
+        return -1;
+    }
+    if (h->versao != KMB_VERSAO) {
+        fprintf(stderr, "Erro: versao %u do formato binario nao suportada.\n", h->versao);
+        return -1;
+    }
+    if (h->elem_size != sizeof(double) && h->elem_size != sizeof(float)) {
+        fprintf(stderr, "Erro: tamanho de elemento %u nao suportado.\n", h->elem_size);
+        return -1;
+    }
+    if (h->k == 0 || h->dim == 0 || h->n > n_max || h->k > 0x7fffffffu) {
+        fprintf(stderr, "Erro: cabecalho com K=%u, N=%llu, DIM=%u invalido.\n",
+                h->k, (unsigned long long)h->n, h->dim);
+        return -1;
+    }
+    return 0;
+}
+
+
+//  CONVERSÃO DE TEXTO
+
+// Potências de 10 exatamente representáveis em double
+static const double kmeans_pot10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline int text_is_space(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\f' || ch == '\v';
+}
+
+
+// Converte um número real começando em 'p' (sem passar de 'fim').
+// Quando mantissa e expoente cabem em double de forma exata (caso dos "%f"
+// do geninput.py) o resultado é uma única multiplicação/divisão, com o mesmo
+// arredondamento do strtod/scanf; nos demais casos recorre ao strtod.
+// Retorna o ponteiro após o número ou NULL se não houver número válido.
+static inline const char *text_parse_double(const char *p, const char *fim, double *out) {
+    const char *ini = p;
+    uint64_t mant = 0;
+    int digitos = 0, exp10 = 0, neg = 0, tem_digito = 0;
+
+    if (p < fim && (*p == '-' || *p == '+')) {
+        neg = (*p == '-');
+        p++;
+    }
+    while (p < fim && *p >= '0' && *p <= '9') {
+        if (digitos < 19) {
+            mant = mant * 10 + (uint64_t)(*p - '0');
+            if (mant != 0) digitos++;
+        } else {
+            exp10++;
+        }
+        tem_digito = 1;
+        p++;
+    }
+    if (p < fim && *p == '.') {
+        p++;
+        while (p < fim && *p >= '0' && *p <= '9') {
+            if (digitos < 19) {
+                mant = mant * 10 + (uint64_t)(*p - '0');
+                if (mant != 0) digitos++;
+                exp10--;
+            }
+            tem_digito = 1;
+            p++;
+        }
+    }
+    if (!tem_digito)
+        return NULL;
+    if (p < fim && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        int eneg = 0, e = 0, tem_e = 0;
+        if (q < fim && (*q == '-' || *q == '+')) {
+            eneg = (*q == '-');
+            q++;
+        }
+        while (q < fim && *q >= '0' && *q <= '9') {
+            if (e < 10000) e = e * 10 + (*q - '0');
+            tem_e = 1;
+            q++;
+        }
+        if (tem_e) {
+            exp10 += eneg ? -e : e;
+            p = q;
+        }
+    }
+
+    if (digitos < 19 && mant <= ((uint64_t)1 << 53) && exp10 >= -22 && exp10 <= 22) {
+        double v = (double)mant;
+        v = (exp10 < 0) ? v / kmeans_pot10[-exp10] : v * kmeans_pot10[exp10];
+        *out = neg ? -v : v;
+    } else {
+        // Caminho lento: copia o token para ter um terminador '\0'
+        char tmp[128];
+        size_t len = (size_t)(p - ini);
+        if (len >= sizeof(tmp))
+            return NULL;
+        memcpy(tmp, ini, len);
+        tmp[len] = '\0';
+        *out = strtod(tmp, NULL);
+    }
+    return p;
+}
+
+
+// Limites [ini, fim) da parte 'parte' de 'partes' do corpo do texto.
+// As fronteiras são deslocadas para o início de uma linha, então partes
+// vizinhas nunca dividem uma linha ao meio.
+static inline void text_chunk(const dataset_t *ds, int parte, int partes, size_t *ini, size_t *fim) {
+    size_t corpo = ds->texto_len - ds->texto_ini;
+    size_t limite[2];
+    int lado;
+
+    for (lado = 0; lado < 2; lado++) {
+        size_t pos = ds->texto_ini + (size_t)((double)corpo * (parte + lado) / partes);
+        if (parte + lado >= partes)
+            pos = ds->texto_len;
+        while (pos > ds->texto_ini && pos < ds->texto_len && ds->texto[pos - 1] != '\n')
+            pos++;
+        limite[lado] = pos;
+    }
+    *ini = limite[0];
+    *fim = limite[1];
+}
+
+
+// Conta as linhas não vazias (registros de coordenadas) em [ini, fim).
+static inline long text_count_records(const dataset_t *ds, size_t ini, size_t fim) {
+    const char *p = ds->texto + ini;
+    const char *f = ds->texto + fim;
+    long registros = 0;
+
+    while (p < f) {
+        const char *eol = (const char *)memchr(p, '\n', (size_t)(f - p));
+        if (eol == NULL) eol = f;
+        while (p < eol && text_is_space(*p)) p++;
+        if (p < eol) registros++;
+        p = eol + 1;
+    }
+    return registros;
+}
+
+
+// Converte os registros de [ini, fim), sendo 'primeiro' o índice global do
+// primeiro registro da fatia: os K primeiros vão para 'mean', os demais para 'x'.
+// No modo float os pontos vão para 'xf'.
+// Retorna 0 se ok, ou -1 se alguma linha não tiver exatamente DIM números.
+static inline int text_parse_records(dataset_t *ds, size_t ini, size_t fim, long primeiro) {
+    const char *p = ds->texto + ini;
+    const char *f = ds->texto + fim;
+    long r = primeiro;
+    int j, dim = ds->dim;
+    double v;
+
+    while (p < f) {
+        const char *eol = (const char *)memchr(p, '\n', (size_t)(f - p));
+        double *dst;
+        float *dst_f = NULL;
+        if (eol == NULL) eol = f;
+        while (p < eol && text_is_space(*p)) p++;
+        if (p == eol) { // Linha em branco
+            p = eol + 1;
+            continue;
+        }
+        if (r >= (long)ds->k + ds->n)
+            return -1;
+        dst = (r < ds->k) ? ds->mean + (size_t)r * dim : ds->x + (size_t)(r - ds->k) * dim;
+        if (r >= ds->k && ds->x == NULL)
+            dst_f = ds->xf + (size_t)(r - ds->k) * dim;
+        for (j = 0; j < dim; j++) {
+            while (p < eol && text_is_space(*p)) p++;
+            p = text_parse_double(p, eol, dst_f != NULL ? &v : dst + j);
+            if (p == NULL)
+                return -1;
+            if (dst_f != NULL)
+                dst_f[j] = (float)v;
+        }
+        while (p < eol && text_is_space(*p)) p++;
+        if (p != eol)
+            return -1;
+        r++;
+        p = eol + 1;
+    }
+    return 0;
+}
+
+
+// Lê um inteiro não negativo do cabeçalho texto a partir de *pos.
+static inline int text_parse_header_int(const dataset_t *ds, size_t *pos, long *valor) {
+    size_t i = *pos;
+    long v = 0;
+
+    while (i < ds->texto_len && (text_is_space(ds->texto[i]) || ds->texto[i] == '\n')) i++;
+    if (i >= ds->texto_len || ds->texto[i] < '0' || ds->texto[i] > '9')
+        return -1;
+    while (i < ds->texto_len && ds->texto[i] >= '0' && ds->texto[i] <= '9') {
+        v = v * 10 + (ds->texto[i] - '0');
+        if (v > 0x7fffffff)
+            return -1;
+        i++;
+    }
+    *pos = i;
+    *valor = v;
+    return 0;
+}
+
+
+// Número de coordenadas (campos separados por espaço) da primeira linha não
+// vazia a partir de 'pos': é o DIM da entrada texto. Retorna 0 se não houver.
+static inline int text_count_fields(const dataset_t *ds, size_t pos) {
+    int campos = 0;
+
+    while (pos < ds->texto_len && (text_is_space(ds->texto[pos]) || ds->texto[pos] == '\n')) pos++;
+    while (pos < ds->texto_len && ds->texto[pos] != '\n') {
+        while (pos < ds->texto_len && text_is_space(ds->texto[pos])) pos++;
+        if (pos >= ds->texto_len || ds->texto[pos] == '\n')
+            break;
+        campos++;
+        while (pos < ds->texto_len && ds->texto[pos] != '\n' && !text_is_space(ds->texto[pos])) pos++;
+    }
+    return campos;
+}
+
+
+//  ABERTURA DO DATASET
+
+// Buffer de 'size' bytes cujas páginas ainda não foram tocadas: a primeira
+// escrita em cada página decide em que nó NUMA ela fica (first-touch).
+static inline void *kmeans_pages_alloc(size_t size) {
+#ifndef KMEANS_IO_NO_MMAP
+    void *p = mmap(NULL, size > 0 ? size : 1, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return (p == MAP_FAILED) ? NULL : p;
+#else
+    return malloc(size > 0 ? size : 1);
+#endif
+}
+
+static inline void kmeans_pages_free(void *p, size_t size) {
+    if (p == NULL)
+        return;
+#ifndef KMEANS_IO_NO_MMAP
+    munmap(p, size > 0 ? size : 1);
+#else
+    (void)size;
+    free(p);
+#endif
+}
+
+
+// Libera o dataset (mapeamento, buffers de dados e de texto).
+static inline void dataset_free(dataset_t *ds) {
+#ifndef KMEANS_IO_NO_MMAP
+    if (ds->map != NULL)
+        munmap(ds->map, ds->map_size);
+#endif
+    free(ds->dados);
+    kmeans_pages_free(ds->dados_p, ds->dados_p_size);
+    free(ds->buf);
+    memset(ds, 0, sizeof(*ds));
+}
+
+
+// Interpreta 'len' bytes de 'mem' como dataset binário (se começar com o
+// magic) ou texto. No caso texto, lê K e N, deduz DIM da primeira linha de
+// coordenadas, aloca 'mean'/'x' e deixa as coordenadas pendentes em ds->texto.
+static inline int dataset_from_memory(dataset_t *ds, const char *mem, size_t len, const char *nome) {
+    if (len >= KMB_HEADER_SIZE && memcmp(mem, KMB_MAGIC, 4) == 0) {
+        kmb_header_t h;
+        size_t esperado;
+
+        memcpy(&h, mem, sizeof(h));
+        if (kmb_header_check(&h, nome, 0x7fffffff) != 0)
+            return -1;
+        // (K+N)*DIM*elem_size sem estouro de size_t: um cabeçalho corrompido
+        // com DIM ou N enormes não pode passar pela comparação com o tamanho
+        esperado = (size_t)h.k + (size_t)h.n;
+        if (h.dim > 0x7fffffffu || esperado > SIZE_MAX / h.dim ||
+            esperado * h.dim > (SIZE_MAX - KMB_HEADER_SIZE) / h.elem_size) {
+            fprintf(stderr, "Erro: cabecalho de '%s' com K=%u, N=%llu, DIM=%u invalido.\n", nome,
+                    h.k, (unsigned long long)h.n, h.dim);
+            return -1;
+        }
+        esperado *= h.dim;
+        if (len < KMB_HEADER_SIZE + h.elem_size * esperado) {
+            fprintf(stderr, "Erro: '%s' esta truncado (esperados %zu valores).\n", nome, esperado);
+            return -1;
+        }
+        ds->k = (int)h.k;
+        ds->n = (int)h.n;
+        ds->dim = (int)h.dim;
+        if (h.elem_size == sizeof(float)) {
+            // Pontos mapeados em 'xf'; centróides convertidos para double
+            const float *cf = (const float *)(mem + KMB_HEADER_SIZE);
+            size_t i, nk = (size_t)ds->k * ds->dim;
+            ds->dados = malloc(sizeof(double) * nk);
+            if (ds->dados == NULL) {
+                fprintf(stderr, "Erro: Falha ao alocar memoria para %zu coordenadas.\n", nk);
+                return -1;
+            }
+            ds->mean = (double *)ds->dados;
+            for (i = 0; i < nk; i++)
+                ds->mean[i] = cf[i];
+            ds->xf = (float *)(cf + nk);
+            return 0;
+        }
+        ds->mean = (double *)(mem + KMB_HEADER_SIZE);
+    } else {
+        long k, n;
+        size_t pos = 0, total;
+        int dim;
+
+        ds->texto = mem;
+        ds->texto_len = len;
+        if (text_parse_header_int(ds, &pos, &k) != 0 || text_parse_header_int(ds, &pos, &n) != 0 || k <= 0) {
+            fprintf(stderr, "Erro: cabecalho da entrada texto invalido (esperado K e N).\n");
+            return -1;
+        }
+        // As coordenadas começam na linha seguinte à de N
+        while (pos < len && mem[pos] != '\n') pos++;
+        ds->texto_ini = (pos < len) ? pos + 1 : len;
+        dim = text_count_fields(ds, ds->texto_ini);
+        if (dim <= 0) {
+            fprintf(stderr, "Erro: entrada texto sem coordenadas apos K e N.\n");
+            return -1;
+        }
+
+        ds->k = (int)k;
+        ds->n = (int)n;
+        ds->dim = dim;
+        total = ((size_t)k + (size_t)n) * dim;
+        ds->dados = malloc(sizeof(double) * total);
+        if (ds->dados == NULL) {
+            fprintf(stderr, "Erro: Falha ao alocar memoria para %zu coordenadas.\n", total);
+            return -1;
+        }
+        ds->mean = (double *)ds->dados;
+    }
+    ds->x = ds->mean + (size_t)ds->k * ds->dim;
+    return 0;
+}
+
+
+// Lê todo o conteúdo de 'f' para um buffer alocado.
+static inline char *kmeans_read_all(FILE *f, size_t *len) {
+    size_t cap = 1 << 20, usado = 0, lido;
+    char *buf = (char *)malloc(cap);
+
+    while (buf != NULL && (lido = fread(buf + usado, 1, cap - usado, f)) > 0) {
+        usado += lido;
+        if (usado == cap) {
+            char *novo = (char *)realloc(buf, cap * 2);
+            if (novo == NULL) {
+                free(buf);
+                return NULL;
+            }
+            buf = novo;
+            cap *= 2;
+        }
+    }
+    *len = usado;
+    return buf;
+}
+
+
+// Abre o dataset de 'path' (ou do stdin, se 'path' for NULL), em formato
+// binário ou texto. Em sistemas POSIX o arquivo é mapeado com MAP_PRIVATE:
+// os pontos são lidos direto do page cache e as escritas em 'mean' ficam só no
+// processo (copy-on-write), sem alterar o arquivo. DIM vem do cabeçalho
+// binário ou da primeira linha do texto; para entrada texto a conversão fica
+// pendente (ver dataset_parse_text). Retorna 0 se ok, -1 em caso de erro
+// (mensagem já impressa em stderr).
+static inline int dataset_open(const char *path, dataset_t *ds) {
+    const char *mem;
+    size_t len;
+
+    memset(ds, 0, sizeof(*ds));
+
+#ifndef KMEANS_IO_NO_MMAP
+    if (path != NULL) {
+        struct stat st;
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "Erro: nao foi possivel abrir '%s'.\n", path);
+            return -1;
+        }
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            fprintf(stderr, "Erro: '%s' esta vazio.\n", path);
+            close(fd);
+            return -1;
+        }
+        ds->map_size = (size_t)st.st_size;
+        ds->map = mmap(NULL, ds->map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd); // O mapeamento continua válido após o close
+        if (ds->map == MAP_FAILED) {
+            fprintf(stderr, "Erro: mmap de '%s' falhou.\n", path);
+            ds->map = NULL;
+            return -1;
+        }
+        // Os dados são percorridos sequencialmente (leitura e iterações)
+        madvise(ds->map, ds->map_size, MADV_SEQUENTIAL);
+        mem = (const char *)ds->map;
+        len = ds->map_size;
+    } else
+#endif
+    {
+        FILE *f = (path != NULL) ? fopen(path, "rb") : stdin;
+        if (f == NULL) {
+            fprintf(stderr, "Erro: nao foi possivel abrir '%s'.\n", path != NULL ? path : "stdin");
+            return -1;
+        }
+        ds->buf = kmeans_read_all(f, &len);
+        if (path != NULL)
+            fclose(f);
+        if (ds->buf == NULL) {
+            fprintf(stderr, "Erro: Falha ao ler a entrada.\n");
+            return -1;
+        }
+        mem = ds->buf;
+    }
+
+    if (dataset_from_memory(ds, mem, len, path != NULL ? path : "stdin") != 0) {
+        dataset_free(ds);
+        return -1;
+    }
+    return 0;
+}
+
+
+// Aloca 'dados_p' para os N pontos com coordenadas de 'elem_size' bytes.
+static inline int dataset_alloc_points(dataset_t *ds, int elem_size) {
+    size_t nx = (size_t)ds->n * ds->dim;
+
+    ds->dados_p_size = (size_t)elem_size * nx;
+    ds->dados_p = kmeans_pages_alloc(ds->dados_p_size);
+    if (ds->dados_p == NULL) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para %zu coordenadas.\n", nx);
+        return -1;
+    }
+    return 0;
+}
+
+// Passa o dataset para o modo float: os pontos ficam em 'xf' e 'x' = NULL.
+// Para entrada texto ainda não convertida, só os centróides ficam em 'dados'
+// e os pontos serão convertidos direto para float; para binário double, a
+// conversão fica pendente em 'origem'. Retorna 0 se ok, -1 se faltar memória.
+static inline int dataset_use_float(dataset_t *ds) {
+    if (ds->xf != NULL)
+        return 0; // Binário float: já mapeado em 'xf'
+    if (dataset_alloc_points(ds, sizeof(float)) != 0)
+        return -1;
+    ds->xf = (float *)ds->dados_p;
+    if (ds->texto != NULL) {
+        void *menor = realloc(ds->dados, sizeof(double) * (size_t)ds->k * ds->dim);
+        if (menor != NULL)
+            ds->dados = menor;
+        ds->mean = (double *)ds->dados;
+    } else {
+        ds->origem = ds->x;
+        ds->origem_elem = sizeof(double);
+    }
+    ds->x = NULL;
+    return 0;
+}
+
+
+// Troca os pontos de um binário (mapeados do page cache ou lidos do stdin) por
+// uma cópia privada ainda não escrita, para que cada thread faça a cópia da sua
+// fatia e as páginas fiquem no nó NUMA dela. Não faz nada para entrada texto
+// (convertida pelas threads) nem se a cópia já estiver pendente.
+// Retorna 0 se ok, -1 se faltar memória.
+static inline int dataset_private_points(dataset_t *ds) {
+    if (ds->texto != NULL || ds->origem != NULL)
+        return 0;
+    if (ds->xf != NULL) {
+        if (dataset_alloc_points(ds, sizeof(float)) != 0)
+            return -1;
+        ds->origem = ds->xf;
+        ds->origem_elem = sizeof(float);
+        ds->xf = (float *)ds->dados_p;
+    } else {
+        if (dataset_alloc_points(ds, sizeof(double)) != 0)
+            return -1;
+        ds->origem = ds->x;
+        ds->origem_elem = sizeof(double);
+        ds->x = (double *)ds->dados_p;
+    }
+    return 0;
+}
+
+// Copia (convertendo para float, se for o caso) os pontos [ini, fim) de
+// 'origem' para 'x'/'xf'. Threads diferentes podem copiar faixas diferentes.
+static inline void dataset_copy_points(dataset_t *ds, int ini, int fim) {
+    size_t i, a = (size_t)ini * ds->dim, b = (size_t)fim * ds->dim;
+
+    if (ds->xf != NULL && ds->origem_elem == sizeof(double)) {
+        const double *o = (const double *)ds->origem;
+        for (i = a; i < b; i++)
+            ds->xf[i] = (float)o[i];
+    } else if (ds->xf != NULL) {
+        memcpy(ds->xf + a, (const float *)ds->origem + a, sizeof(float) * (b - a));
+    } else {
+        memcpy(ds->x + a, (const double *)ds->origem + a, sizeof(double) * (b - a));
+    }
+}
+
+// Escreve zeros nos pontos [ini, fim), só para tocar as páginas na thread que
+// vai usá-los (a entrada texto é convertida em fatias que não coincidem com
+// as fatias de pontos das threads).
+static inline void dataset_touch_points(dataset_t *ds, int ini, int fim) {
+    size_t a = (size_t)ini * ds->dim, b = (size_t)fim * ds->dim;
+    if (ds->xf != NULL)
+        memset(ds->xf + a, 0, sizeof(float) * (b - a));
+    else
+        memset(ds->x + a, 0, sizeof(double) * (b - a));
+}
+
+
+// Descarta o texto de entrada depois que todas as coordenadas foram convertidas
+// (ou a origem dos pontos, depois que todos foram copiados).
+static inline void dataset_text_release(dataset_t *ds) {
+    ds->origem = NULL;
+    if (ds->texto == NULL)
+        return; // Binário: o mapeamento contém os próprios dados
+    ds->texto = NULL;
+    if (ds->buf != NULL && ds->dados != NULL) {
+        free(ds->buf);
+        ds->buf = NULL;
+    }
+#ifndef KMEANS_IO_NO_MMAP
+    if (ds->map != NULL && ds->dados != NULL) {
+        munmap(ds->map, ds->map_size);
+        ds->map = NULL;
+    }
+#endif
+}
+
+
+// Converte toda a entrada texto (ou copia todos os pontos) pendente em uma
+// única thread. Retorna 0 se ok, -1 em caso de erro (mensagem já impressa em stderr).
+static inline int dataset_parse_text(dataset_t *ds) {
+    long esperado = (long)ds->k + ds->n;
+
+    if (ds->origem != NULL) {
+        dataset_copy_points(ds, 0, ds->n);
+        ds->origem = NULL;
+    }
+    if (ds->texto == NULL)
+        return 0;
+    if (text_count_records(ds, ds->texto_ini, ds->texto_len) != esperado ||
+        text_parse_records(ds, ds->texto_ini, ds->texto_len, 0) != 0) {
+        fprintf(stderr, "Erro: entrada texto deve ter %ld linhas com %d coordenadas.\n", esperado, ds->dim);
+        return -1;
+    }
+    dataset_text_release(ds);
+    return 0;
+}
+
+
+// Grava um dataset no formato binário. Retorna 0 se ok, -1 em caso de erro.
+// 'elem_size' é 8 (double) ou 4 (float; os valores são arredondados para float32).
+static inline int dataset_write_bin(const char *path, const dataset_t *ds, int elem_size) {
+    kmb_header_t h;
+    size_t i, nk = (size_t)ds->k * ds->dim;
+    size_t nx = (size_t)ds->n * ds->dim;
+    int ok;
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        fprintf(stderr, "Erro: nao foi possivel criar '%s'.\n", path);
+        return -1;
+    }
+    kmb_header_init(&h, ds->k, ds->n, ds->dim, elem_size);
+    // 'mean' e 'x' podem não ser contíguos, então são gravados separadamente
+    ok = (fwrite(&h, sizeof(h), 1, f) == 1);
+    if (elem_size == sizeof(float)) {
+        for (i = 0; ok && i < nk; i++) {
+            float v = (float)ds->mean[i];
+            ok = (fwrite(&v, sizeof(float), 1, f) == 1);
+        }
+        if (ok && ds->xf != NULL) {
+            ok = (fwrite(ds->xf, sizeof(float), nx, f) == nx);
+        } else {
+            for (i = 0; ok && i < nx; i++) {
+                float v = (float)ds->x[i];
+                ok = (fwrite(&v, sizeof(float), 1, f) == 1);
+            }
+        }
+    } else {
+        ok = ok && fwrite(ds->mean, sizeof(double), nk, f) == nk &&
+             fwrite(ds->x, sizeof(double), nx, f) == nx;
+    }
+    if (!ok) {
+        fprintf(stderr, "Erro: falha ao gravar '%s'.\n", path);
+        fclose(f);
+        return -1;
+    }
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+
+//  SAÍDA DOS RÓTULOS E DAS INÉRCIAS
+
+// Escreve o inteiro não negativo 'v' em 's'. Retorna o número de caracteres.
+static inline int kml_escreve_rotulo(char *s, int v) {
+    char dig[12];
+    int n = 0, k = 0;
+
+    do {
+        dig[k++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v > 0);
+    while (k > 0)
+        s[n++] = dig[--k];
+    return n;
+}
+
+// Tamanho de cada rótulo no binário: o menor que comporta os índices 0..K-1.
+static inline int kml_tam_rotulo(int k) {
+    return (k <= 256) ? 1 : (k <= 65536) ? 2 : 4;
+}
+
+// O arquivo de rótulos 'path' é texto (termina em ".txt") ou binário.
+static inline int kml_eh_texto(const char *path) {
+    size_t len = strlen(path);
+    return len >= 4 && strcmp(path + len - 4, ".txt") == 0;
+}
+
+// Bytes que bastam para 'n' rótulos (10 dígitos e a quebra de linha no texto).
+static inline size_t kml_limite(int n, int texto, int tam) {
+    return (size_t)n * (texto ? 11 : (size_t)tam);
+}
+
+// Preenche 'buf' com os rótulos cluster[ini..fim), como no arquivo (texto ou
+// binário com rótulos de 'tam' bytes). Retorna o número de bytes escritos.
+static inline size_t kml_preenche(void *buf, const int *cluster, int ini, int fim, int texto, int tam) {
+    size_t len = 0;
+    int i;
+
+    if (texto) {
+        char *out = (char *)buf;
+        for (i = ini; i < fim; i++) {
+            len += (size_t)kml_escreve_rotulo(out + len, cluster[i]);
+            out[len++] = '\n';
+        }
+    } else if (tam == 1) {
+        for (i = ini; i < fim; i++)
+            ((uint8_t *)buf)[i - ini] = (uint8_t)cluster[i];
+        len = (size_t)(fim - ini);
+    } else if (tam == 2) {
+        for (i = ini; i < fim; i++)
+            ((uint16_t *)buf)[i - ini] = (uint16_t)cluster[i];
+        len = (size_t)(fim - ini) * 2;
+    } else {
+        for (i = ini; i < fim; i++)
+            ((uint32_t *)buf)[i - ini] = (uint32_t)cluster[i];
+        len = (size_t)(fim - ini) * 4;
+    }
+    return len;
+}
+
+// Grava em 'path' os rótulos de K clusters e N pontos que estão nos
+// 'partes' buffers 'bufs' (com 'lens' bytes cada, na ordem dos pontos),
+// precedidos do cabeçalho no formato binário. Retorna 0 se ok, -1 se falhar.
+static inline int kml_grava(const char *path, int k, int n, int texto, int tam,
+                            void *const *bufs, const size_t *lens, int partes) {
+    kml_header_t h;
+    int p, ok;
+    FILE *f = fopen(path, "wb");
+
+    if (f == NULL) {
+        fprintf(stderr, "Erro: nao foi possivel criar '%s'.\n", path);
+        return -1;
+    }
+    ok = 1;
+    if (!texto) {
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, KML_MAGIC, 4);
+        h.versao = KML_VERSAO;
+        h.k = (uint32_t)k;
+        h.tam_rotulo = (uint32_t)tam;
+        h.n = (uint64_t)n;
+        ok = (fwrite(&h, sizeof(h), 1, f) == 1);
+    }
+    for (p = 0; ok && p < partes; p++)
+        ok = (lens[p] == 0 || fwrite(bufs[p], 1, lens[p], f) == lens[p]);
+    if (fclose(f) != 0 || !ok) {
+        fprintf(stderr, "Erro: falha ao gravar '%s'.\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+// Grava em 'path' o CSV com os pontos e a inércia de cada um dos K clusters,
+// com 'formato' ("%.6f" ou "%.17g"). Retorna 0 se ok, -1 se falhar.
+static inline int kml_grava_inercias(const char *path, int k, const int *pontos, const double *inercia,
+                                     const char *formato) {
+    int c, ok;
+    FILE *f = fopen(path, "w");
+
+    if (f == NULL) {
+        fprintf(stderr, "Erro: nao foi possivel criar '%s'.\n", path);
+        return -1;
+    }
+    ok = fprintf(f, "cluster,pontos,inercia\n") > 0;
+    for (c = 0; ok && c < k; c++) {
+        ok = fprintf(f, "%d,%d,", c, pontos[c]) > 0 && fprintf(f, formato, inercia[c]) > 0 &&
+             fputc('\n', f) != EOF;
+    }
+    if (fclose(f) != 0 || !ok) {
+        fprintf(stderr, "Erro: falha ao gravar '%s'.\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+
+#endif
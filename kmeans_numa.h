@@ -0,0 +1,282 @@
+#ifndef KMEANS_NUMA_H
+#define KMEANS_NUMA_H
+
+// Fixação das threads em núcleos e relatório de onde ficaram as páginas
+// (opção -c da versão concorrente):
+//
+//   PIN_NONE     o escalonador do sistema decide (o original).
+//   PIN_COMPACT  threads vizinhas em núcleos vizinhos: enche um nó NUMA (e os
+//                núcleos físicos dele antes dos irmãos SMT) antes do próximo.
+//   PIN_SCATTER  threads distribuídas em rodízio entre os nós NUMA.
+//
+// Com a fixação ligada, cada thread fixa-se no seu núcleo antes de escrever
+// pela primeira vez a sua fatia de 'x' e de 'cluster' e os seus arrays
+// locais, que foram alocados sem ser tocados (kmeans_pages_alloc): com a
+// política first-touch do Linux as páginas ficam no nó da thread.
+//
+// Não depende da libnuma: a topologia vem do sysfs e o nó de cada página da
+// chamada de sistema move_pages. Sem sysfs, todos os núcleos permitidos ficam
+// em um único nó; sem suporte a NUMA no kernel (ou fora do Linux), o relatório
+// mostra '?' e, se não der para fixar, as threads seguem sem fixação.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+#define PIN_NONE    0
+#define PIN_COMPACT 1
+#define PIN_SCATTER 2
+
+#define KNUMA_MAX_CPUS     4096
+#define KNUMA_MAX_AMOSTRAS 256     // Páginas consultadas por faixa no relatório
+#define KNUMA_MASK_LONGS   (KNUMA_MAX_CPUS / (8 * sizeof(unsigned long)))
+
+typedef struct knuma_cpu_t {
+    int cpu;
+    int no;        // Nó NUMA
+    int pacote;    // Soquete
+    int nucleo;    // core_id dentro do soquete
+    int smt;       // Ordem entre os irmãos SMT do mesmo núcleo (0 = primeiro)
+} knuma_cpu_t;
+
+typedef struct knuma_topologia_t {
+    int ncpus;         // Núcleos lógicos permitidos ao processo
+    int nnos;          // Nós NUMA com algum desses núcleos
+    knuma_cpu_t *cpus;
+} knuma_topologia_t;
+
+
+// Converte o nome passado na linha de comando (-c) para PIN_*; -1 se inválido.
+static inline int knuma_parse_politica(const char *nome) {
+    if (strcmp(nome, "none") == 0) return PIN_NONE;
+    if (strcmp(nome, "compact") == 0) return PIN_COMPACT;
+    if (strcmp(nome, "scatter") == 0) return PIN_SCATTER;
+    return -1;
+}
+
+static inline const char *knuma_nome(int politica) {
+    static const char *nomes[] = { "none", "compact", "scatter" };
+    return (politica >= 0 && politica <= PIN_SCATTER) ? nomes[politica] : "?";
+}
+
+
+// Lê um inteiro de um arquivo do sysfs; 'padrao' se não existir.
+static inline int knuma_le_int(const char *caminho, int padrao) {
+    FILE *f = fopen(caminho, "r");
+    int v;
+    if (f == NULL)
+        return padrao;
+    if (fscanf(f, "%d", &v) != 1)
+        v = padrao;
+    fclose(f);
+    return v;
+}
+
+// Nó NUMA do núcleo lógico 'cpu' (entrada nodeN em /sys/devices/system/cpu/cpuM).
+static inline int knuma_no_da_cpu(int cpu) {
+#ifdef __linux__
+    char caminho[64];
+    DIR *d;
+    struct dirent *e;
+    int no = 0;
+
+    snprintf(caminho, sizeof(caminho), "/sys/devices/system/cpu/cpu%d", cpu);
+    if ((d = opendir(caminho)) == NULL)
+        return 0;
+    while ((e = readdir(d)) != NULL) {
+        if (strncmp(e->d_name, "node", 4) == 0 && e->d_name[4] >= '0' && e->d_name[4] <= '9') {
+            no = atoi(e->d_name + 4);
+            break;
+        }
+    }
+    closedir(d);
+    return no;
+#else
+    (void)cpu;
+    return 0;
+#endif
+}
+
+static inline int knuma_cmp_compact(const void *pa, const void *pb) {
+    const knuma_cpu_t *a = (const knuma_cpu_t *)pa, *b = (const knuma_cpu_t *)pb;
+    if (a->no != b->no) return a->no - b->no;
+    if (a->smt != b->smt) return a->smt - b->smt;
+    if (a->pacote != b->pacote) return a->pacote - b->pacote;
+    if (a->nucleo != b->nucleo) return a->nucleo - b->nucleo;
+    return a->cpu - b->cpu;
+}
+
+
+// Levanta os núcleos em que o processo pode rodar (sched_getaffinity, que
+// respeita taskset/cgroups), já na ordem da política compact.
+// Retorna 0 se ok, -1 se faltar memória.
+static inline int knuma_topologia(knuma_topologia_t *topo) {
+    int c, i, j;
+
+    memset(topo, 0, sizeof(*topo));
+    topo->cpus = (knuma_cpu_t *)malloc(sizeof(knuma_cpu_t) * KNUMA_MAX_CPUS);
+    if (topo->cpus == NULL)
+        return -1;
+
+#ifdef __linux__
+    {
+        unsigned long mask[KNUMA_MASK_LONGS];
+        const int bits = 8 * sizeof(unsigned long);
+        char caminho[96];
+
+        memset(mask, 0, sizeof(mask));
+        if (syscall(SYS_sched_getaffinity, 0, sizeof(mask), mask) < 0) {
+            long n = sysconf(_SC_NPROCESSORS_ONLN);
+            for (c = 0; c < n && c < KNUMA_MAX_CPUS; c++)
+                mask[c / bits] |= 1UL << (c % bits);
+        }
+        for (c = 0; c < KNUMA_MAX_CPUS; c++) {
+            knuma_cpu_t *cpu;
+            if (!(mask[c / bits] & (1UL << (c % bits))))
+                continue;
+            cpu = &topo->cpus[topo->ncpus++];
+            cpu->cpu = c;
+            cpu->no = knuma_no_da_cpu(c);
+            snprintf(caminho, sizeof(caminho), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", c);
+            cpu->pacote = knuma_le_int(caminho, 0);
+            snprintf(caminho, sizeof(caminho), "/sys/devices/system/cpu/cpu%d/topology/core_id", c);
+            cpu->nucleo = knuma_le_int(caminho, c);
+        }
+    }
+#endif
+    if (topo->ncpus == 0) {
+        // Sem informação: um único núcleo lógico 0
+        topo->cpus[0].cpu = 0;
+        topo->cpus[0].no = topo->cpus[0].pacote = topo->cpus[0].nucleo = 0;
+        topo->ncpus = 1;
+    }
+
+    // Irmãos SMT: a ordem entre os núcleos lógicos do mesmo núcleo físico
+    for (i = 0; i < topo->ncpus; i++) {
+        topo->cpus[i].smt = 0;
+        for (j = 0; j < i; j++) {
+            if (topo->cpus[j].pacote == topo->cpus[i].pacote && topo->cpus[j].nucleo == topo->cpus[i].nucleo)
+                topo->cpus[i].smt++;
+        }
+    }
+    qsort(topo->cpus, topo->ncpus, sizeof(knuma_cpu_t), knuma_cmp_compact);
+    for (i = 0; i < topo->ncpus; i++) {
+        if (i == 0 || topo->cpus[i].no != topo->cpus[i - 1].no)
+            topo->nnos++;
+    }
+    return 0;
+}
+
+static inline void knuma_topologia_free(knuma_topologia_t *topo) {
+    free(topo->cpus);
+}
+
+
+// Núcleo lógico de cada uma das 'n' threads ('cpu', n entradas) segundo a
+// política. Com mais threads do que núcleos, a distribuição recomeça.
+static inline void knuma_plano(const knuma_topologia_t *topo, int politica, int n, int *cpu) {
+    int t, i;
+
+    if (politica == PIN_SCATTER && topo->nnos > 1) {
+        // Os núcleos estão agrupados por nó: a thread t vai para o nó t % nnos,
+        // pegando o próximo núcleo ainda não usado desse nó.
+        int *inicio = (int *)calloc(topo->nnos + 1, sizeof(int));
+        int *usados = (int *)calloc(topo->nnos, sizeof(int));
+        int no = 0;
+        if (inicio != NULL && usados != NULL) {
+            for (i = 0; i < topo->ncpus; i++) {
+                if (i > 0 && topo->cpus[i].no != topo->cpus[i - 1].no)
+                    inicio[++no] = i;
+            }
+            inicio[topo->nnos] = topo->ncpus;
+            for (t = 0; t < n; t++) {
+                int g = t % topo->nnos;
+                int tam = inicio[g + 1] - inicio[g];
+                cpu[t] = topo->cpus[inicio[g] + usados[g]++ % tam].cpu;
+            }
+            free(inicio);
+            free(usados);
+            return;
+        }
+        free(inicio);
+        free(usados);
+    }
+    for (t = 0; t < n; t++)
+        cpu[t] = topo->cpus[t % topo->ncpus].cpu;
+}
+
+
+// Fixa a thread que chama no núcleo lógico 'cpu'. Retorna 0 se ok, -1 se não
+// foi possível (a thread continua rodando sem fixação).
+static inline int knuma_fixa(int cpu) {
+#ifdef __linux__
+    unsigned long mask[KNUMA_MASK_LONGS];
+    const int bits = 8 * sizeof(unsigned long);
+
+    if (cpu < 0 || cpu >= KNUMA_MAX_CPUS)
+        return -1;
+    memset(mask, 0, sizeof(mask));
+    mask[cpu / bits] = 1UL << (cpu % bits);
+    return (syscall(SYS_sched_setaffinity, 0, sizeof(mask), mask) == 0) ? 0 : -1;
+#else
+    (void)cpu;
+    return -1;
+#endif
+}
+
+
+// Nó NUMA em que está a maior parte das páginas de [p, p + bytes), consultando
+// no máximo KNUMA_MAX_AMOSTRAS páginas espaçadas. Retorna -1 se o kernel não
+// informar (sem NUMA, fora do Linux ou faixa vazia).
+static inline int knuma_no_da_faixa(const void *p, size_t bytes) {
+#if defined(__linux__) && defined(SYS_move_pages)
+    void *paginas[KNUMA_MAX_AMOSTRAS];
+    int status[KNUMA_MAX_AMOSTRAS];
+    int votos[64];
+    long tam_pagina = sysconf(_SC_PAGESIZE);
+    uintptr_t ini = (uintptr_t)p & ~(uintptr_t)(tam_pagina - 1);
+    uintptr_t fim = (uintptr_t)p + bytes;
+    size_t npag, passo, i;
+    int m = 0, melhor = -1;
+
+    if (p == NULL || bytes == 0)
+        return -1;
+    npag = (fim - ini + tam_pagina - 1) / tam_pagina;
+    passo = (npag + KNUMA_MAX_AMOSTRAS - 1) / KNUMA_MAX_AMOSTRAS;
+    for (i = 0; i < npag && m < KNUMA_MAX_AMOSTRAS; i += passo)
+        paginas[m++] = (void *)(ini + i * tam_pagina);
+    if (syscall(SYS_move_pages, 0, (unsigned long)m, paginas, NULL, status, 0) != 0)
+        return -1;
+    memset(votos, 0, sizeof(votos));
+    for (i = 0; i < (size_t)m; i++) {
+        if (status[i] >= 0 && status[i] < 64)
+            votos[status[i]]++;
+    }
+    for (i = 0; i < 64; i++) {
+        if (votos[i] > 0 && (melhor < 0 || votos[i] > votos[melhor]))
+            melhor = (int)i;
+    }
+    return melhor;
+#else
+    (void)p;
+    (void)bytes;
+    return -1;
+#endif
+}
+
+// Nó como texto para o relatório ("?" se desconhecido).
+static inline const char *knuma_no_str(int no, char *buf, size_t tam) {
+    if (no < 0)
+        return "?";
+    snprintf(buf, tam, "%d", no);
+    return buf;
+}
+
+#endif
@@ -0,0 +1,186 @@
+#ifndef KMEANS_PROF_H
+#define KMEANS_PROF_H
+
+// Medição de tempo de parede (opção -W <arquivo>), compartilhada pela versão
+// sequencial e pela concorrente. clock() soma o tempo de CPU de todas as
+// threads e não serve para medir aceleração; aqui tudo usa CLOCK_MONOTONIC.
+//
+// Cada thread acumula, em uma linha por iteração, o tempo gasto em cada fase
+// (KPROF_*). A linha 0 é o trecho antes do laço principal (conversão da
+// entrada e centróides iniciais). As esperas nas barreiras contam como
+// KPROF_BARREIRA, separadas da fase que as precede. Cada thread escreve só as
+// suas linhas (crescidas por ela mesma com realloc) e o relatório é gravado
+// depois do join, em JSON ou, se o nome terminar em .csv, em CSV.
+//
+// Desligada, a medição é um ponteiro NULL: cada chamada custa um teste.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#define KPROF_LEITURA       0   // Conversão da entrada (Etapa 0)
+#define KPROF_INICIALIZACAO 1   // Centróides iniciais (-k) e estado dos limites
+#define KPROF_ATRIBUICAO    2   // Atribuição + soma local (fundidas)
+#define KPROF_CONTABILIDADE 3   // Soma dos flips das threads
+#define KPROF_REDUCAO       4   // Redução global e novas médias (e deslocamentos)
+#define KPROF_CHECAGEM      5   // Critérios de parada, resumos e troca dos buffers
+#define KPROF_BARREIRA      6   // Espera nas barreiras
+#define KPROF_FASES         7
+
+#define KPROF_LINHA_CACHE   64
+#define KPROF_LINHAS_INI    64  // Linhas alocadas no início (crescem em dobro)
+
+// Estado de uma thread, em linhas de cache só suas
+typedef struct kprof_thread_t {
+    _Alignas(KPROF_LINHA_CACHE) double marca;   // Fim do último trecho medido
+    double *tempos;       // (linha + 1) * KPROF_FASES segundos
+    int linha, capacidade;
+    int cheio;            // realloc falhou: o resto ficou acumulado na última linha
+} kprof_thread_t;
+
+typedef struct kprof_t {
+    int num_threads;
+    kprof_thread_t *threads;
+    void *raw;
+    double inicio;                   // Instante de referência (kprof_init)
+    double setup, escrita, total;    // Trechos da thread principal
+} kprof_t;
+
+
+static inline const char *kprof_nome(int fase) {
+    static const char *nomes[] = { "leitura", "inicializacao", "atribuicao", "contabilidade",
+                                   "reducao", "checagem", "barreira" };
+    return (fase >= 0 && fase < KPROF_FASES) ? nomes[fase] : "?";
+}
+
+// Relógio monotônico em segundos.
+static inline double kprof_agora(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+// Aloca o estado para 'num_threads' threads. Retorna 0 se ok, -1 se faltar memória.
+static inline int kprof_init(kprof_t *p, int num_threads) {
+    int t;
+
+    memset(p, 0, sizeof(*p));
+    p->num_threads = num_threads;
+    p->raw = calloc(1, sizeof(kprof_thread_t) * num_threads + KPROF_LINHA_CACHE);
+    if (p->raw == NULL)
+        return -1;
+    p->threads = (kprof_thread_t *)(((uintptr_t)p->raw + KPROF_LINHA_CACHE - 1) & ~(uintptr_t)(KPROF_LINHA_CACHE - 1));
+    p->inicio = kprof_agora();
+    for (t = 0; t < num_threads; t++) {
+        p->threads[t].capacidade = KPROF_LINHAS_INI;
+        p->threads[t].tempos = (double *)calloc((size_t)KPROF_LINHAS_INI * KPROF_FASES, sizeof(double));
+        p->threads[t].marca = p->inicio;
+        if (p->threads[t].tempos == NULL)
+            return -1;
+    }
+    return 0;
+}
+
+static inline void kprof_free(kprof_t *p) {
+    int t;
+    for (t = 0; t < p->num_threads; t++)
+        free(p->threads[t].tempos);
+    free(p->raw);
+}
+
+
+// Começa a medir a partir de agora (descarta o tempo desde a última marca).
+static inline void kprof_marca(kprof_t *p, int id) {
+    if (p == NULL)
+        return;
+    p->threads[id].marca = kprof_agora();
+}
+
+// Soma o tempo desde a última marca na fase 'fase' da linha atual.
+static inline void kprof_fase(kprof_t *p, int id, int fase) {
+    kprof_thread_t *pt;
+    double agora;
+
+    if (p == NULL)
+        return;
+    pt = &p->threads[id];
+    agora = kprof_agora();
+    pt->tempos[(size_t)pt->linha * KPROF_FASES + fase] += agora - pt->marca;
+    pt->marca = agora;
+}
+
+// Passa para a linha da próxima iteração.
+static inline void kprof_iteracao(kprof_t *p, int id) {
+    kprof_thread_t *pt;
+
+    if (p == NULL)
+        return;
+    pt = &p->threads[id];
+    if (pt->linha + 1 == pt->capacidade) {
+        double *novo = (double *)realloc(pt->tempos, sizeof(double) * KPROF_FASES * pt->capacidade * 2);
+        if (novo == NULL) {
+            pt->cheio = 1;
+            return;
+        }
+        pt->tempos = novo;
+        memset(novo + (size_t)pt->capacidade * KPROF_FASES, 0, sizeof(double) * KPROF_FASES * pt->capacidade);
+        pt->capacidade *= 2;
+    }
+    pt->linha++;
+}
+
+
+// Grava o relatório em 'caminho': JSON ou, se o nome terminar em .csv, CSV
+// no formato longo (thread,iteracao,fase,segundos; thread -1 é a principal).
+// Retorna 0 se ok, -1 se não conseguir escrever.
+static inline int kprof_escreve(const kprof_t *p, const char *caminho, const char *programa) {
+    size_t len = strlen(caminho);
+    int csv = (len >= 4 && strcmp(caminho + len - 4, ".csv") == 0);
+    FILE *f = fopen(caminho, "w");
+    int t, l, fase;
+
+    if (f == NULL) {
+        fprintf(stderr, "Erro: nao foi possivel criar '%s'.\n", caminho);
+        return -1;
+    }
+    if (csv) {
+        fprintf(f, "thread,iteracao,fase,segundos\n");
+        fprintf(f, "-1,0,setup,%.9f\n-1,0,escrita,%.9f\n-1,0,total,%.9f\n", p->setup, p->escrita, p->total);
+        for (t = 0; t < p->num_threads; t++) {
+            const kprof_thread_t *pt = &p->threads[t];
+            for (l = 0; l <= pt->linha; l++) {
+                for (fase = 0; fase < KPROF_FASES; fase++)
+                    fprintf(f, "%d,%d,%s,%.9f\n", t, l, kprof_nome(fase), pt->tempos[(size_t)l * KPROF_FASES + fase]);
+            }
+        }
+    } else {
+        fprintf(f, "{\n  \"programa\": \"%s\",\n  \"threads\": %d,\n", programa, p->num_threads);
+        fprintf(f, "  \"setup_s\": %.9f,\n  \"escrita_s\": %.9f,\n  \"total_s\": %.9f,\n", p->setup, p->escrita, p->total);
+        fprintf(f, "  \"fases\": [");
+        for (fase = 0; fase < KPROF_FASES; fase++)
+            fprintf(f, "%s\"%s\"", fase > 0 ? ", " : "", kprof_nome(fase));
+        fprintf(f, "],\n  \"por_thread\": [\n");
+        for (t = 0; t < p->num_threads; t++) {
+            const kprof_thread_t *pt = &p->threads[t];
+            fprintf(f, "    {\"thread\": %d, \"truncado\": %s, \"iteracoes\": [\n", t, pt->cheio ? "true" : "false");
+            for (l = 0; l <= pt->linha; l++) {
+                fprintf(f, "      [");
+                for (fase = 0; fase < KPROF_FASES; fase++)
+                    fprintf(f, "%s%.9f", fase > 0 ? ", " : "", pt->tempos[(size_t)l * KPROF_FASES + fase]);
+                fprintf(f, "]%s\n", l < pt->linha ? "," : "");
+            }
+            fprintf(f, "    ]}%s\n", t + 1 < p->num_threads ? "," : "");
+        }
+        fprintf(f, "  ]\n}\n");
+    }
+    if (fclose(f) != 0) {
+        fprintf(stderr, "Erro: falha ao gravar '%s'.\n", caminho);
+        return -1;
+    }
+    return 0;
+}
+
+#endif
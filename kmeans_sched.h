@@ -0,0 +1,195 @@
+#ifndef KMEANS_SCHED_H
+#define KMEANS_SCHED_H
+
+// Escalonamento dos pontos entre as threads do K-Means, escolhido em tempo de
+// execução (opção -e da versão concorrente):
+//
+//   SCHED_STATIC  cada thread atribui a sua fatia fixa start_n..end_n (o original).
+//   SCHED_STEAL   a fatia de cada thread é dividida em blocos de cerca de
+//                 KSCHED_BLOCO_BYTES (do tamanho da L1) e vira uma fila dupla:
+//                 a dona tira blocos do início e, quando a sua acaba, rouba
+//                 blocos do fim das filas das outras threads.
+//
+// Um bloco roubado é só atribuído pela ladra (cluster, limites e flips); quem
+// soma os seus pontos é a dona. Como a dona tira blocos do início e as ladras
+// do fim, os blocos que a dona atribuiu formam um prefixo da fatia e os
+// roubados o sufixo: a dona soma o prefixo junto com a atribuição e o sufixo
+// depois, na ordem dos pontos, esperando cada bloco roubado ficar pronto. As
+// somas por thread são as mesmas do SCHED_STATIC, bit a bit.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "kmeans_barrier.h"
+
+#define SCHED_STATIC 0
+#define SCHED_STEAL  1
+
+#define KSCHED_BLOCO_BYTES  (32 * 1024)  // Coordenadas por bloco
+#define KSCHED_BLOCO_MIN    64           // Pontos por bloco, no mínimo
+
+// Fila de blocos de uma thread, em linhas de cache só suas. Os blocos nunca
+// são inseridos, só retirados, então a fila é a faixa [inicio, fim) de índices
+// de bloco; as duas pontas ficam em uma única palavra de 64 bits, trocada com
+// compare-and-swap tanto pela dona quanto pelas ladras.
+typedef struct ksched_fila_t {
+    _Alignas(BARRIER_CACHE_LINE) _Atomic uint64_t faixa;   // (inicio << 32) | fim
+    int ini, fim;             // Pontos da fatia da dona
+    int bloco;                // Pontos por bloco
+    int nblocos;
+    int corte;                // Primeiro bloco roubado, gravado pela dona ao esvaziar a fila
+    atomic_int *feito;        // Iteração em que cada bloco roubado foi atribuído (nblocos)
+} ksched_fila_t;
+
+typedef struct ksched_t {
+    int tipo;
+    int n;                    // Número de threads
+    ksched_fila_t *filas;     // n entradas alinhadas a linha de cache
+    void *filas_raw;
+} ksched_t;
+
+
+// Converte o nome passado na linha de comando (-e) para SCHED_*; -1 se inválido.
+static inline int ksched_parse_tipo(const char *nome) {
+    if (strcmp(nome, "static") == 0) return SCHED_STATIC;
+    if (strcmp(nome, "steal") == 0) return SCHED_STEAL;
+    return -1;
+}
+
+static inline const char *ksched_nome(int tipo) {
+    static const char *nomes[] = { "static", "steal" };
+    return (tipo >= 0 && tipo <= SCHED_STEAL) ? nomes[tipo] : "?";
+}
+
+// Pontos por bloco para pontos de 'dim' coordenadas de 'elem_size' bytes.
+static inline int ksched_bloco_pontos(int dim, int elem_size) {
+    int bloco = KSCHED_BLOCO_BYTES / (dim * elem_size);
+    return (bloco < KSCHED_BLOCO_MIN) ? KSCHED_BLOCO_MIN : bloco;
+}
+
+
+// Inicializa o escalonador para 'n' threads; as fatias são passadas depois,
+// com ksched_fila_init. Retorna 0 se ok, -1 se faltar memória.
+static inline int ksched_init(ksched_t *s, int tipo, int n) {
+    memset(s, 0, sizeof(*s));
+    s->tipo = tipo;
+    s->n = n;
+    s->filas_raw = calloc(1, sizeof(ksched_fila_t) * n + BARRIER_CACHE_LINE);
+    if (s->filas_raw == NULL)
+        return -1;
+    s->filas = (ksched_fila_t *)(((uintptr_t)s->filas_raw + BARRIER_CACHE_LINE - 1) & ~(uintptr_t)(BARRIER_CACHE_LINE - 1));
+    return 0;
+}
+
+// Fila da thread 'id' com a fatia de pontos [ini, fim), já cheia para a
+// primeira iteração. Retorna 0 se ok, -1 se faltar memória.
+static inline int ksched_fila_init(ksched_t *s, int id, int ini, int fim, int bloco) {
+    ksched_fila_t *f = &s->filas[id];
+    int b;
+
+    f->ini = ini;
+    f->fim = fim;
+    f->bloco = bloco;
+    f->nblocos = (fim - ini + bloco - 1) / bloco;
+    f->corte = f->nblocos;
+    f->feito = (atomic_int *)malloc(sizeof(atomic_int) * (f->nblocos > 0 ? f->nblocos : 1));
+    if (f->feito == NULL)
+        return -1;
+    for (b = 0; b < f->nblocos; b++)
+        atomic_init(&f->feito[b], 0);
+    atomic_init(&f->faixa, (uint64_t)f->nblocos);
+    return 0;
+}
+
+static inline void ksched_destroy(ksched_t *s) {
+    int i;
+    if (s->filas != NULL) {
+        for (i = 0; i < s->n; i++)
+            free(s->filas[i].feito);
+    }
+    free(s->filas_raw);
+}
+
+
+// Devolve todos os blocos à fila da thread 'id'. Chamar entre a última
+// retirada de uma iteração (depois da barreira) e a primeira da próxima.
+static inline void ksched_recarrega(ksched_t *s, int id) {
+    ksched_fila_t *f = &s->filas[id];
+    f->corte = f->nblocos;
+    atomic_store_explicit(&f->faixa, (uint64_t)f->nblocos, memory_order_relaxed);
+}
+
+// Pontos [*ini, *fim) do bloco 'b' da fila 'f'.
+static inline void ksched_bloco_faixa(const ksched_fila_t *f, int b, int *ini, int *fim) {
+    *ini = f->ini + b * f->bloco;
+    *fim = (f->fim - *ini > f->bloco) ? *ini + f->bloco : f->fim;
+}
+
+// A dona tira o próximo bloco do início da sua fila. Retorna o índice do
+// bloco (e a sua faixa de pontos) ou -1 se a fila esvaziou; nesse caso
+// f->corte passa a ser o primeiro bloco levado pelas ladras.
+static inline int ksched_proximo(ksched_t *s, int id, int *ini, int *fim) {
+    ksched_fila_t *f = &s->filas[id];
+    uint64_t v = atomic_load_explicit(&f->faixa, memory_order_relaxed);
+
+    while (1) {
+        uint32_t inicio = (uint32_t)(v >> 32), fim_fila = (uint32_t)v;
+        if (inicio >= fim_fila) {
+            f->corte = (int)fim_fila;
+            return -1;
+        }
+        if (atomic_compare_exchange_weak_explicit(&f->faixa, &v, ((uint64_t)(inicio + 1) << 32) | fim_fila,
+                                                  memory_order_acquire, memory_order_relaxed)) {
+            ksched_bloco_faixa(f, (int)inicio, ini, fim);
+            return (int)inicio;
+        }
+    }
+}
+
+// Rouba um bloco do fim da fila de outra thread, começando pela vizinha de
+// 'id'. Retorna o índice do bloco, com a dona em *vitima e a faixa de pontos
+// em [*ini, *fim), ou -1 se todas as filas estão vazias (elas só esvaziam).
+static inline int ksched_rouba(ksched_t *s, int id, int *vitima, int *ini, int *fim) {
+    int d;
+
+    for (d = 1; d < s->n; d++) {
+        int v_id = (id + d) % s->n;
+        ksched_fila_t *f = &s->filas[v_id];
+        uint64_t v = atomic_load_explicit(&f->faixa, memory_order_relaxed);
+
+        while (1) {
+            uint32_t inicio = (uint32_t)(v >> 32), fim_fila = (uint32_t)v;
+            if (inicio >= fim_fila)
+                break;
+            if (atomic_compare_exchange_weak_explicit(&f->faixa, &v, ((uint64_t)inicio << 32) | (fim_fila - 1),
+                                                      memory_order_acquire, memory_order_relaxed)) {
+                *vitima = v_id;
+                ksched_bloco_faixa(f, (int)fim_fila - 1, ini, fim);
+                return (int)fim_fila - 1;
+            }
+        }
+    }
+    return -1;
+}
+
+// A ladra publica que terminou de atribuir o bloco 'b' da fila 'vitima'.
+static inline void ksched_marca_feito(ksched_t *s, int vitima, int b, int iteracao) {
+    atomic_store_explicit(&s->filas[vitima].feito[b], iteracao, memory_order_release);
+}
+
+// A dona espera a ladra terminar o bloco 'b' da sua fila (na iteração dada).
+static inline void ksched_espera_feito(ksched_t *s, int id, int b, int iteracao) {
+    atomic_int *feito = &s->filas[id].feito[b];
+    int voltas = 0;
+
+    while (atomic_load_explicit(feito, memory_order_acquire) != iteracao) {
+        if (++voltas < BARRIER_SPIN_LIMIT)
+            kbarrier_pause();
+        else
+            sched_yield();
+    }
+}
+
+#endif
@@ -2,90 +2,282 @@
 #include <stdlib.h>
 #include <math.h>
 #include <time.h> 
+#include <unistd.h>
+#include "kmeans_io.h"
+#include "kmeans_accel.h"
+#include "kmeans_simd.h"
+#include "kmeans_init.h"
+#include "kmeans_stop.h"
+#include "kmeans_prof.h"
 
 //Como esse é o cpodigo inicial a única coisa que foi mudada aqui foi a inserção de time.h e a medição do tempo de execução
 
 
-#define DIM 3
-int main(void) {
-    int i, j, k, n, c;
-    double dmin, dx;
+int main(int argc, char *argv[]) {
+    int i, j, k, n, dim;
     double *x, *mean, *sum;
-    int *cluster, *count, color;
-    int flips;
+    int *cluster, *count;
+    int flips, iteracao;
+    kstop_t parada = {0};
+    dataset_t ds;
+    const char *entrada = NULL;
+    int opt;
+    int algoritmo = ALG_LLOYD;
+    hamerly_t ham = {0};
+    yinyang_t yy = {0};
+    yinyang_local_t yy_local = {0};
+    int grupos = 0;
+    double *mean_old = NULL;
+    kmeans_centros_t centros = {0};
+    int kernel = KERNEL_AUTO;
+    int precisao = PRECISAO_DOUBLE;
+    const char *formato = "%5.2f ";
+    int metodo_init = INIT_INPUT;
+    unsigned long long semente = 1;
+    kinit_t init = {0};
+    const char *arquivo_rotulos = NULL, *arquivo_inercias = NULL;
+    kmeans_quad_t quad = {0}, *quad_local = NULL;   // Soma de |x - centróide|^2 por cluster (só com -l/-Q)
+    int todos_digitos = 0;
 
     //  Variáveis de Tomada de Tempo 
     clock_t inicio, fim;
     double tempo_total; 
+    double inicio_parede, t_escrita;
+    const char *relatorio = NULL;
+    kprof_t prof, *medicao = NULL;   // Medição por fase (-W); NULL desligada
+
+    //  Opções: -i <arquivo> lê o dataset (binário ou texto, ver kmeans_io.h) em vez do stdin
+    //          -a <lloyd|hamerly|yinyang> escolhe o modo da etapa de atribuição (ver kmeans_accel.h)
+    //          -g <grupos> número de grupos de centróides do Yinyang (padrão K/10)
+    //          -s <auto|scalar|avx2|avx512> kernel de distâncias do modo Lloyd (ver kmeans_simd.h)
+    //          -p <double|float> tipo dos pontos no modo Lloyd (float: metade da memória)
+    //          -P imprime os centróides com todos os dígitos (para comparar precisões)
+    //          -k <input|kmeanspp|kmeanspar> centróides iniciais: chutes da entrada ou sorteio (ver kmeans_init.h)
+    //          -S <semente> semente do sorteio de -k (padrão 1)
+    //          -I <n>, -f <eps>, -t <eps> critérios de parada extras (ver kmeans_stop.h)
+    //          -W <arquivo> grava o tempo de parede de cada fase por iteração, em JSON ou .csv (ver kmeans_prof.h)
+    //          -l <arquivo> grava o rótulo final de cada ponto, em binário compacto ou .txt (ver kmeans_io.h)
+    //          -Q <arquivo> grava o CSV com os pontos e a inércia de cada cluster
+    while ((opt = getopt(argc, argv, "i:a:g:s:p:Pk:S:I:f:t:W:l:Q:")) != -1) {
+        if (opt == 'i') {
+            entrada = optarg;
+        } else if (opt == 'a' && (algoritmo = kmeans_parse_algoritmo(optarg)) >= 0) {
+            continue;
+        } else if (opt == 'g' && (grupos = atoi(optarg)) > 0) {
+            continue;
+        } else if (opt == 's' && (kernel = kmeans_parse_kernel(optarg)) >= KERNEL_AUTO) {
+            continue;
+        } else if (opt == 'p' && (precisao = kmeans_parse_precisao(optarg)) >= 0) {
+            continue;
+        } else if (opt == 'P') {
+            formato = "%.17g ";
+            todos_digitos = 1;
+        } else if (opt == 'k' && (metodo_init = kinit_parse_metodo(optarg)) >= 0) {
+            continue;
+        } else if (opt == 'S') {
+            semente = strtoull(optarg, NULL, 10);
+        } else if (opt == 'I' && (parada.max_iter = atoi(optarg)) > 0) {
+            continue;
+        } else if (opt == 'f' && (parada.eps_flips = atof(optarg)) > 0.0) {
+            continue;
+        } else if (opt == 't' && (parada.eps_desloc = atof(optarg)) > 0.0) {
+            continue;
+        } else if (opt == 'W') {
+            relatorio = optarg;
+        } else if (opt == 'l') {
+            arquivo_rotulos = optarg;
+        } else if (opt == 'Q') {
+            arquivo_inercias = optarg;
+        } else {
+            fprintf(stderr, "Uso: cat input.txt | %s [-a lloyd|hamerly|yinyang] [-g grupos] [-s auto|scalar|avx2|avx512] [-p double|float] [-P] [-k input|kmeanspp|kmeanspar] [-S semente] [-I max_iter] [-f eps_flips] [-t eps_desloc] [-W relatorio.json|.csv] [-l rotulos.bin|.txt] [-Q inercias.csv] > output.txt\n", argv[0]);
+            fprintf(stderr, "     %s -i input.bin [-a lloyd|hamerly|yinyang] [-g grupos] [-s auto|scalar|avx2|avx512] [-p double|float] [-P] [-k input|kmeanspp|kmeanspar] [-S semente] [-I max_iter] [-f eps_flips] [-t eps_desloc] [-W relatorio.json|.csv] [-l rotulos.bin|.txt] [-Q inercias.csv] > output.txt\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if ((kernel = kmeans_kernel_select(kernel)) < 0)
+        return 1;
 
     //  Inicia o Cronômetro Principal 
     inicio = clock(); 
+    inicio_parede = kprof_agora();
+    if (relatorio != NULL) {
+        if (kprof_init(&prof, 1) != 0) {
+            fprintf(stderr, "Erro: Falha ao alocar memoria para o relatorio de tempos\n");
+            return 1;
+        }
+        medicao = &prof;
+    }
 
     //  1. FASE DE SETUP (Leitura + Alocação) 
-    scanf("%d", &k);
-    scanf("%d", &n);
+    if (dataset_open(entrada, &ds) != 0)
+        return 1;
+    if ((precisao = kmeans_dataset_precisao(&ds, precisao, algoritmo)) < 0 ||
+        dataset_parse_text(&ds) != 0) {
+        dataset_free(&ds);
+        return 1;
+    }
+    k = ds.k;
+    n = ds.n;
+    dim = ds.dim; // Número de coordenadas, lido da entrada
+    x = ds.x;
+    mean = ds.mean;
+    kprof_fase(medicao, 0, KPROF_LEITURA);
 
-    x = (double *)malloc(sizeof(double)*DIM*n);
-    mean = (double *)malloc(sizeof(double)*DIM*k);
-    sum= (double *)malloc(sizeof(double)*DIM*k);
+    sum= (double *)malloc(sizeof(double)*dim*k);
     cluster = (int *)malloc(sizeof(int)*n);
     count = (int *)malloc(sizeof(int)*k);
+    if (arquivo_rotulos != NULL || arquivo_inercias != NULL) {
+        if ((quad.soma = (double *)malloc(sizeof(double)*k)) == NULL) {
+            fprintf(stderr, "Erro: Falha ao alocar memoria para as inercias\n");
+            return 1;
+        }
+        quad.origem = mean;
+        quad_local = &quad;
+    }
 
     for (i = 0; i<n; i++) 
         cluster[i] = 0;
-    for (i = 0; i<k; i++)
-        scanf("%lf %lf %lf", mean+i*DIM, mean+i*DIM+1, mean+i*DIM+2);
-    for (i = 0; i<n; i++)
-        scanf("%lf %lf %lf", x+i*DIM, x+i*DIM+1, x+i*DIM+2);
+
+    // Centróides iniciais sorteados dos pontos (-k), no lugar dos chutes da entrada
+    if (kinit_alloc(&init, metodo_init, semente, n, k, dim, x, ds.xf, mean, 1) != 0) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para a inicializacao\n");
+        return 1;
+    }
+    kinit_run(&init, 0, 1, kinit_sem_barreira);
+    kinit_free(&init);
+
+    // 'mean_old' guarda também os centróides da última atribuição, origem das
+    // distâncias somadas para a inércia (-l/-Q)
+    if (algoritmo != ALG_LLOYD || parada.eps_desloc > 0.0 || quad_local != NULL) {
+        mean_old = (double *)malloc(sizeof(double)*dim*k);
+        if (mean_old == NULL) {
+            fprintf(stderr, "Erro: Falha ao alocar memoria para os limites\n");
+            return 1;
+        }
+    }
+    if (algoritmo == ALG_LLOYD && kmeans_centros_alloc(&centros, k, dim, kernel, precisao) != 0) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para os centroides\n");
+        return 1;
+    }
+    if (algoritmo == ALG_HAMERLY) {
+        if (hamerly_alloc(&ham, n, k) != 0) {
+            fprintf(stderr, "Erro: Falha ao alocar memoria para os limites de Hamerly\n");
+            return 1;
+        }
+        hamerly_centers_range(&ham, mean, k, dim, 0, k);
+    } else if (algoritmo == ALG_YINYANG) {
+        if (yinyang_alloc(&yy, n, k, dim, grupos > 0 ? grupos : k / 10) != 0 ||
+            yinyang_local_alloc(&yy_local, &yy) != 0) {
+            fprintf(stderr, "Erro: Falha ao alocar memoria para os limites do Yinyang\n");
+            return 1;
+        }
+        yinyang_group(&yy, mean, k, dim);
+        yinyang_reset_range(&yy, 0, n);
+    }
+    kprof_fase(medicao, 0, KPROF_INICIALIZACAO);
+    if (medicao != NULL)
+        prof.setup = kprof_agora() - inicio_parede;
     
 
     //  2. FASE DE EXECUÇÃO (Algoritmo K-Means) 
-    flips = n;
-    while (flips>0) {
+    iteracao = 0;
+    while (parada.criterio == STOP_NONE) {
+        iteracao++;
+        kprof_iteracao(medicao, 0);
         flips = 0;
         for (j = 0; j < k; j++) {
             count[j] = 0; 
-            for (i = 0; i < DIM; i++) 
-                sum[j*DIM+i] = 0.0;
+            for (i = 0; i < dim; i++) 
+                sum[j*dim+i] = 0.0;
+            if (quad_local != NULL)
+                quad.soma[j] = 0.0;
         }
-        for (i = 0; i < n; i++) {
-            dmin = -1; color = cluster[i];
-            for (c = 0; c < k; c++) {
-                dx = 0.0;
-                for (j = 0; j < DIM; j++) 
-                    dx +=  (x[i*DIM+j] - mean[c*DIM+j])*(x[i*DIM+j] - mean[c*DIM+j]);
-                if (dx < dmin || dmin == -1) {
-                    color = c;
-                    dmin = dx;
-                }
-            }
-            if (cluster[i] != color) {
-                flips++;
-                cluster[i] = color;
-            }
-        }
-
-        for (i = 0; i < n; i++) {
-            count[cluster[i]]++;
-            for (j = 0; j < DIM; j++) 
-                sum[cluster[i]*DIM+j] += x[i*DIM+j];
+        // Atribuição e soma de cada ponto no seu cluster, na mesma passada
+        // (os pontos são somados na ordem i = 0..n-1, como no laço separado);
+        // com -l/-Q, também |x - centróide|^2 de cada ponto, para a inércia final
+        if (algoritmo == ALG_HAMERLY) {
+            flips = hamerly_assign_range(&ham, x, mean, cluster, k, dim, 0, n, sum, count, quad_local);
+        } else if (algoritmo == ALG_YINYANG) {
+            flips = yinyang_assign_range(&yy, &yy_local, x, mean, cluster, k, dim, 0, n, sum, count, quad_local);
+        } else {
+            kmeans_centros_load_range(&centros, mean, 0, k);
+            flips = kmeans_lloyd_assign_range(&centros, (precisao == PRECISAO_FLOAT) ? (const void *)ds.xf : (const void *)x,
+                                              cluster, 0, n, sum, count, quad_local);
         }
+        kprof_fase(medicao, 0, KPROF_ATRIBUICAO);
+        if (mean_old != NULL)
+            memcpy(mean_old, mean, sizeof(double)*dim*k);
         for (i = 0; i < k; i++) {
-            for (j = 0; j < DIM; j++) {
+            for (j = 0; j < dim; j++) {
                 if (count[i] > 0) {
-                    mean[i*DIM+j] = sum[i*DIM+j]/count[i];
+                    mean[i*dim+j] = sum[i*dim+j]/count[i];
                 }
             }
         }
+        if (algoritmo == ALG_HAMERLY) {
+            // Deslocamento dos centróides e novas distâncias entre centróides
+            hamerly_shift_range(&ham, mean_old, mean, dim, 0, k);
+            hamerly_shift_summary(&ham, k);
+            hamerly_centers_range(&ham, mean, k, dim, 0, k);
+        } else if (algoritmo == ALG_YINYANG) {
+            yinyang_shift_range(&yy, mean_old, mean, dim, 0, k);
+            yinyang_shift_summary(&yy, &yy_local);
+        }
+        kprof_fase(medicao, 0, KPROF_REDUCAO);
+
+        // Critérios de parada (flips = 0 e os de -I, -f e -t)
+        kstop_registra(&parada, kstop_avalia(&parada, iteracao, flips, n,
+                                             parada.eps_desloc > 0.0 ? kstop_desloc_range(mean_old, mean, dim, 0, k) : HUGE_VAL),
+                       iteracao);
+        kprof_fase(medicao, 0, KPROF_CHECAGEM);
     } 
+    kstop_relatorio(&parada);
 
 
     //  3. FASE DE ESCRITA (Resultados) 
+    t_escrita = kprof_agora();
     for (i = 0; i < k; i++) {
-        for (j = 0; j < DIM; j++)
-            printf("%5.2f ", mean[i*DIM+j]); // Isso vai para o output.txt
+        for (j = 0; j < dim; j++)
+            printf(formato, mean[i*dim+j]); // Isso vai para o output.txt
         printf("\n");
     }
+    fflush(stdout);
+
+    //  3.1 Rótulos (-l) e inércias (-Q). 'sum', 'count' e 'quad' são os da
+    //  última atribuição (com origem em 'mean_old') e 'mean' as médias desses
+    //  mesmos rótulos: a inércia de cada cluster sai delas, sem outra passada
+    //  pelos pontos
+    if (quad_local != NULL) {
+        double *inercia = (double *)malloc(sizeof(double)*k);
+        double total = 0.0;
+        void *buf = NULL;
+        size_t len;
+        int texto = (arquivo_rotulos != NULL && kml_eh_texto(arquivo_rotulos));
+        int tam = kml_tam_rotulo(k);
+
+        if (inercia == NULL ||
+            (arquivo_rotulos != NULL && (buf = malloc(kml_limite(n, texto, tam) + 1)) == NULL)) {
+            fprintf(stderr, "Erro: Falha ao alocar memoria para os rotulos\n");
+            return 1;
+        }
+        for (i = 0; i < k; i++) {
+            inercia[i] = kmeans_inercia_cluster(quad.soma[i], sum + (size_t)i*dim, count[i], mean + (size_t)i*dim,
+                                                mean_old + (size_t)i*dim, dim);
+            total += inercia[i];
+        }
+        fprintf(stderr, todos_digitos ? "Inercia total: %.17g\n" : "Inercia total: %.6f\n", total);
+        if (arquivo_inercias != NULL &&
+            kml_grava_inercias(arquivo_inercias, k, count, inercia, todos_digitos ? "%.17g" : "%.6f") != 0)
+            return 1;
+        if (arquivo_rotulos != NULL) {
+            len = kml_preenche(buf, cluster, 0, n, texto, tam);
+            if (kml_grava(arquivo_rotulos, k, n, texto, tam, &buf, &len, 1) != 0)
+                return 1;
+        }
+        free(buf);
+        free(inercia);
+    }
 
     //  4. CÁLCULO E IMPRESSÃO DO TEMPO 
     
@@ -95,23 +287,39 @@ int main(void) {
 
 
     fprintf(stderr, "Tempo de CPU total (Leitura + Execucao + Escrita): %f segundos\n", tempo_total);
+    fprintf(stderr, "Tempo de parede total (Leitura + Execucao + Escrita): %f segundos\n", kprof_agora() - inicio_parede);
+    if (medicao != NULL) {
+        prof.escrita = kprof_agora() - t_escrita;
+        prof.total = kprof_agora() - inicio_parede;
+        if (kprof_escreve(&prof, relatorio, "seqfinal") != 0)
+            return 1;
+        kprof_free(&prof);
+    }
 
 
     
     #ifdef DEBUG
     for (i = 0; i < n; i++) {
-        for (j = 0; j < DIM; j++)
-            printf("%5.2f ", x[i*DIM+j]);
+        for (j = 0; j < dim; j++)
+            printf("%5.2f ", x[i*dim+j]);
         printf("%d\n", cluster[i]);
     }
     #endif
     
     // Libera a memória
-    free(x);
-    free(mean);
+    dataset_free(&ds); // 'x' e 'mean'
     free(sum);
     free(cluster);
     free(count);
+    free(quad.soma);
+    if (algoritmo == ALG_HAMERLY)
+        hamerly_free(&ham);
+    if (algoritmo == ALG_YINYANG) {
+        yinyang_local_free(&yy_local);
+        yinyang_free(&yy);
+    }
+    free(mean_old);
+    kmeans_centros_free(&centros);
 
     return(0);
 }
\ No newline at end of file
@@ -0,0 +1,459 @@
+#ifndef KMEANS_SIMD_H
+#define KMEANS_SIMD_H
+
+// Kernel de distâncias da etapa de atribuição (modo Lloyd), compartilhado
+// pela versão sequencial e pela concorrente.
+//
+// Os centróides são copiados a cada iteração para um layout SoA (uma linha
+// por coordenada, soa[j*kpad + c]) com K arredondado para múltiplo de 8, e o
+// kernel compara um ponto com 4 (AVX2) ou 8 (AVX-512) centróides por
+// instrução: cada coordenada do ponto é replicada em um registrador e
+// subtraída de uma linha contígua de centróides. Os pontos continuam em AoS
+// (x[i*DIM+j]), o layout do arquivo mapeado; as DIM coordenadas de um ponto
+// já estão contíguas e são lidas uma vez para os K centróides.
+//
+// O kernel é escolhido em tempo de execução pela CPUID (__builtin_cpu_supports),
+// com o laço escalar como reserva, e cada um é instanciado para as dimensões
+// de KMEANS_DIM_DISPATCH (ver kmeans_accel.h). Em todos os kernels a
+// distância de cada par é ((0 + d0*d0) + d1*d1) + ..., sem FMA, e o empate é
+// resolvido pelo menor índice, como no laço original: o centróide escolhido
+// é o mesmo.
+//
+// No modo float (-p float) os pontos e a cópia SoA são float32: cada
+// instrução compara 8 (AVX2) ou 16 (AVX-512) centróides e o laço lê metade
+// dos bytes. As somas locais continuam em double (kmeans_accumulate_f), então
+// só a escolha do centróide usa distâncias em float; 'mean' segue em double.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "kmeans_io.h"
+#include "kmeans_accel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KMEANS_SIMD_X86
+#include <immintrin.h>
+#endif
+
+#define KERNEL_AUTO   -1
+#define KERNEL_SCALAR  0
+#define KERNEL_AVX2    1
+#define KERNEL_AVX512  2
+
+#define PRECISAO_DOUBLE 0
+#define PRECISAO_FLOAT  1
+
+#define KMEANS_SIMD_LARGURA 16     // Maior número de centróides por instrução (AVX-512, float)
+#define KMEANS_SIMD_ALINHAMENTO 64
+
+typedef struct kmeans_centros_t {
+    int k, dim;
+    int kpad;           // K arredondado para múltiplo de KMEANS_SIMD_LARGURA
+    int kernel;         // KERNEL_* já resolvido (nunca KERNEL_AUTO)
+    int precisao;       // PRECISAO_*: tipo dos pontos e da cópia SoA
+    double *soa;        // soa[j*kpad + c]; as colunas c >= k valem HUGE_VAL
+    float *soa_f;       // O mesmo em float32 (PRECISAO_FLOAT; então soa == NULL)
+    void *raw;
+} kmeans_centros_t;
+
+
+// Converte o nome passado na linha de comando (-p) para PRECISAO_*; -1 se inválido.
+static inline int kmeans_parse_precisao(const char *nome) {
+    if (strcmp(nome, "double") == 0) return PRECISAO_DOUBLE;
+    if (strcmp(nome, "float") == 0) return PRECISAO_FLOAT;
+    return -1;
+}
+
+// Prepara os pontos do dataset (antes da conversão do texto) para a precisão
+// pedida. Um arquivo binário float força o modo float. O modo float só existe
+// no modo Lloyd. Retorna a precisão efetiva ou -1 (mensagem já impressa).
+static inline int kmeans_dataset_precisao(dataset_t *ds, int precisao, int algoritmo) {
+    if (ds->xf != NULL)
+        precisao = PRECISAO_FLOAT;
+    if (precisao != PRECISAO_FLOAT)
+        return PRECISAO_DOUBLE;
+    if (algoritmo != ALG_LLOYD) {
+        fprintf(stderr, "Erro: pontos em float so sao suportados com -a lloyd.\n");
+        return -1;
+    }
+    return dataset_use_float(ds) == 0 ? PRECISAO_FLOAT : -1;
+}
+
+
+// Converte o nome passado na linha de comando (-s) para KERNEL_*; -2 se inválido.
+static inline int kmeans_parse_kernel(const char *nome) {
+    if (strcmp(nome, "auto") == 0) return KERNEL_AUTO;
+    if (strcmp(nome, "scalar") == 0) return KERNEL_SCALAR;
+    if (strcmp(nome, "avx2") == 0) return KERNEL_AVX2;
+    if (strcmp(nome, "avx512") == 0) return KERNEL_AVX512;
+    return -2;
+}
+
+static inline const char *kmeans_kernel_nome(int kernel) {
+    static const char *nomes[] = { "scalar", "avx2", "avx512" };
+    return (kernel >= KERNEL_SCALAR && kernel <= KERNEL_AVX512) ? nomes[kernel] : "?";
+}
+
+// 1 se a CPU (e o sistema) suportam o kernel.
+static inline int kmeans_kernel_suportado(int kernel) {
+#ifdef KMEANS_SIMD_X86
+    __builtin_cpu_init();
+    if (kernel == KERNEL_AVX2)
+        return __builtin_cpu_supports("avx2");
+    if (kernel == KERNEL_AVX512)
+        return __builtin_cpu_supports("avx512f");
+#endif
+    return kernel == KERNEL_SCALAR;
+}
+
+// Resolve KERNEL_AUTO para o melhor kernel suportado. Retorna -1 (com a
+// mensagem já impressa) se o kernel pedido não for suportado.
+static inline int kmeans_kernel_select(int pedido) {
+    if (pedido == KERNEL_AUTO) {
+        if (kmeans_kernel_suportado(KERNEL_AVX512)) return KERNEL_AVX512;
+        if (kmeans_kernel_suportado(KERNEL_AVX2)) return KERNEL_AVX2;
+        return KERNEL_SCALAR;
+    }
+    if (!kmeans_kernel_suportado(pedido)) {
+        fprintf(stderr, "Erro: kernel %s nao suportado por esta CPU.\n", kmeans_kernel_nome(pedido));
+        return -1;
+    }
+    return pedido;
+}
+
+
+// Aloca a cópia SoA dos K centróides. Retorna 0 se ok, -1 se faltar memória.
+static inline int kmeans_centros_alloc(kmeans_centros_t *cs, int k, int dim, int kernel, int precisao) {
+    size_t i, total, elem = (precisao == PRECISAO_FLOAT) ? sizeof(float) : sizeof(double);
+    void *alinhado;
+
+    cs->k = k;
+    cs->dim = dim;
+    cs->kpad = (k + KMEANS_SIMD_LARGURA - 1) / KMEANS_SIMD_LARGURA * KMEANS_SIMD_LARGURA;
+    cs->kernel = kernel;
+    cs->precisao = precisao;
+    total = (size_t)cs->kpad * dim;
+    cs->raw = malloc(elem * (total > 0 ? total : 1) + KMEANS_SIMD_ALINHAMENTO);
+    if (cs->raw == NULL)
+        return -1;
+    alinhado = (void *)(((uintptr_t)cs->raw + KMEANS_SIMD_ALINHAMENTO - 1) & ~(uintptr_t)(KMEANS_SIMD_ALINHAMENTO - 1));
+    // Colunas de preenchimento: distância infinita, nunca escolhidas
+    if (precisao == PRECISAO_FLOAT) {
+        cs->soa = NULL;
+        cs->soa_f = (float *)alinhado;
+        for (i = 0; i < total; i++)
+            cs->soa_f[i] = HUGE_VALF;
+    } else {
+        cs->soa = (double *)alinhado;
+        cs->soa_f = NULL;
+        for (i = 0; i < total; i++)
+            cs->soa[i] = HUGE_VAL;
+    }
+    return 0;
+}
+
+static inline void kmeans_centros_free(kmeans_centros_t *cs) {
+    free(cs->raw);
+}
+
+// Copia os centróides [c_ini, c_fim) de 'mean' (AoS) para o layout SoA.
+static inline void kmeans_centros_load_range(kmeans_centros_t *cs, const double *mean, int c_ini, int c_fim) {
+    int c, j;
+    for (j = 0; j < cs->dim; j++) {
+        for (c = c_ini; c < c_fim; c++) {
+            if (cs->precisao == PRECISAO_FLOAT)
+                cs->soa_f[(size_t)j * cs->kpad + c] = (float)mean[(size_t)c * cs->dim + j];
+            else
+                cs->soa[(size_t)j * cs->kpad + c] = mean[(size_t)c * cs->dim + j];
+        }
+    }
+}
+
+
+// Reserva: o laço original, lendo os centróides do layout SoA.
+static KMEANS_FORCE_INLINE int kmeans_nearest_scalar(const kmeans_centros_t *cs, const double *xi, int dim) {
+    int c, j, best = 0;
+    double dmin = -1, dx, d;
+
+    for (c = 0; c < cs->k; c++) {
+        dx = 0.0;
+        for (j = 0; j < dim; j++) {
+            d = xi[j] - cs->soa[(size_t)j * cs->kpad + c];
+            dx += d * d;
+        }
+        if (dx < dmin || dmin == -1) {
+            best = c;
+            dmin = dx;
+        }
+    }
+    return best;
+}
+
+static KMEANS_FORCE_INLINE int kmeans_nearest_scalar_f(const kmeans_centros_t *cs, const float *xi, int dim) {
+    int c, j, best = 0;
+    float dmin = -1, dx, d;
+
+    for (c = 0; c < cs->k; c++) {
+        dx = 0.0f;
+        for (j = 0; j < dim; j++) {
+            d = xi[j] - cs->soa_f[(size_t)j * cs->kpad + c];
+            dx += d * d;
+        }
+        if (dx < dmin || dmin == -1) {
+            best = c;
+            dmin = dx;
+        }
+    }
+    return best;
+}
+
+// Atribui os pontos [ini, fim) ao centróide mais próximo, somando cada ponto
+// nas somas locais (se não forem NULL). Retorna o número de flips. A
+// expansão é a mesma para todos os kernels; 'NEAREST' é a busca do kernel,
+// 'TIPO' o tipo dos pontos e 'ACUMULA' a soma local correspondente.
+#define KMEANS_LLOYD_CORPO(NEAREST, TIPO, ACUMULA)                           \
+    int i, color, flips = 0;                                                 \
+    for (i = ini; i < fim; i++) {                                            \
+        const TIPO *xi = (const TIPO *)x + (size_t)i * dim;                  \
+        color = NEAREST(cs, xi, dim);                                        \
+        if (cluster[i] != color) {                                           \
+            flips++;                                                         \
+            cluster[i] = color;                                              \
+        }                                                                    \
+        ACUMULA(sum_local, count_local, quad_local, xi, color, dim);         \
+    }                                                                        \
+    return flips;
+
+// Chamada de um kernel "_impl" com a dimensão D (ver KMEANS_DIM_DISPATCH).
+#define KMEANS_LLOYD_CHAMADA(IMPL, D) return IMPL(cs, x, cluster, ini, fim, sum_local, count_local, quad_local, D)
+
+static KMEANS_FORCE_INLINE int kmeans_lloyd_scalar_impl(const kmeans_centros_t *cs, const void *x, int *cluster,
+                                                        int ini, int fim, double *sum_local, int *count_local,
+                                                        kmeans_quad_t *quad_local, int dim) {
+    KMEANS_LLOYD_CORPO(kmeans_nearest_scalar, double, kmeans_accumulate)
+}
+
+static KMEANS_FORCE_INLINE int kmeans_lloyd_scalar_f_impl(const kmeans_centros_t *cs, const void *x, int *cluster,
+                                                          int ini, int fim, double *sum_local, int *count_local,
+                                                          kmeans_quad_t *quad_local, int dim) {
+    KMEANS_LLOYD_CORPO(kmeans_nearest_scalar_f, float, kmeans_accumulate_f)
+}
+
+static inline int kmeans_lloyd_scalar(const kmeans_centros_t *cs, const void *x, int *cluster,
+                                      int ini, int fim, double *sum_local, int *count_local,
+                                      kmeans_quad_t *quad_local) {
+#define KMEANS_CHAMADA(D) KMEANS_LLOYD_CHAMADA(kmeans_lloyd_scalar_impl, D)
+#define KMEANS_CHAMADA_F(D) KMEANS_LLOYD_CHAMADA(kmeans_lloyd_scalar_f_impl, D)
+    if (cs->precisao == PRECISAO_FLOAT) {
+        KMEANS_DIM_DISPATCH(cs->dim, KMEANS_CHAMADA_F)
+    }
+    KMEANS_DIM_DISPATCH(cs->dim, KMEANS_CHAMADA)
+#undef KMEANS_CHAMADA
+#undef KMEANS_CHAMADA_F
+}
+
+#ifdef KMEANS_SIMD_X86
+
+// Menor distância entre as 'largura' pistas; empate fica com o menor índice.
+static inline int kmeans_nearest_lanes(const double *dist, const double *idx, int largura) {
+    int l, best = 0;
+    for (l = 1; l < largura; l++) {
+        if (dist[l] < dist[best] || (dist[l] == dist[best] && idx[l] < idx[best]))
+            best = l;
+    }
+    return (int)idx[best];
+}
+
+static inline int kmeans_nearest_lanes_f(const float *dist, const float *idx, int largura) {
+    int l, best = 0;
+    for (l = 1; l < largura; l++) {
+        if (dist[l] < dist[best] || (dist[l] == dist[best] && idx[l] < idx[best]))
+            best = l;
+    }
+    return (int)idx[best];
+}
+
+// Sem "fma" no target: mul e add separados, como no laço escalar.
+__attribute__((target("avx2")))
+static KMEANS_FORCE_INLINE int kmeans_nearest_avx2(const kmeans_centros_t *cs, const double *xi, int dim) {
+    __m256d best = _mm256_set1_pd(HUGE_VAL);
+    __m256d best_idx = _mm256_setr_pd(0.0, 1.0, 2.0, 3.0);
+    __m256d idx = best_idx;
+    const __m256d passo = _mm256_set1_pd(4.0);
+    double dist[4], ind[4];
+    int c, j;
+
+    for (c = 0; c < cs->k; c += 4) {
+        __m256d acc = _mm256_setzero_pd();
+        for (j = 0; j < dim; j++) {
+            __m256d d = _mm256_sub_pd(_mm256_set1_pd(xi[j]), _mm256_load_pd(cs->soa + (size_t)j * cs->kpad + c));
+            acc = _mm256_add_pd(acc, _mm256_mul_pd(d, d));
+        }
+        // Cada pista vê os seus centróides em ordem crescente: '<' estrito
+        // mantém o primeiro mínimo, como o laço original
+        __m256d menor = _mm256_cmp_pd(acc, best, _CMP_LT_OQ);
+        best = _mm256_blendv_pd(best, acc, menor);
+        best_idx = _mm256_blendv_pd(best_idx, idx, menor);
+        idx = _mm256_add_pd(idx, passo);
+    }
+    _mm256_storeu_pd(dist, best);
+    _mm256_storeu_pd(ind, best_idx);
+    return kmeans_nearest_lanes(dist, ind, 4);
+}
+
+// Float: os índices dos centróides cabem exatamente em float até 2^24.
+__attribute__((target("avx2")))
+static KMEANS_FORCE_INLINE int kmeans_nearest_avx2_f(const kmeans_centros_t *cs, const float *xi, int dim) {
+    __m256 best = _mm256_set1_ps(HUGE_VALF);
+    __m256 best_idx = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    __m256 idx = best_idx;
+    const __m256 passo = _mm256_set1_ps(8.0f);
+    float dist[8], ind[8];
+    int c, j;
+
+    for (c = 0; c < cs->k; c += 8) {
+        __m256 acc = _mm256_setzero_ps();
+        for (j = 0; j < dim; j++) {
+            __m256 d = _mm256_sub_ps(_mm256_set1_ps(xi[j]), _mm256_load_ps(cs->soa_f + (size_t)j * cs->kpad + c));
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(d, d));
+        }
+        __m256 menor = _mm256_cmp_ps(acc, best, _CMP_LT_OQ);
+        best = _mm256_blendv_ps(best, acc, menor);
+        best_idx = _mm256_blendv_ps(best_idx, idx, menor);
+        idx = _mm256_add_ps(idx, passo);
+    }
+    _mm256_storeu_ps(dist, best);
+    _mm256_storeu_ps(ind, best_idx);
+    return kmeans_nearest_lanes_f(dist, ind, 8);
+}
+
+__attribute__((target("avx2")))
+static KMEANS_FORCE_INLINE int kmeans_lloyd_avx2_impl(const kmeans_centros_t *cs, const void *x, int *cluster,
+                                                      int ini, int fim, double *sum_local, int *count_local,
+                                                      kmeans_quad_t *quad_local, int dim) {
+    KMEANS_LLOYD_CORPO(kmeans_nearest_avx2, double, kmeans_accumulate)
+}
+
+__attribute__((target("avx2")))
+static KMEANS_FORCE_INLINE int kmeans_lloyd_avx2_f_impl(const kmeans_centros_t *cs, const void *x, int *cluster,
+                                                        int ini, int fim, double *sum_local, int *count_local,
+                                                        kmeans_quad_t *quad_local, int dim) {
+    KMEANS_LLOYD_CORPO(kmeans_nearest_avx2_f, float, kmeans_accumulate_f)
+}
+
+__attribute__((target("avx2")))
+static inline int kmeans_lloyd_avx2(const kmeans_centros_t *cs, const void *x, int *cluster,
+                                    int ini, int fim, double *sum_local, int *count_local,
+                                    kmeans_quad_t *quad_local) {
+#define KMEANS_CHAMADA(D) KMEANS_LLOYD_CHAMADA(kmeans_lloyd_avx2_impl, D)
+#define KMEANS_CHAMADA_F(D) KMEANS_LLOYD_CHAMADA(kmeans_lloyd_avx2_f_impl, D)
+    if (cs->precisao == PRECISAO_FLOAT) {
+        KMEANS_DIM_DISPATCH(cs->dim, KMEANS_CHAMADA_F)
+    }
+    KMEANS_DIM_DISPATCH(cs->dim, KMEANS_CHAMADA)
+#undef KMEANS_CHAMADA
+#undef KMEANS_CHAMADA_F
+}
+
+__attribute__((target("avx512f")))
+static KMEANS_FORCE_INLINE int kmeans_nearest_avx512(const kmeans_centros_t *cs, const double *xi, int dim) {
+    __m512d best = _mm512_set1_pd(HUGE_VAL);
+    __m512d best_idx = _mm512_setr_pd(0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0);
+    __m512d idx = best_idx;
+    const __m512d passo = _mm512_set1_pd(8.0);
+    double dist[8], ind[8];
+    int c, j;
+
+    for (c = 0; c < cs->k; c += 8) {
+        __m512d acc = _mm512_setzero_pd();
+        for (j = 0; j < dim; j++) {
+            __m512d d = _mm512_sub_pd(_mm512_set1_pd(xi[j]), _mm512_load_pd(cs->soa + (size_t)j * cs->kpad + c));
+            acc = _mm512_add_pd(acc, _mm512_mul_pd(d, d));
+        }
+        __mmask8 menor = _mm512_cmp_pd_mask(acc, best, _CMP_LT_OQ);
+        best = _mm512_mask_mov_pd(best, menor, acc);
+        best_idx = _mm512_mask_mov_pd(best_idx, menor, idx);
+        idx = _mm512_add_pd(idx, passo);
+    }
+    _mm512_storeu_pd(dist, best);
+    _mm512_storeu_pd(ind, best_idx);
+    return kmeans_nearest_lanes(dist, ind, 8);
+}
+
+__attribute__((target("avx512f")))
+static KMEANS_FORCE_INLINE int kmeans_nearest_avx512_f(const kmeans_centros_t *cs, const float *xi, int dim) {
+    __m512 best = _mm512_set1_ps(HUGE_VALF);
+    __m512 best_idx = _mm512_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f,
+                                     8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f);
+    __m512 idx = best_idx;
+    const __m512 passo = _mm512_set1_ps(16.0f);
+    float dist[16], ind[16];
+    int c, j;
+
+    for (c = 0; c < cs->k; c += 16) {
+        __m512 acc = _mm512_setzero_ps();
+        for (j = 0; j < dim; j++) {
+            __m512 d = _mm512_sub_ps(_mm512_set1_ps(xi[j]), _mm512_load_ps(cs->soa_f + (size_t)j * cs->kpad + c));
+            acc = _mm512_add_ps(acc, _mm512_mul_ps(d, d));
+        }
+        __mmask16 menor = _mm512_cmp_ps_mask(acc, best, _CMP_LT_OQ);
+        best = _mm512_mask_mov_ps(best, menor, acc);
+        best_idx = _mm512_mask_mov_ps(best_idx, menor, idx);
+        idx = _mm512_add_ps(idx, passo);
+    }
+    _mm512_storeu_ps(dist, best);
+    _mm512_storeu_ps(ind, best_idx);
+    return kmeans_nearest_lanes_f(dist, ind, 16);
+}
+
+__attribute__((target("avx512f")))
+static KMEANS_FORCE_INLINE int kmeans_lloyd_avx512_impl(const kmeans_centros_t *cs, const void *x, int *cluster,
+                                                        int ini, int fim, double *sum_local, int *count_local,
+                                                        kmeans_quad_t *quad_local, int dim) {
+    KMEANS_LLOYD_CORPO(kmeans_nearest_avx512, double, kmeans_accumulate)
+}
+
+__attribute__((target("avx512f")))
+static KMEANS_FORCE_INLINE int kmeans_lloyd_avx512_f_impl(const kmeans_centros_t *cs, const void *x, int *cluster,
+                                                          int ini, int fim, double *sum_local, int *count_local,
+                                                          kmeans_quad_t *quad_local, int dim) {
+    KMEANS_LLOYD_CORPO(kmeans_nearest_avx512_f, float, kmeans_accumulate_f)
+}
+
+__attribute__((target("avx512f")))
+static inline int kmeans_lloyd_avx512(const kmeans_centros_t *cs, const void *x, int *cluster,
+                                      int ini, int fim, double *sum_local, int *count_local,
+                                      kmeans_quad_t *quad_local) {
+#define KMEANS_CHAMADA(D) KMEANS_LLOYD_CHAMADA(kmeans_lloyd_avx512_impl, D)
+#define KMEANS_CHAMADA_F(D) KMEANS_LLOYD_CHAMADA(kmeans_lloyd_avx512_f_impl, D)
+    if (cs->precisao == PRECISAO_FLOAT) {
+        KMEANS_DIM_DISPATCH(cs->dim, KMEANS_CHAMADA_F)
+    }
+    KMEANS_DIM_DISPATCH(cs->dim, KMEANS_CHAMADA)
+#undef KMEANS_CHAMADA
+#undef KMEANS_CHAMADA_F
+}
+
+#endif
+
+
+// Etapa de atribuição do modo Lloyd para os pontos [ini, fim), com o kernel
+// escolhido em kmeans_centros_alloc. 'x' aponta para double ou float
+// conforme cs->precisao. Se 'sum_local' não for NULL, cada ponto é somado ao
+// seu cluster (etapa fundida; ver kmeans_accumulate para 'quad_local').
+// Retorna o número de flips.
+static inline int kmeans_lloyd_assign_range(const kmeans_centros_t *cs, const void *x, int *cluster,
+                                            int ini, int fim, double *sum_local, int *count_local,
+                                            kmeans_quad_t *quad_local) {
+#ifdef KMEANS_SIMD_X86
+    if (cs->kernel == KERNEL_AVX512)
+        return kmeans_lloyd_avx512(cs, x, cluster, ini, fim, sum_local, count_local, quad_local);
+    if (cs->kernel == KERNEL_AVX2)
+        return kmeans_lloyd_avx2(cs, x, cluster, ini, fim, sum_local, count_local, quad_local);
+#endif
+    return kmeans_lloyd_scalar(cs, x, cluster, ini, fim, sum_local, count_local, quad_local);
+}
+
+#endif
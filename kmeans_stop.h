@@ -0,0 +1,92 @@
+#ifndef KMEANS_STOP_H
+#define KMEANS_STOP_H
+
+// Critérios de parada do laço principal, compartilhados pela versão
+// sequencial e pela concorrente. Além do original (nenhum ponto mudou de
+// cluster), o laço pode terminar antes:
+//
+//   -I <n>    no máximo n iterações.
+//   -f <eps>  a fração de pontos que mudaram de cluster na iteração ficou
+//             abaixo de eps (a cauda de iterações que mudam poucos pontos).
+//   -t <eps>  o maior deslocamento (distância euclidiana) de um centróide
+//             na iteração ficou abaixo de eps.
+//
+// Com valor 0 o critério fica desligado. Os critérios são avaliados depois
+// da atualização das médias, então os centróides impressos são sempre os da
+// última iteração. Na versão concorrente cada thread avalia os mesmos totais
+// depois da barreira (flips e deslocamentos de todas as fatias) e todas saem
+// juntas, na mesma iteração.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define STOP_NONE      0   // Continua
+#define STOP_CONVERGED 1   // Nenhum flip (o critério original)
+#define STOP_FLIPS     2   // Fração de flips abaixo de -f
+#define STOP_SHIFT     3   // Deslocamento máximo abaixo de -t
+#define STOP_MAXITER   4   // -I iterações
+
+typedef struct kstop_t {
+    int max_iter;            // 0 = sem limite
+    double eps_flips;        // 0 = desligado
+    double eps_desloc;       // 0 = desligado
+
+    // Resultado (gravado por uma thread só)
+    int criterio;
+    int iteracao;
+} kstop_t;
+
+
+static inline const char *kstop_nome(int criterio) {
+    static const char *nomes[] = { "nenhum", "convergencia (flips = 0)", "fracao de flips",
+                                   "deslocamento dos centroides", "maximo de iteracoes" };
+    return (criterio >= 0 && criterio <= STOP_MAXITER) ? nomes[criterio] : "?";
+}
+
+
+// Deslocamento máximo dos centróides [c_ini, c_fim) de 'antes' para 'depois'.
+static inline double kstop_desloc_range(const double *antes, const double *depois, int dim, int c_ini, int c_fim) {
+    double maior = 0.0;
+    int c, j;
+
+    for (c = c_ini; c < c_fim; c++) {
+        double d2 = 0.0;
+        for (j = 0; j < dim; j++) {
+            double d = depois[c*dim+j] - antes[c*dim+j];
+            d2 += d * d;
+        }
+        if (d2 > maior)
+            maior = d2;
+    }
+    return sqrt(maior);
+}
+
+
+// Critério que encerra o laço depois da iteração 'iteracao' (contada a
+// partir de 1), com 'flips' pontos de 'n' mudando de cluster e deslocamento
+// máximo 'desloc' (HUGE_VAL se não calculado). STOP_NONE para continuar.
+static inline int kstop_avalia(const kstop_t *p, int iteracao, long long flips, long long n, double desloc) {
+    if (flips == 0)
+        return STOP_CONVERGED;
+    if (p->eps_flips > 0.0 && (double)flips < p->eps_flips * (double)n)
+        return STOP_FLIPS;
+    if (p->eps_desloc > 0.0 && desloc < p->eps_desloc)
+        return STOP_SHIFT;
+    if (p->max_iter > 0 && iteracao >= p->max_iter)
+        return STOP_MAXITER;
+    return STOP_NONE;
+}
+
+// Registra o critério que parou o laço.
+static inline void kstop_registra(kstop_t *p, int criterio, int iteracao) {
+    p->criterio = criterio;
+    p->iteracao = iteracao;
+}
+
+// Relatório no stderr: qual critério parou o laço e em que iteração.
+static inline void kstop_relatorio(const kstop_t *p) {
+    fprintf(stderr, "Parada: %s na iteracao %d\n", kstop_nome(p->criterio), p->iteracao);
+}
+
+#endif
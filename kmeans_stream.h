@@ -0,0 +1,576 @@
+#ifndef KMEANS_STREAM_H
+#define KMEANS_STREAM_H
+
+// Leitura da entrada em lotes, para datasets maiores que a memória (modos
+// mini-batch, opção -m, e Lloyd fora da memória, opção -o, da versão concorrente).
+//
+// Em vez de carregar os N pontos (kmeans_io.h), só o cabeçalho e os K
+// centróides iniciais ficam na memória; os pontos são lidos por uma thread
+// leitora em lotes de tamanho fixo, em dois buffers que se alternam: enquanto
+// as threads de cálculo processam um lote, a leitora enche o outro. A memória
+// usada é a dos 2 lotes, qualquer que seja N.
+//
+// Aceita os mesmos formatos do kmeans_io.h (texto e binário "KMB1"), do
+// arquivo de -i ou do stdin, sem mmap: a entrada é lida sequencialmente com
+// fread. Ao fim de cada passada pelos pontos a leitora entrega um lote vazio
+// e espera: kstream_recomeca volta ao primeiro ponto (só para arquivos, que
+// aceitam fseek) e kstream_fecha encerra a leitora. Depois de cada lote, a
+// leitora avisa o kernel (posix_fadvise WILLNEED) de que o trecho seguinte
+// do arquivo será lido, para que ele já esteja a caminho do page cache
+// quando um buffer for liberado.
+//
+// O cálculo pode segurar os 2 lotes ao mesmo tempo: kstream_pega entrega o
+// próximo lote e kstream_devolve libera o mais antigo ainda não devolvido.
+//
+// Os pontos dos lotes são double ou, no modo float, float32; um arquivo
+// binário float força o modo float, como em kmeans_dataset_precisao.
+//
+// kstream_open_pontos abre uma entrada só de pontos (modo de predição, -A):
+// texto sem cabeçalho, um ponto por linha, com N desconhecido (a passada vai
+// até o fim da entrada, o último lote pode ser menor), ou um binário do
+// kmeans_io.h, do qual só os N pontos são entregues.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "kmeans_io.h"
+
+#define KSTREAM_TEXTO_BUF (1 << 20)   // Buffer inicial da leitura de texto (cresce com a maior linha)
+#define KSTREAM_CONV      8192        // Coordenadas por pedaço na conversão double -> float
+
+#define KSTREAM_AGUARDA  0
+#define KSTREAM_CONTINUA 1
+#define KSTREAM_PARA     2
+
+typedef struct kstream_lote_t {
+    double *x;               // Pontos do lote (um dos dois, conforme a precisão)
+    float *xf;
+    int n;                   // Pontos no lote; 0 = fim da passada
+    long long primeiro;      // Índice, na passada, do primeiro ponto do lote
+    int cheio;               // 1 = pronto para o cálculo; 0 = livre para a leitora
+} kstream_lote_t;
+
+typedef struct kstream_t {
+    FILE *f;
+    int fechar_f;            // 1 se 'f' foi aberto aqui (-i)
+    int binario;
+    int elem_arquivo;        // Bytes por coordenada no binário (8 ou 4)
+    int k, dim;
+    long long n;             // Pontos por passada (N do cabeçalho)
+    int sem_total;           // N desconhecido: a passada termina no fim da entrada
+    double *mean;            // K centróides iniciais lidos da entrada
+    int precisao_float;      // Pontos dos lotes em float
+    double *conv;            // Rascunho da conversão de um binário double para float
+
+    // Texto: buffer com o trecho ainda não consumido da entrada
+    char *tbuf;
+    size_t tcap, tini, tfim;
+    long long dados_offset;  // Posição, no arquivo, do primeiro ponto
+    long long tbase;         // Posição, no arquivo, de tbuf[0]
+    long long pos_lote;      // Posição do arquivo depois do lote anterior (leitura antecipada)
+
+    // Lotes (buffer duplo) e a thread leitora
+    int lote;                // Pontos por lote
+    kstream_lote_t lotes[2];
+    int atual;               // Próximo lote a ser entregue ao cálculo
+    int devolver;            // Lote entregue mais antigo, o próximo a ser devolvido
+    pthread_t leitor;
+    int leitor_ativo;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int comando;             // KSTREAM_*: o que a leitora faz no fim da passada
+    int erro;                // Entrada malformada ou truncada (mensagem já impressa)
+    long long lidos;         // Pontos entregues, somando todas as passadas
+} kstream_t;
+
+
+// Completa o buffer de texto: move o trecho não consumido para o início,
+// dobra o buffer se estiver cheio e lê mais. Retorna 1 se leu algo, 0 no fim
+// da entrada e -1 se faltar memória.
+static inline int kstream_enche(kstream_t *s) {
+    size_t resto = s->tfim - s->tini, lido;
+
+    if (s->tini > 0) {
+        memmove(s->tbuf, s->tbuf + s->tini, resto);
+        s->tbase += (long long)s->tini;
+        s->tini = 0;
+        s->tfim = resto;
+    }
+    if (s->tfim == s->tcap) {
+        char *novo = (char *)realloc(s->tbuf, s->tcap * 2);
+        if (novo == NULL)
+            return -1;
+        s->tbuf = novo;
+        s->tcap *= 2;
+    }
+    lido = fread(s->tbuf + s->tfim, 1, s->tcap - s->tfim, s->f);
+    s->tfim += lido;
+    return lido > 0;
+}
+
+// Próxima linha da entrada texto, em [retorno, *fim) sem o '\n'; válida até a
+// próxima chamada. Retorna NULL no fim da entrada (ou se faltar memória, com
+// s->erro = 1).
+static inline const char *kstream_linha(kstream_t *s, const char **fim) {
+    while (1) {
+        const char *p = s->tbuf + s->tini;
+        const char *eol = (const char *)memchr(p, '\n', s->tfim - s->tini);
+        int r;
+        if (eol != NULL) {
+            s->tini = (size_t)(eol + 1 - s->tbuf);
+            *fim = eol;
+            return p;
+        }
+        r = kstream_enche(s);
+        if (r < 0) {
+            fprintf(stderr, "Erro: Falha ao alocar memoria para uma linha da entrada\n");
+            s->erro = 1;
+            return NULL;
+        }
+        if (r == 0) {
+            // Última linha, sem '\n'
+            if (s->tini == s->tfim)
+                return NULL;
+            p = s->tbuf + s->tini;
+            *fim = s->tbuf + s->tfim;
+            s->tini = s->tfim;
+            return p;
+        }
+    }
+}
+
+// Lê 'bytes' bytes da entrada binária: primeiro o que já está no buffer de
+// texto (o início lido para reconhecer o formato), depois direto do arquivo.
+static inline int kstream_le(kstream_t *s, void *dst, size_t bytes) {
+    size_t no_buf = s->tfim - s->tini;
+
+    if (no_buf > bytes)
+        no_buf = bytes;
+    memcpy(dst, s->tbuf + s->tini, no_buf);
+    s->tini += no_buf;
+    if (bytes > no_buf && fread((char *)dst + no_buf, 1, bytes - no_buf, s->f) != bytes - no_buf)
+        return -1;
+    return 0;
+}
+
+// Converte uma linha de DIM coordenadas para 'dst' (ou 'dst_f', se não for
+// NULL). Retorna 1 se ok, 0 se a linha está em branco e -1 se malformada.
+static inline int kstream_registro(const char *p, const char *eol, int dim, double *dst, float *dst_f) {
+    double v;
+    int j;
+
+    while (p < eol && text_is_space(*p)) p++;
+    if (p == eol)
+        return 0;
+    for (j = 0; j < dim; j++) {
+        while (p < eol && text_is_space(*p)) p++;
+        p = text_parse_double(p, eol, &v);
+        if (p == NULL)
+            return -1;
+        if (dst_f != NULL)
+            dst_f[j] = (float)v;
+        else
+            dst[j] = v;
+    }
+    while (p < eol && text_is_space(*p)) p++;
+    return (p == eol) ? 1 : -1;
+}
+
+// Inteiro não negativo do cabeçalho texto a partir de *p (N pode passar de 2^31).
+static inline int kstream_inteiro(const char **p, const char *fim, long long *valor) {
+    const char *q = *p;
+    long long v = 0;
+
+    while (q < fim && text_is_space(*q)) q++;
+    if (q >= fim || *q < '0' || *q > '9')
+        return -1;
+    while (q < fim && *q >= '0' && *q <= '9') {
+        if (v > (0x7fffffffffffffffLL - 9) / 10)
+            return -1;
+        v = v * 10 + (*q - '0');
+        q++;
+    }
+    *p = q;
+    *valor = v;
+    return 0;
+}
+
+
+// Abre 'path' (ou o stdin) e lê o início, o bastante para reconhecer o
+// formato. Retorna 0 se ok, -1 em caso de erro (mensagem já impressa).
+static inline int kstream_abre(const char *path, kstream_t *s) {
+    const char *nome = (path != NULL) ? path : "stdin";
+
+    memset(s, 0, sizeof(*s));
+    s->f = (path != NULL) ? fopen(path, "rb") : stdin;
+    s->fechar_f = (path != NULL);
+    s->tcap = KSTREAM_TEXTO_BUF;
+    s->tbuf = (char *)malloc(s->tcap);
+    if (s->f == NULL || s->tbuf == NULL) {
+        fprintf(stderr, "Erro: nao foi possivel abrir '%s'.\n", nome);
+        return -1;
+    }
+#ifndef KMEANS_IO_NO_MMAP
+    // A entrada é percorrida sequencialmente, uma vez por passada
+    posix_fadvise(fileno(s->f), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    while (s->tfim < KMB_HEADER_SIZE && kstream_enche(s) > 0)
+        ;
+    return 0;
+}
+
+// A entrada começa com o cabeçalho do formato binário.
+static inline int kstream_eh_binario(const kstream_t *s) {
+    return s->tfim >= KMB_HEADER_SIZE && memcmp(s->tbuf, KMB_MAGIC, 4) == 0;
+}
+
+// Lê o cabeçalho binário e os K centróides. Retorna 0 se ok, -1 em caso de erro.
+static inline int kstream_cabecalho_bin(kstream_t *s, const char *nome) {
+    kmb_header_t h;
+    size_t i, nk;
+    void *tmp;
+
+    kstream_le(s, &h, sizeof(h));
+    if (kmb_header_check(&h, nome, (uint64_t)0x7fffffffffffffffLL) != 0)
+        return -1;
+    s->binario = 1;
+    s->elem_arquivo = (int)h.elem_size;
+    s->k = (int)h.k;
+    s->dim = (int)h.dim;
+    s->n = (long long)h.n;
+    s->precisao_float = (h.elem_size == sizeof(float));
+    nk = (size_t)s->k * s->dim;
+    s->mean = (double *)malloc(sizeof(double) * nk);
+    tmp = malloc(h.elem_size * nk);
+    if (s->mean == NULL || tmp == NULL) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para %zu coordenadas.\n", nk);
+        free(tmp);
+        return -1;
+    }
+    if (kstream_le(s, tmp, h.elem_size * nk) != 0) {
+        fprintf(stderr, "Erro: '%s' esta truncado (esperados %zu centroides).\n", nome, (size_t)s->k);
+        free(tmp);
+        return -1;
+    }
+    for (i = 0; i < nk; i++)
+        s->mean[i] = (h.elem_size == sizeof(float)) ? ((float *)tmp)[i] : ((double *)tmp)[i];
+    free(tmp);
+    s->dados_offset = KMB_HEADER_SIZE + (long long)h.elem_size * nk;
+    return 0;
+}
+
+// Lê o cabeçalho texto (K e N) e os K centróides. Retorna 0 se ok, -1 em caso de erro.
+static inline int kstream_cabecalho_texto(kstream_t *s) {
+    const char *linha, *fim;
+    long long cab[2];
+    int lidos = 0, c = 0;
+
+    // K e N (em uma ou duas linhas)
+    while (lidos < 2 && (linha = kstream_linha(s, &fim)) != NULL) {
+        while (lidos < 2 && kstream_inteiro(&linha, fim, &cab[lidos]) == 0)
+            lidos++;
+    }
+    if (lidos < 2 || cab[0] <= 0 || cab[0] > 0x7fffffff) {
+        fprintf(stderr, "Erro: cabecalho da entrada texto invalido (esperado K e N).\n");
+        return -1;
+    }
+    s->k = (int)cab[0];
+    s->n = cab[1];
+
+    // Os K centróides; DIM é o número de coordenadas do primeiro
+    while (c < s->k && (linha = kstream_linha(s, &fim)) != NULL) {
+        int r;
+        if (s->mean == NULL) {
+            dataset_t v;
+            memset(&v, 0, sizeof(v));
+            v.texto = linha;
+            v.texto_len = (size_t)(fim - linha);
+            if ((s->dim = text_count_fields(&v, 0)) == 0)
+                continue; // Linha em branco
+            s->mean = (double *)malloc(sizeof(double) * (size_t)s->k * s->dim);
+            if (s->mean == NULL) {
+                fprintf(stderr, "Erro: Falha ao alocar memoria para %zu coordenadas.\n", (size_t)s->k * s->dim);
+                return -1;
+            }
+        }
+        r = kstream_registro(linha, fim, s->dim, s->mean + (size_t)c * s->dim, NULL);
+        if (r < 0)
+            break;
+        c += r;
+    }
+    if (c < s->k) {
+        fprintf(stderr, "Erro: entrada texto deve ter %d centroides com %d coordenadas.\n", s->k, s->dim);
+        return -1;
+    }
+    s->dados_offset = s->tbase + (long long)s->tini;
+    return 0;
+}
+
+// Abre a entrada de 'path' (ou o stdin) e lê o cabeçalho e os K centróides
+// iniciais. Retorna 0 se ok, -1 em caso de erro (mensagem já impressa).
+static inline int kstream_open(const char *path, kstream_t *s) {
+    if (kstream_abre(path, s) != 0)
+        return -1;
+    if (kstream_eh_binario(s))
+        return kstream_cabecalho_bin(s, (path != NULL) ? path : "stdin");
+    return kstream_cabecalho_texto(s);
+}
+
+// Abre uma entrada só de pontos com 'dim' coordenadas (modo de predição):
+// texto sem cabeçalho, até o fim da entrada, ou os N pontos de um binário
+// (os K chutes do arquivo são ignorados). Retorna 0 se ok, -1 em caso de erro.
+static inline int kstream_open_pontos(const char *path, kstream_t *s, int dim) {
+    const char *nome = (path != NULL) ? path : "stdin";
+
+    if (kstream_abre(path, s) != 0)
+        return -1;
+    if (kstream_eh_binario(s)) {
+        if (kstream_cabecalho_bin(s, nome) != 0)
+            return -1;
+        if (s->dim != dim) {
+            fprintf(stderr, "Erro: '%s' tem DIM=%d e os centroides tem DIM=%d.\n", nome, s->dim, dim);
+            return -1;
+        }
+        return 0;
+    }
+    s->dim = dim;
+    s->n = 0x7fffffffffffffffLL;
+    s->sem_total = 1;
+    return 0;
+}
+
+
+// Preenche 'l' com os próximos 'm' pontos. Retorna o número de pontos lidos
+// (menos que 'm' só se a entrada acabou antes) ou -1 se está malformada.
+static inline int kstream_preenche(kstream_t *s, kstream_lote_t *l, int m) {
+    size_t nc = (size_t)m * s->dim;
+    int i = 0;
+
+    if (s->binario) {
+        size_t elem = s->precisao_float ? sizeof(float) : sizeof(double);
+        void *dst = s->precisao_float ? (void *)l->xf : (void *)l->x;
+        size_t feito;
+        if ((int)elem == s->elem_arquivo)
+            return (kstream_le(s, dst, elem * nc) == 0) ? m : -1;
+        // Binário double no modo float: converte em pedaços de KSTREAM_CONV
+        for (feito = 0; feito < nc; ) {
+            size_t parte = (nc - feito > KSTREAM_CONV) ? KSTREAM_CONV : nc - feito, a;
+            if (kstream_le(s, s->conv, parte * sizeof(double)) != 0)
+                return -1;
+            for (a = 0; a < parte; a++)
+                l->xf[feito + a] = (float)s->conv[a];
+            feito += parte;
+        }
+        return m;
+    }
+
+    while (i < m) {
+        const char *fim, *linha = kstream_linha(s, &fim);
+        int r;
+        if (linha == NULL)
+            return s->erro ? -1 : i;
+        r = kstream_registro(linha, fim, s->dim, s->precisao_float ? NULL : l->x + (size_t)i * s->dim,
+                             s->precisao_float ? l->xf + (size_t)i * s->dim : NULL);
+        if (r < 0)
+            return -1;
+        i += r;
+    }
+    return m;
+}
+
+
+// Pede ao kernel a leitura antecipada do trecho do arquivo que vem depois da
+// posição atual, do tamanho do último lote lido (ignorado em pipes).
+static inline void kstream_prefetch(kstream_t *s) {
+#ifndef KMEANS_IO_NO_MMAP
+    off_t pos = ftello(s->f);
+    if (pos >= 0) {
+        if (s->pos_lote > 0 && pos > s->pos_lote)
+            posix_fadvise(fileno(s->f), pos, pos - s->pos_lote, POSIX_FADV_WILLNEED);
+        s->pos_lote = pos;
+    }
+#else
+    (void)s;
+#endif
+}
+
+
+// Thread leitora: enche os lotes na ordem e, no fim de cada passada, entrega
+// um lote vazio e espera o próximo comando.
+static void *kstream_leitor(void *arg) {
+    kstream_t *s = (kstream_t *)arg;
+    int b = 0;
+
+    while (1) {
+        long long lidos = 0, total = s->n;
+        int comando;
+
+        while (1) {
+            kstream_lote_t *l = &s->lotes[b];
+            int m = (total - lidos > s->lote) ? s->lote : (int)(total - lidos);
+            int erro = 0, r;
+
+            pthread_mutex_lock(&s->mutex);
+            while (l->cheio && s->comando != KSTREAM_PARA)
+                pthread_cond_wait(&s->cond, &s->mutex);
+            comando = s->comando;
+            pthread_mutex_unlock(&s->mutex);
+            if (comando == KSTREAM_PARA)
+                return NULL;
+
+            // Fora do mutex: a leitura do lote se sobrepõe ao cálculo do outro
+            if (m > 0 && (r = kstream_preenche(s, l, m)) != m) {
+                if (r >= 0 && s->sem_total) {
+                    total = lidos + r; // Fim da entrada: o último lote é parcial
+                    m = r;
+                } else if (s->sem_total) {
+                    fprintf(stderr, "Erro: entrada malformada apos %lld pontos.\n", lidos);
+                    erro = 1;
+                    m = 0;
+                } else {
+                    fprintf(stderr, "Erro: entrada terminou ou esta malformada apos %lld de %lld pontos.\n", lidos, s->n);
+                    erro = 1;
+                    m = 0;
+                }
+            }
+            if (m > 0)
+                kstream_prefetch(s);
+            l->n = m;
+            l->primeiro = lidos;
+            lidos += m;
+            b ^= 1;
+
+            pthread_mutex_lock(&s->mutex);
+            s->erro |= erro;
+            l->cheio = 1;
+            pthread_cond_broadcast(&s->cond);
+            pthread_mutex_unlock(&s->mutex);
+            if (m == 0)
+                break; // Lote vazio entregue: fim da passada
+        }
+
+        pthread_mutex_lock(&s->mutex);
+        while (s->comando == KSTREAM_AGUARDA)
+            pthread_cond_wait(&s->cond, &s->mutex);
+        comando = s->comando;
+        if (comando == KSTREAM_CONTINUA)
+            s->comando = KSTREAM_AGUARDA;
+        pthread_mutex_unlock(&s->mutex);
+        if (comando == KSTREAM_PARA)
+            return NULL;
+    }
+}
+
+
+// Aloca os 2 lotes de 'lote' pontos e inicia a leitora. Com 'precisao_float'
+// os pontos ficam em float (um binário float já está nesse modo).
+// Retorna 0 se ok, -1 em caso de erro.
+static inline int kstream_start(kstream_t *s, int lote, int precisao_float) {
+    size_t nc = (size_t)lote * s->dim;
+    int b;
+
+    s->lote = lote;
+    s->precisao_float |= precisao_float;
+    if (s->binario && s->precisao_float && s->elem_arquivo == sizeof(double) &&
+        (s->conv = (double *)malloc(sizeof(double) * KSTREAM_CONV)) == NULL) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para a conversao.\n");
+        return -1;
+    }
+    for (b = 0; b < 2; b++) {
+        if (s->precisao_float)
+            s->lotes[b].xf = (float *)malloc(sizeof(float) * nc);
+        else
+            s->lotes[b].x = (double *)malloc(sizeof(double) * nc);
+        if (s->lotes[b].x == NULL && s->lotes[b].xf == NULL) {
+            fprintf(stderr, "Erro: Falha ao alocar memoria para os lotes de %d pontos.\n", lote);
+            return -1;
+        }
+    }
+    pthread_mutex_init(&s->mutex, NULL);
+    pthread_cond_init(&s->cond, NULL);
+    s->comando = KSTREAM_AGUARDA;
+    if (pthread_create(&s->leitor, NULL, kstream_leitor, s) != 0) {
+        fprintf(stderr, "Erro: Falha ao criar a thread leitora.\n");
+        return -1;
+    }
+    s->leitor_ativo = 1;
+    return 0;
+}
+
+// Espera o próximo lote ficar pronto. Um lote com n == 0 marca o fim da
+// passada (ou um erro de leitura, com s->erro = 1).
+static inline kstream_lote_t *kstream_pega(kstream_t *s) {
+    kstream_lote_t *l = &s->lotes[s->atual];
+
+    pthread_mutex_lock(&s->mutex);
+    while (!l->cheio)
+        pthread_cond_wait(&s->cond, &s->mutex);
+    pthread_mutex_unlock(&s->mutex);
+    s->atual ^= 1;
+    return l;
+}
+
+// Devolve o lote entregue há mais tempo, depois que nenhuma thread lê mais
+// os seus pontos: a leitora pode enchê-lo de novo.
+static inline void kstream_devolve(kstream_t *s) {
+    pthread_mutex_lock(&s->mutex);
+    s->lidos += s->lotes[s->devolver].n;
+    s->lotes[s->devolver].cheio = 0;
+    s->devolver ^= 1;
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->mutex);
+}
+
+// Depois do lote vazio do fim da passada: volta ao primeiro ponto e pede
+// mais uma passada. Retorna 0 se ok, -1 se a entrada não permite voltar
+// (um pipe, por exemplo).
+static inline int kstream_recomeca(kstream_t *s) {
+    if (s->erro)
+        return -1;
+    // A leitora está parada esperando o comando: o arquivo é só desta thread
+#ifndef KMEANS_IO_NO_MMAP
+    if (fseeko(s->f, (off_t)s->dados_offset, SEEK_SET) != 0) {
+#else
+    if (fseek(s->f, (long)s->dados_offset, SEEK_SET) != 0) {
+#endif
+        fprintf(stderr, "Erro: a entrada nao permite mais de uma passada (use -i ou redirecione um arquivo).\n");
+        s->erro = 1;
+        return -1;
+    }
+    s->tini = s->tfim = 0;
+    s->tbase = s->dados_offset;
+    s->pos_lote = 0;
+    kstream_devolve(s);
+    pthread_mutex_lock(&s->mutex);
+    s->comando = KSTREAM_CONTINUA;
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->mutex);
+    return 0;
+}
+
+// Encerra a leitora (em qualquer ponto da passada) e libera tudo.
+static inline void kstream_fecha(kstream_t *s) {
+    if (s->leitor_ativo) {
+        pthread_mutex_lock(&s->mutex);
+        s->comando = KSTREAM_PARA;
+        pthread_cond_broadcast(&s->cond);
+        pthread_mutex_unlock(&s->mutex);
+        pthread_join(s->leitor, NULL);
+        pthread_mutex_destroy(&s->mutex);
+        pthread_cond_destroy(&s->cond);
+    }
+    if (s->f != NULL && s->fechar_f)
+        fclose(s->f);
+    free(s->lotes[0].x);
+    free(s->lotes[0].xf);
+    free(s->lotes[1].x);
+    free(s->lotes[1].xf);
+    free(s->mean);
+    free(s->conv);
+    free(s->tbuf);
+    memset(s, 0, sizeof(*s));
+}
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef KMEANS_TRACE_H
+#define KMEANS_TRACE_H
+
+// Trace binário da versão de depuração (logconc.c), no lugar do log texto
+// escrito com fprintf sob um mutex. Cada thread grava registros de tamanho
+// fixo (ktrace_reg_t) em um anel só seu, alocado antes do lançamento das
+// threads: gravar é uma cópia de 24 bytes e um incremento, sem trava e sem
+// chamada ao sistema além do relógio. Se o anel encher, os registros mais
+// antigos são sobrescritos (e contados como perdidos).
+//
+// Depois do join, ktrace_grava escreve os anéis em um arquivo compacto:
+//
+//   ktrace_cabecalho_t
+//   para cada thread: ktrace_bloco_t e os 'gravados' registros, em ordem
+//
+// O trace2log.c converte o arquivo para o log texto original ou para o
+// formato de eventos do Chrome (chrome://tracing, Perfetto).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#define KTRACE_VERSAO      1
+#define KTRACE_LINHA_CACHE 64
+#define KTRACE_CAPACIDADE  65536   // Registros por thread (potência de 2)
+
+// Eventos (os mesmos pontos em que o logconc.c escrevia uma linha)
+#define KTRACE_ATRIB_INICIO     0   // valor = primeiro ponto, valor2 = último ponto
+#define KTRACE_ATRIB_FIM        1   // valor = flips locais
+#define KTRACE_BARREIRA_CHEGOU  2
+#define KTRACE_BARREIRA_PASSOU  3
+#define KTRACE_CONTAB_INICIO    4
+#define KTRACE_CONTAB_TOTAL     5   // valor = total de flips
+#define KTRACE_CONVERGIU        6
+#define KTRACE_SOMA_INICIO      7
+#define KTRACE_REDUCAO_INICIO   8
+#define KTRACE_REDUCAO_FIM      9
+#define KTRACE_EVENTOS          10
+
+typedef struct ktrace_reg_t {
+    uint64_t ns;          // CLOCK_MONOTONIC desde ktrace_init
+    int32_t iteracao;
+    uint16_t thread;
+    uint8_t evento;       // KTRACE_*
+    uint8_t barreira;     // Número da barreira (0 nos outros eventos)
+    int32_t valor, valor2;
+} ktrace_reg_t;
+
+// Anel de uma thread, em linhas de cache só suas
+typedef struct ktrace_anel_t {
+    _Alignas(KTRACE_LINHA_CACHE) uint64_t total;   // Registros gravados desde o início
+    ktrace_reg_t *regs;
+} ktrace_anel_t;
+
+typedef struct ktrace_t {
+    int num_threads;
+    uint32_t capacidade;
+    ktrace_anel_t *aneis;
+    void *raw;
+    struct timespec base;
+} ktrace_t;
+
+typedef struct ktrace_cabecalho_t {
+    char magic[4];            // "KTRC"
+    uint32_t versao;
+    uint32_t num_threads;
+    uint32_t tam_registro;    // sizeof(ktrace_reg_t)
+    double tempo_cpu;         // "Tempo de CPU total" do programa
+} ktrace_cabecalho_t;
+
+typedef struct ktrace_bloco_t {
+    uint32_t thread;
+    uint32_t reservado;
+    uint64_t total;           // Registros gravados pela thread
+    uint64_t gravados;        // Os últimos min(total, capacidade), que seguem o bloco
+} ktrace_bloco_t;
+
+
+// Aloca 'capacidade' registros (arredondada para potência de 2) por thread.
+// Retorna 0 se ok, -1 se faltar memória.
+static inline int ktrace_init(ktrace_t *tr, int num_threads, uint32_t capacidade) {
+    int t;
+
+    memset(tr, 0, sizeof(*tr));
+    tr->capacidade = 1;
+    while (tr->capacidade < capacidade)
+        tr->capacidade <<= 1;
+    tr->num_threads = num_threads;
+    tr->raw = calloc(1, sizeof(ktrace_anel_t) * num_threads + KTRACE_LINHA_CACHE);
+    if (tr->raw == NULL)
+        return -1;
+    tr->aneis = (ktrace_anel_t *)(((uintptr_t)tr->raw + KTRACE_LINHA_CACHE - 1) & ~(uintptr_t)(KTRACE_LINHA_CACHE - 1));
+    for (t = 0; t < num_threads; t++) {
+        // Páginas tocadas agora, para que a gravação não pague as falhas de página
+        tr->aneis[t].regs = (ktrace_reg_t *)calloc(tr->capacidade, sizeof(ktrace_reg_t));
+        if (tr->aneis[t].regs == NULL)
+            return -1;
+        memset(tr->aneis[t].regs, 0, sizeof(ktrace_reg_t) * tr->capacidade);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &tr->base);
+    return 0;
+}
+
+static inline void ktrace_free(ktrace_t *tr) {
+    int t;
+    for (t = 0; t < tr->num_threads; t++)
+        free(tr->aneis[t].regs);
+    free(tr->raw);
+}
+
+
+// Grava um evento no anel da thread 'id' (só a própria thread grava nele).
+static inline void ktrace_evento(ktrace_t *tr, int id, int iteracao, int evento, int barreira, int valor, int valor2) {
+    ktrace_anel_t *a = &tr->aneis[id];
+    ktrace_reg_t *r = &a->regs[a->total & (tr->capacidade - 1)];
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    r->ns = (uint64_t)(ts.tv_sec - tr->base.tv_sec) * 1000000000ULL + (uint64_t)ts.tv_nsec - (uint64_t)tr->base.tv_nsec;
+    r->iteracao = iteracao;
+    r->thread = (uint16_t)id;
+    r->evento = (uint8_t)evento;
+    r->barreira = (uint8_t)barreira;
+    r->valor = valor;
+    r->valor2 = valor2;
+    a->total++;
+}
+
+
+// Escreve os anéis em 'caminho' (depois do join). Retorna 0 se ok, -1 se falhar.
+static inline int ktrace_grava(const ktrace_t *tr, const char *caminho, double tempo_cpu) {
+    ktrace_cabecalho_t cab;
+    FILE *f = fopen(caminho, "wb");
+    int t, ok = (f != NULL);
+
+    if (!ok) {
+        fprintf(stderr, "Erro: nao foi possivel criar '%s'.\n", caminho);
+        return -1;
+    }
+    memset(&cab, 0, sizeof(cab));
+    memcpy(cab.magic, "KTRC", 4);
+    cab.versao = KTRACE_VERSAO;
+    cab.num_threads = (uint32_t)tr->num_threads;
+    cab.tam_registro = sizeof(ktrace_reg_t);
+    cab.tempo_cpu = tempo_cpu;
+    ok = fwrite(&cab, sizeof(cab), 1, f) == 1;
+
+    for (t = 0; t < tr->num_threads && ok; t++) {
+        const ktrace_anel_t *a = &tr->aneis[t];
+        ktrace_bloco_t bloco;
+        uint64_t primeiro, i;
+
+        memset(&bloco, 0, sizeof(bloco));
+        bloco.thread = (uint32_t)t;
+        bloco.total = a->total;
+        bloco.gravados = (a->total < tr->capacidade) ? a->total : tr->capacidade;
+        ok = fwrite(&bloco, sizeof(bloco), 1, f) == 1;
+        primeiro = a->total - bloco.gravados;
+        for (i = primeiro; i < a->total && ok; i++)
+            ok = fwrite(&a->regs[i & (tr->capacidade - 1)], sizeof(ktrace_reg_t), 1, f) == 1;
+    }
+    if (fclose(f) != 0 || !ok) {
+        fprintf(stderr, "Erro: falha ao gravar '%s'.\n", caminho);
+        return -1;
+    }
+    return 0;
+}
+
+#endif
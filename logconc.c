@@ -3,16 +3,16 @@
 #include <math.h>
 #include <time.h>       
 #include <pthread.h>    
-
-#define DIM 3
+#include "kmeans_io.h"
+#include "kmeans_trace.h"
 
 //  Variáveis Globais de Sincronização e Log 
 pthread_mutex_t barrier_mutex;
 pthread_cond_t barrier_cond;
 int barrier_counter = 0;
 int num_threads_global;
-pthread_mutex_t log_mutex; // Mutex para proteger a escrita no arquivo de log
-FILE *log_file = NULL;     
+int dim_global;            // Número de coordenadas, lido da entrada
+ktrace_t trace;            // Um anel de registros por thread, sem trava (ver kmeans_trace.h)
 
 //  Estrutura de Dados para Threads 
 typedef struct thread_data_t {
@@ -38,9 +38,7 @@ typedef struct thread_data_t {
 
 void manual_barrier_wait(int id, int iter, int barrier_num) {
     // Log antes de esperar
-    pthread_mutex_lock(&log_mutex);
-    if (log_file) fprintf(log_file, "[Thread %d, Iter %d]: \t-- Chegou na Barreira %d --\n", id, iter, barrier_num);
-    pthread_mutex_unlock(&log_mutex);
+    ktrace_evento(&trace, id, iter, KTRACE_BARREIRA_CHEGOU, barrier_num, 0, 0);
 
     pthread_mutex_lock(&barrier_mutex);
     barrier_counter++;
@@ -53,9 +51,7 @@ void manual_barrier_wait(int id, int iter, int barrier_num) {
     pthread_mutex_unlock(&barrier_mutex);
 
     // Log depois de passar
-    pthread_mutex_lock(&log_mutex);
-     if (log_file) fprintf(log_file, "[Thread %d, Iter %d]: \t-- Passou da Barreira %d --\n", id, iter, barrier_num); 
-    pthread_mutex_unlock(&log_mutex);
+    ktrace_evento(&trace, id, iter, KTRACE_BARREIRA_PASSOU, barrier_num, 0, 0);
 }
 
 
@@ -76,6 +72,7 @@ void *kmeans_worker(void *arg) {
     int *count = data->count;
     double *sum_local = data->sum_local;
     int *count_local = data->count_local;
+    int dim = dim_global;
     int i, j, c;
     double dmin, dx;
     int color;
@@ -86,9 +83,7 @@ void *kmeans_worker(void *arg) {
     while (1) {
 
         //  1. ETAPA DE ATRIBUIÇÃO 
-        pthread_mutex_lock(&log_mutex);
-        if (log_file) fprintf(log_file, "[Thread %d, Iter %d]: Etapa 1 (Atribuicao) Iniciada (Pontos %d a %d)\n", id, iter_local, start_n, end_n - 1);
-        pthread_mutex_unlock(&log_mutex);
+        ktrace_evento(&trace, id, iter_local, KTRACE_ATRIB_INICIO, 0, start_n, end_n - 1);
 
         data->flips_local = 0;
         for (i = start_n; i < end_n; i++) {
@@ -96,8 +91,8 @@ void *kmeans_worker(void *arg) {
              color = cluster[i];
              for (c = 0; c < k; c++) {
                  dx = 0.0;
-                 for (j = 0; j < DIM; j++)
-                     dx += (x[i*DIM+j] - mean[c*DIM+j])*(x[i*DIM+j] - mean[c*DIM+j]);
+                 for (j = 0; j < dim; j++)
+                     dx += (x[i*dim+j] - mean[c*dim+j])*(x[i*dim+j] - mean[c*dim+j]);
                  if (dx < dmin || dmin == -1) {
                      color = c;
                      dmin = dx;
@@ -110,18 +105,14 @@ void *kmeans_worker(void *arg) {
          }
 
 
-        pthread_mutex_lock(&log_mutex);
-        if (log_file) fprintf(log_file, "[Thread %d, Iter %d]: Etapa 1 (Atribuicao) Concluida. Flips locais: %d\n", id, iter_local, data->flips_local);
-        pthread_mutex_unlock(&log_mutex);
+        ktrace_evento(&trace, id, iter_local, KTRACE_ATRIB_FIM, 0, data->flips_local, 0);
 
         //  BARREIRA 1 
         manual_barrier_wait(id, iter_local, 1);
 
         //  2. ETAPA DE CONTABILIDADE (Thread 0) 
         if (id == 0) {
-            pthread_mutex_lock(&log_mutex);
-            if (log_file) fprintf(log_file, "[Thread %d, Iter %d]: Etapa 2 (Contabilidade) Iniciada...\n", id, iter_local);
-            pthread_mutex_unlock(&log_mutex);
+            ktrace_evento(&trace, id, iter_local, KTRACE_CONTAB_INICIO, 0, 0, 0);
 
             int total_flips = 0;
             for (int t = 0; t < num_threads_global; t++) {
@@ -129,15 +120,13 @@ void *kmeans_worker(void *arg) {
             }
             *data->flips_global_ptr = total_flips;
 
-            pthread_mutex_lock(&log_mutex);
-            if (log_file) fprintf(log_file, "[Thread %d, Iter %d]: Etapa 2 (Contabilidade) - Total de Flips: %d\n", id, iter_local, total_flips);
-            pthread_mutex_unlock(&log_mutex);
+            ktrace_evento(&trace, id, iter_local, KTRACE_CONTAB_TOTAL, 0, total_flips, 0);
 
             if (total_flips > 0) {
                  for (c = 0; c < k; c++) {
                      count[c] = 0;
-                     for (j = 0; j < DIM; j++) {
-                         sum[c * DIM + j] = 0.0;
+                     for (j = 0; j < dim; j++) {
+                         sum[c * dim + j] = 0.0;
                      }
                  }
              }
@@ -148,28 +137,24 @@ void *kmeans_worker(void *arg) {
 
         //  3. CHECAGEM DE SAÍDA 
         if (*data->flips_global_ptr == 0) {
-            pthread_mutex_lock(&log_mutex);
-            if (log_file) fprintf(log_file, "[Thread %d]: CONVERGIU! Saindo do loop.\n", id);
-            pthread_mutex_unlock(&log_mutex);
+            ktrace_evento(&trace, id, iter_local, KTRACE_CONVERGIU, 0, 0, 0);
             break;
         }
 
         //  4. ETAPA DE SOMA LOCAL 
-        pthread_mutex_lock(&log_mutex);
-        if (log_file) fprintf(log_file, "[Thread %d, Iter %d]: Etapa 4 (Soma Local) Iniciada...\n", id, iter_local);
-        pthread_mutex_unlock(&log_mutex);
+        ktrace_evento(&trace, id, iter_local, KTRACE_SOMA_INICIO, 0, 0, 0);
 
         for (c = 0; c < k; c++) {
             count_local[c] = 0;
-            for (j = 0; j < DIM; j++) {
-                sum_local[c * DIM + j] = 0.0;
+            for (j = 0; j < dim; j++) {
+                sum_local[c * dim + j] = 0.0;
             }
         }
         for (i = start_n; i < end_n; i++) {
             c = cluster[i];
             count_local[c]++;
-            for (j = 0; j < DIM; j++) {
-                sum_local[c*DIM+j] += x[i*DIM+j];
+            for (j = 0; j < dim; j++) {
+                sum_local[c*dim+j] += x[i*dim+j];
             }
         }
 
@@ -178,33 +163,29 @@ void *kmeans_worker(void *arg) {
 
         //  5. ETAPA DE REDUÇÃO GLOBAL E MÉDIA (Thread 0) 
         if (id == 0) {
-            pthread_mutex_lock(&log_mutex);
-            if (log_file) fprintf(log_file, "[Thread %d, Iter %d]: Etapa 5 (Reducao Global/Media) Iniciada...\n", id, iter_local);
-            pthread_mutex_unlock(&log_mutex);
+            ktrace_evento(&trace, id, iter_local, KTRACE_REDUCAO_INICIO, 0, 0, 0);
 
              for (int t = 0; t < num_threads_global; t++) {
                 thread_data_t* other_thread = &data->all_thread_data[t];
                 for (c = 0; c < k; c++) {
                     if (other_thread->count_local[c] > 0) {
                         count[c] += other_thread->count_local[c];
-                        for (j = 0; j < DIM; j++) {
-                            sum[c*DIM+j] += other_thread->sum_local[c*DIM+j];
+                        for (j = 0; j < dim; j++) {
+                            sum[c*dim+j] += other_thread->sum_local[c*dim+j];
                         }
                     }
                 }
             }
             for (c = 0; c < k; c++) {
                 if (count[c] > 0) {
-                    for (j = 0; j < DIM; j++) {
-                        mean[c*DIM+j] = sum[c*DIM+j] / count[c];
+                    for (j = 0; j < dim; j++) {
+                        mean[c*dim+j] = sum[c*dim+j] / count[c];
                     }
                 }
             }
 
 
-            pthread_mutex_lock(&log_mutex);
-            if (log_file) fprintf(log_file, "[Thread %d, Iter %d]: Etapa 5 (Reducao Global/Media) Concluida.\n", id, iter_local);
-            pthread_mutex_unlock(&log_mutex);
+            ktrace_evento(&trace, id, iter_local, KTRACE_REDUCAO_FIM, 0, 0, 0);
         }
 
         //  BARREIRA 4 
@@ -220,7 +201,8 @@ void *kmeans_worker(void *arg) {
 
 //  Main 
 int main(int argc, char *argv[]) {
-    int i, j, k, n, c;
+    int i, j, k, n, c, dim;
+    dataset_t ds;
     double *x, *mean, *sum;
     int *cluster, *count;
     int flips_global;
@@ -233,53 +215,53 @@ int main(int argc, char *argv[]) {
     thread_data_t *thread_data;
 
     // Use barras duplas \\ ou barras normais / no caminho
-    const char *log_file_path = "log1.txt"; // Usei /
-    log_file = fopen(log_file_path, "w");
-    if (log_file == NULL) {
-        // Se falhar ao abrir o log, avisa no console (stderr) e continua sem log
-        perror("Aviso: Nao foi possivel criar log.txt, logs serao omitidos");
-    }
+    // O trace binário vai para log1.trace; o trace2log.c gera o log texto
+    const char *trace_path = "log1.trace"; // Usei /
+    unsigned long capacidade = KTRACE_CAPACIDADE;
 
     inicio = clock();
 
     //  1. FASE DE SETUP (Leitura + Alocação) 
-    scanf("%d", &k);
-    scanf("%d", &n);
-
-    x = (double *)malloc(sizeof(double)*DIM*n);
-    mean = (double *)malloc(sizeof(double)*DIM*k);
-    sum= (double *)malloc(sizeof(double)*DIM*k);
+    if (dataset_open(NULL, &ds) != 0 || dataset_parse_text(&ds) != 0)
+        return 1;
+    k = ds.k;
+    n = ds.n;
+    dim = ds.dim;
+    dim_global = dim;
+
+    x = ds.x;
+    mean = ds.mean;
+    sum= (double *)malloc(sizeof(double)*dim*k);
     cluster = (int *)malloc(sizeof(int)*n);
     count = (int *)malloc(sizeof(int)*k);
     for (i = 0; i<n; i++) cluster[i] = 0;
-    for (i = 0; i<k; i++) scanf("%lf %lf %lf", mean+i*DIM, mean+i*DIM+1, mean+i*DIM+2);
-    for (i = 0; i<n; i++) scanf("%lf %lf %lf", x+i*DIM, x+i*DIM+1, x+i*DIM+2);
     flips_global = n;
 
 
     //  2. SETUP DAS THREADS 
-    if (argc != 2) {
-        if (log_file) fprintf(log_file, "Erro: Numero de threads nao especificado.\n");
+    if (argc != 2 && argc != 3) {
         fprintf(stderr, "Erro: Voce deve especificar o numero de threads.\n"); // E pro console
-        fprintf(stderr, "Uso: cat input.txt | %s <numero_de_threads> > output.txt\n", argv[0]);
-        if (log_file) fclose(log_file);
+        fprintf(stderr, "Uso: cat input.txt | %s <numero_de_threads> [registros_por_thread] > output.txt\n", argv[0]);
         return 1;
     }
     num_threads = atoi(argv[1]);
+    if (argc == 3)
+        capacidade = strtoul(argv[2], NULL, 10);
 
-    if (num_threads <= 0) {
-        if (log_file) fprintf(log_file, "Erro: Numero de threads invalido (%d).\n", num_threads);
-        fprintf(stderr, "Erro: Numero de threads deve ser positivo.\n"); // E pro console
-         if (log_file) fclose(log_file);
+    if (num_threads <= 0 || capacidade == 0 || capacidade > (1UL << 30)) {
+        fprintf(stderr, "Erro: Numero de threads e de registros por thread devem ser positivos.\n"); // E pro console
         return 1;
     }
     num_threads_global = num_threads;
 
-    if (log_file) fprintf(log_file, "Iniciando K-Means com %d threads (Opcao 2: Reducao Local)\n", num_threads);
+    // Anéis do trace alocados (e tocados) antes do lançamento das threads
+    if (ktrace_init(&trace, num_threads, (uint32_t)capacidade) != 0) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para o trace\n");
+        return 1;
+    }
 
     threads = (pthread_t *)malloc(num_threads * sizeof(pthread_t));
     thread_data = (thread_data_t *)malloc(num_threads * sizeof(thread_data_t));
-    pthread_mutex_init(&log_mutex, NULL);
     pthread_mutex_init(&barrier_mutex, NULL);
     pthread_cond_init(&barrier_cond, NULL);
     barrier_counter = 0;
@@ -304,12 +286,10 @@ int main(int argc, char *argv[]) {
         thread_data[i].cluster = cluster;
         thread_data[i].count = count;
         thread_data[i].all_thread_data = thread_data;
-        thread_data[i].sum_local = (double *)malloc(sizeof(double) * k * DIM);
+        thread_data[i].sum_local = (double *)malloc(sizeof(double) * k * dim);
         thread_data[i].count_local = (int *)malloc(sizeof(int) * k);
         if (thread_data[i].sum_local == NULL || thread_data[i].count_local == NULL) {
             fprintf(stderr, "Erro: Falha ao alocar memoria local para a thread %d\n", i);
-            if (log_file) fprintf(log_file, "Erro: Falha ao alocar memoria local para a thread %d\n", i);
-             if (log_file) fclose(log_file);
             return 1;
         }
         pthread_create(&threads[i], NULL, kmeans_worker, (void *)&thread_data[i]);
@@ -324,8 +304,8 @@ int main(int argc, char *argv[]) {
 
     //  5. FASE DE ESCRITA (Resultados) 
     for (i = 0; i < k; i++) {
-        for (j = 0; j < DIM; j++)
-            printf("%5.2f ", mean[i*DIM+j]);
+        for (j = 0; j < dim; j++)
+            printf("%5.2f ", mean[i*dim+j]);
         printf("\n");
     }
 
@@ -335,16 +315,17 @@ int main(int argc, char *argv[]) {
 
     
     fprintf(stderr, "Tempo de CPU total (Opcao 2): %f segundos\n", tempo_total);
-    if (log_file) fprintf(log_file, "Tempo de CPU total (Opcao 2): %f segundos\n", tempo_total);
+
+    // 6.1 Gravação do trace (fora da região medida pelas threads)
+    if (ktrace_grava(&trace, trace_path, tempo_total) == 0)
+        fprintf(stderr, "Trace gravado em %s (converta com trace2log)\n", trace_path);
 
 
     //  7. LIMPEZA 
-    free(x);
-    free(mean);
+    dataset_free(&ds); // 'x' e 'mean'
     free(sum);
     free(cluster);
     free(count);
-    pthread_mutex_destroy(&log_mutex);
     pthread_mutex_destroy(&barrier_mutex);
     pthread_cond_destroy(&barrier_cond);
     for (i = 0; i < num_threads; i++) {
@@ -353,11 +334,7 @@ int main(int argc, char *argv[]) {
     }
     free(threads);
     free(thread_data);
-
-    
-    if (log_file) {
-        fclose(log_file);
-    }
+    ktrace_free(&trace);
 
     return 0;
 }
\ No newline at end of file
@@ -2,16 +2,16 @@
 #include <stdlib.h>
 #include <math.h>
 #include <time.h> // Para medir o tempo
-
-#define DIM 3
+#include "kmeans_io.h"
 
 int main(void) {
-    int i, j, k, n, c;
+    int i, j, k, n, c, dim;
     double dmin, dx;
     double *x, *mean, *sum;
     int *cluster, *count, color;
     int flips;
     int iter = 0; // <-- ADICIONADO: Contador de iteração
+    dataset_t ds;
 
     //  Variáveis de Tomada de Tempo 
     clock_t inicio, fim;
@@ -32,24 +32,26 @@ int main(void) {
 
     //  1. FASE DE SETUP (Leitura + Alocação) 
     fprintf(stderr, "[Iter %d]: Etapa 1 (Setup) Iniciada...\n", iter); // <-- ADICIONADO: Log
-    scanf("%d", &k);
-    scanf("%d", &n);
-    fprintf(stderr, "[Iter %d]: Lendo K=%d clusters e N=%d pontos.\n", iter, k, n); // <-- ADICIONADO: Log
-
-    x = (double *)malloc(sizeof(double)*DIM*n);
-    mean = (double *)malloc(sizeof(double)*DIM*k);
-    sum= (double *)malloc(sizeof(double)*DIM*k);
+    if (dataset_open(NULL, &ds) != 0)
+        return 1;
+    k = ds.k;
+    n = ds.n;
+    dim = ds.dim; // Número de coordenadas, lido da entrada
+    fprintf(stderr, "[Iter %d]: Lendo K=%d clusters e N=%d pontos (dim=%d).\n", iter, k, n, dim); // <-- ADICIONADO: Log
+
+    x = ds.x;
+    mean = ds.mean;
+    sum= (double *)malloc(sizeof(double)*dim*k);
     cluster = (int *)malloc(sizeof(int)*n);
     count = (int *)malloc(sizeof(int)*k);
 
     for (i = 0; i<n; i++)
         cluster[i] = 0;
-    fprintf(stderr, "[Iter %d]: Lendo %d centroides iniciais...\n", iter, k); // <-- ADICIONADO: Log
-    for (i = 0; i<k; i++)
-        scanf("%lf %lf %lf", mean+i*DIM, mean+i*DIM+1, mean+i*DIM+2);
-    fprintf(stderr, "[Iter %d]: Lendo %d pontos de dados...\n", iter, n); // <-- ADICIONADO: Log
-    for (i = 0; i<n; i++)
-        scanf("%lf %lf %lf", x+i*DIM, x+i*DIM+1, x+i*DIM+2);
+    fprintf(stderr, "[Iter %d]: Lendo %d centroides iniciais e %d pontos de dados...\n", iter, k, n); // <-- ADICIONADO: Log
+    if (dataset_parse_text(&ds) != 0) {
+        dataset_free(&ds);
+        return 1;
+    }
     fprintf(stderr, "[Iter %d]: Etapa 1 (Setup) Concluida.\n", iter); // <-- ADICIONADO: Log
 
 
@@ -64,16 +66,16 @@ int main(void) {
         // Zera contadores (parte da atualização, mas feito antes da atribuição)
         for (j = 0; j < k; j++) {
             count[j] = 0;
-            for (i = 0; i < DIM; i++)
-                sum[j*DIM+i] = 0.0;
+            for (i = 0; i < dim; i++)
+                sum[j*dim+i] = 0.0;
         }
         // Atribui pontos
         for (i = 0; i < n; i++) {
             dmin = -1; color = cluster[i];
             for (c = 0; c < k; c++) {
                 dx = 0.0;
-                for (j = 0; j < DIM; j++)
-                    dx +=  (x[i*DIM+j] - mean[c*DIM+j])*(x[i*DIM+j] - mean[c*DIM+j]);
+                for (j = 0; j < dim; j++)
+                    dx +=  (x[i*dim+j] - mean[c*dim+j])*(x[i*dim+j] - mean[c*dim+j]);
                 if (dx < dmin || dmin == -1) {
                     color = c;
                     dmin = dx;
@@ -97,14 +99,14 @@ int main(void) {
         // Soma
         for (i = 0; i < n; i++) {
             count[cluster[i]]++;
-            for (j = 0; j < DIM; j++)
-                sum[cluster[i]*DIM+j] += x[i*DIM+j];
+            for (j = 0; j < dim; j++)
+                sum[cluster[i]*dim+j] += x[i*dim+j];
         }
         // Média
         for (i = 0; i < k; i++) {
-            for (j = 0; j < DIM; j++) {
+            for (j = 0; j < dim; j++) {
                 if (count[i] > 0) {
-                    mean[i*DIM+j] = sum[i*DIM+j]/count[i];
+                    mean[i*dim+j] = sum[i*dim+j]/count[i];
                 }
             }
         }
@@ -117,8 +119,8 @@ int main(void) {
     //  3. FASE DE ESCRITA (Resultados) 
     fprintf(stderr, "\n Fase de Escrita dos Resultados (stdout) \n"); // <-- ADICIONADO: Log
     for (i = 0; i < k; i++) {
-        for (j = 0; j < DIM; j++)
-            printf("%5.2f ", mean[i*DIM+j]); // Isso vai para o CONSOLE (stdout)
+        for (j = 0; j < dim; j++)
+            printf("%5.2f ", mean[i*dim+j]); // Isso vai para o CONSOLE (stdout)
         printf("\n");
     }
 
@@ -135,8 +137,7 @@ int main(void) {
     #endif
 
     // Libera a memória
-    free(x);
-    free(mean);
+    dataset_free(&ds); // 'x' e 'mean'
     free(sum);
     free(cluster);
     free(count);
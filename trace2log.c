@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "kmeans_trace.h"
+
+// Conversor do trace binário do logconc.c (ver kmeans_trace.h). Sem opções,
+// imprime o log texto original, com os eventos de todas as threads
+// intercalados pela ordem do relógio. Com -c, imprime o JSON de eventos do
+// Chrome (chrome://tracing, Perfetto): uma linha do tempo por thread, com as
+// etapas e as esperas em cada barreira.
+
+typedef struct trace_thread_t {
+    ktrace_bloco_t bloco;
+    ktrace_reg_t *regs;
+} trace_thread_t;
+
+static const char *nomes_etapa[KTRACE_EVENTOS] = {
+    "Atribuicao", NULL, "Barreira", NULL, "Contabilidade", NULL, NULL, "Soma Local", "Reducao Global/Media", NULL
+};
+
+
+// Uma linha do log texto, com as mensagens que o logconc.c escrevia.
+static void imprime_linha(const ktrace_reg_t *r) {
+    int id = r->thread, it = r->iteracao;
+
+    switch (r->evento) {
+    case KTRACE_ATRIB_INICIO:
+        printf("[Thread %d, Iter %d]: Etapa 1 (Atribuicao) Iniciada (Pontos %d a %d)\n", id, it, r->valor, r->valor2);
+        break;
+    case KTRACE_ATRIB_FIM:
+        printf("[Thread %d, Iter %d]: Etapa 1 (Atribuicao) Concluida. Flips locais: %d\n", id, it, r->valor);
+        break;
+    case KTRACE_BARREIRA_CHEGOU:
+        printf("[Thread %d, Iter %d]: \t-- Chegou na Barreira %d --\n", id, it, r->barreira);
+        break;
+    case KTRACE_BARREIRA_PASSOU:
+        printf("[Thread %d, Iter %d]: \t-- Passou da Barreira %d --\n", id, it, r->barreira);
+        break;
+    case KTRACE_CONTAB_INICIO:
+        printf("[Thread %d, Iter %d]: Etapa 2 (Contabilidade) Iniciada...\n", id, it);
+        break;
+    case KTRACE_CONTAB_TOTAL:
+        printf("[Thread %d, Iter %d]: Etapa 2 (Contabilidade) - Total de Flips: %d\n", id, it, r->valor);
+        break;
+    case KTRACE_CONVERGIU:
+        printf("[Thread %d]: CONVERGIU! Saindo do loop.\n", id);
+        break;
+    case KTRACE_SOMA_INICIO:
+        printf("[Thread %d, Iter %d]: Etapa 4 (Soma Local) Iniciada...\n", id, it);
+        break;
+    case KTRACE_REDUCAO_INICIO:
+        printf("[Thread %d, Iter %d]: Etapa 5 (Reducao Global/Media) Iniciada...\n", id, it);
+        break;
+    case KTRACE_REDUCAO_FIM:
+        printf("[Thread %d, Iter %d]: Etapa 5 (Reducao Global/Media) Concluida.\n", id, it);
+        break;
+    }
+}
+
+// Log texto: intercala as threads pelo relógio (empate: menor thread primeiro).
+static void imprime_log(const ktrace_cabecalho_t *cab, trace_thread_t *th) {
+    uint64_t *pos = (uint64_t *)calloc(cab->num_threads, sizeof(uint64_t));
+    uint32_t t;
+
+    if (pos == NULL) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para a conversao\n");
+        exit(1);
+    }
+    printf("Iniciando K-Means com %u threads (Opcao 2: Reducao Local)\n", cab->num_threads);
+    while (1) {
+        int melhor = -1;
+        for (t = 0; t < cab->num_threads; t++) {
+            if (pos[t] < th[t].bloco.gravados &&
+                (melhor < 0 || th[t].regs[pos[t]].ns < th[melhor].regs[pos[melhor]].ns))
+                melhor = (int)t;
+        }
+        if (melhor < 0)
+            break;
+        imprime_linha(&th[melhor].regs[pos[melhor]++]);
+    }
+    printf("Tempo de CPU total (Opcao 2): %f segundos\n", cab->tempo_cpu);
+    free(pos);
+}
+
+
+// Um evento completo ("X") do Chrome, com tempos em microssegundos.
+static void imprime_span(int *primeiro, const char *nome, int barreira, int tid, uint64_t ini, uint64_t fim, int it) {
+    printf("%s\n    {\"name\": \"%s", *primeiro ? "" : ",", nome);
+    if (barreira > 0)
+        printf(" %d", barreira);
+    printf("\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f, \"args\": {\"iteracao\": %d}}",
+           tid, ini / 1000.0, (fim - ini) / 1000.0, it);
+    *primeiro = 0;
+}
+
+// JSON do Chrome: cada etapa vai do seu evento de início até o evento de fim
+// ou, se não houver (contabilidade, soma local), até o próximo evento da thread.
+static void imprime_chrome(const ktrace_cabecalho_t *cab, trace_thread_t *th) {
+    int primeiro = 1;
+    uint32_t t;
+    uint64_t i;
+
+    printf("{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+    for (t = 0; t < cab->num_threads; t++) {
+        const ktrace_reg_t *aberto = NULL;   // Início da etapa em andamento
+
+        printf("%s\n    {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"Thread %u\"}}",
+               primeiro ? "" : ",", t, t);
+        primeiro = 0;
+        for (i = 0; i < th[t].bloco.gravados; i++) {
+            const ktrace_reg_t *r = &th[t].regs[i];
+            if (r->evento == KTRACE_CONTAB_TOTAL || r->evento == KTRACE_CONVERGIU) {
+                // Eventos instantâneos não encerram a etapa em andamento
+                printf(",\n    {\"name\": \"%s\", \"ph\": \"i\", \"s\": \"t\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"args\": {\"iteracao\": %d",
+                       r->evento == KTRACE_CONVERGIU ? "Convergiu" : "Total de flips", t, r->ns / 1000.0, r->iteracao);
+                if (r->evento == KTRACE_CONTAB_TOTAL)
+                    printf(", \"flips\": %d", r->valor);
+                printf("}}");
+                continue;
+            }
+            if (aberto != NULL) {
+                imprime_span(&primeiro, nomes_etapa[aberto->evento], aberto->barreira, (int)t, aberto->ns, r->ns,
+                             aberto->iteracao);
+                aberto = NULL;
+            }
+            if (nomes_etapa[r->evento] != NULL)
+                aberto = r;
+        }
+    }
+    printf("\n]}\n");
+}
+
+
+int main(int argc, char *argv[]) {
+    ktrace_cabecalho_t cab;
+    trace_thread_t *th;
+    FILE *f;
+    int chrome = 0, opt;
+    uint32_t t;
+    uint64_t perdidos = 0;
+
+    while ((opt = getopt(argc, argv, "c")) != -1) {
+        if (opt == 'c') {
+            chrome = 1;
+        } else {
+            argc = 0; // Força a mensagem de uso abaixo
+            break;
+        }
+    }
+    if (argc - optind != 1) {
+        fprintf(stderr, "Erro: Voce deve especificar o arquivo de trace.\n");
+        fprintf(stderr, "Uso: %s [-c] log1.trace > log1.txt (ou, com -c, > log1.json)\n", argv[0]);
+        return 1;
+    }
+
+    // 1. Leitura do trace
+    f = fopen(argv[optind], "rb");
+    if (f == NULL) {
+        fprintf(stderr, "Erro: nao foi possivel abrir '%s'.\n", argv[optind]);
+        return 1;
+    }
+    if (fread(&cab, sizeof(cab), 1, f) != 1 || memcmp(cab.magic, "KTRC", 4) != 0 ||
+        cab.versao != KTRACE_VERSAO || cab.tam_registro != sizeof(ktrace_reg_t) || cab.num_threads == 0) {
+        fprintf(stderr, "Erro: '%s' nao e um trace do logconc (versao %d).\n", argv[optind], KTRACE_VERSAO);
+        fclose(f);
+        return 1;
+    }
+    th = (trace_thread_t *)calloc(cab.num_threads, sizeof(trace_thread_t));
+    if (th == NULL) {
+        fprintf(stderr, "Erro: Falha ao alocar memoria para a conversao\n");
+        return 1;
+    }
+    for (t = 0; t < cab.num_threads; t++) {
+        if (fread(&th[t].bloco, sizeof(ktrace_bloco_t), 1, f) != 1 || th[t].bloco.thread != t ||
+            th[t].bloco.gravados > th[t].bloco.total || th[t].bloco.gravados > (1ULL << 30) ||
+            (th[t].regs = (ktrace_reg_t *)malloc(sizeof(ktrace_reg_t) * (th[t].bloco.gravados + 1))) == NULL ||
+            fread(th[t].regs, sizeof(ktrace_reg_t), th[t].bloco.gravados, f) != th[t].bloco.gravados) {
+            fprintf(stderr, "Erro: trace '%s' truncado ou corrompido (thread %u).\n", argv[optind], t);
+            fclose(f);
+            return 1;
+        }
+        perdidos += th[t].bloco.total - th[t].bloco.gravados;
+    }
+    fclose(f);
+    if (perdidos > 0)
+        fprintf(stderr, "Aviso: %llu registros antigos foram sobrescritos (aumente os registros por thread do logconc)\n",
+                (unsigned long long)perdidos);
+
+    // 2. Conversão
+    if (chrome)
+        imprime_chrome(&cab, th);
+    else
+        imprime_log(&cab, th);
+
+    for (t = 0; t < cab.num_threads; t++)
+        free(th[t].regs);
+    free(th);
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "kmeans_io.h"
+
+// Conversor do formato texto (geninput.py) para o formato binário do
+// kmeans_io.h, que os programas carregam com mmap (opção -i). DIM é o
+// número de coordenadas da primeira linha do texto e vai para o cabeçalho.
+// Com -f as coordenadas são gravadas em float32 (modo -p float dos programas).
+
+int main(int argc, char *argv[]) {
+    dataset_t ds;
+    int elem_size = sizeof(double);
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f")) != -1) {
+        if (opt == 'f') {
+            elem_size = sizeof(float);
+        } else {
+            argc = 0; // Força a mensagem de uso abaixo
+            break;
+        }
+    }
+    if (argc - optind != 1) {
+        fprintf(stderr, "Erro: Voce deve especificar o arquivo de saida.\n");
+        fprintf(stderr, "Uso: cat input.txt | %s [-f] input.bin\n", argv[0]);
+        return 1;
+    }
+
+    // 1. Leitura do texto (stdin)
+    if (dataset_open(NULL, &ds) != 0)
+        return 1;
+    if (ds.texto == NULL) {
+        fprintf(stderr, "Erro: a entrada ja esta no formato binario.\n");
+        dataset_free(&ds);
+        return 1;
+    }
+    if (dataset_parse_text(&ds) != 0) {
+        dataset_free(&ds);
+        return 1;
+    }
+
+    // 2. Escrita do binário
+    if (dataset_write_bin(argv[optind], &ds, elem_size) != 0) {
+        dataset_free(&ds);
+        return 1;
+    }
+
+    fprintf(stderr, "Convertidos K=%d centroides e N=%d pontos (DIM=%d, %s) para '%s'\n",
+            ds.k, ds.n, ds.dim, elem_size == sizeof(float) ? "float" : "double", argv[optind]);
+
+    dataset_free(&ds);
+    return 0;
+}